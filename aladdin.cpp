@@ -1,3 +1,16 @@
+#include "keygen.hpp"
+#include "secp256k1.hpp"
+#include "gen_table.hpp"
+#include "endomorphism.hpp"
+#include "ossl_threads.hpp"
+#include "hit_writer.hpp"
+#include "checkpoint.hpp"
+#include "telemetry.hpp"
+#include "pubkey_match.hpp"
+#include "near_index.hpp"
+#include "top_hits.hpp"
+#include "cpu_dispatch.hpp"
+
 #include <cstdlib>
 #include <string>
 #include <optional>
@@ -9,10 +22,13 @@
 #include <cctype>
 #include <vector>
 #include <fstream>
+#include <chrono>
 
 #include <openssl/ec.h>
 #include <openssl/objects.h>
 
+#include <unistd.h>
+
 
 #define LIKELY(x) __builtin_expect((x),1)
 #define UNLIKELY(x) __builtin_expect((x),0)
@@ -22,24 +38,27 @@ struct parsed_args
 {
     bool help = false;
     bool with_pubkey = false;
+    bool raw_records = false;
+    bool endomorphism = false;
+    bool negation = false;
+    bool gen_table_huge_pages = false;
+    unsigned int flush_ms = 1000;
     unsigned int min_match_nbits;
     std::optional<std::string> maybe_pubkey;
     std::optional<std::string> maybe_pubkey_fname;
     std::optional<std::uint64_t> maybe_ntries;
+    std::optional<std::uint64_t> maybe_seed;
+    std::optional<std::string> maybe_checkpoint_fname;
+    std::optional<std::string> maybe_stats_fname;
+    std::optional<std::string> maybe_gen_table_fname;
+    std::optional<cpu_kernels_t> maybe_kernels;
+    std::optional<unsigned int> maybe_max_radius;
+    std::optional<unsigned int> maybe_top_k;
+    std::optional<std::string> maybe_top_fname;
+    unsigned int block_size = 1;
 };
 
 
-using uncompressed_key_t = std::array<std::uint8_t, 65>;
-using pubkey_i8_t = std::array<std::uint8_t, 64>;
-using pubkey_i64_t = std::array<std::uint64_t, 8>;
-
-typedef union
-{
-    pubkey_i8_t vi8;
-    pubkey_i64_t vi64;
-} pubkey_t;
-
-
 typedef struct
 {
     std::vector<std::string> repr;
@@ -131,6 +150,26 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
                     }
                     break;
                 }
+                case 'b':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.block_size = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid block size passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
                 case 'k':
                 {
                     if (--argc > 0)
@@ -173,6 +212,175 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
                     }
                     break;
                 }
+                case 's':
+                {
+                    if (--argc > 0)
+                    {
+                        char * end_p = nullptr;
+                        auto val = strtoull(argv[1], &end_p, 0);
+                        if ((*argv[1] != '\0') and (*end_p == '\0'))
+                        {
+                            parsed.maybe_seed = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid seed passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'c':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_checkpoint_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'j':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_stats_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'T':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_gen_table_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'H':
+                {
+                    parsed.gen_table_huge_pages = true;
+
+                    break;
+                }
+                case 'r':
+                {
+                    parsed.raw_records = true;
+
+                    break;
+                }
+                case 'g':
+                {
+                    parsed.endomorphism = true;
+
+                    break;
+                }
+                case 'y':
+                {
+                    parsed.negation = true;
+
+                    break;
+                }
+                case 'f':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 0)
+                        {
+                            parsed.flush_ms = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid flush interval passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'R':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 0)
+                        {
+                            parsed.maybe_max_radius = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid radius passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'm':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.maybe_top_k = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of best keys passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'o':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_top_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'K':
+                {
+                    if (--argc > 0)
+                    {
+                        cpu_kernels_t kernels;
+                        if (cpu_kernels_parse(argv[1], kernels))
+                        {
+                            parsed.maybe_kernels = kernels;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid kernels passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
                 case 'h':
                     show_help = true;
                     parsed.help = show_help;
@@ -199,6 +407,24 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
         }
     }
 
+    if (parsed.maybe_checkpoint_fname and not parsed.maybe_seed)
+    {
+        fprintf(stderr, "Checkpoints need a seeded run, -c requires -s.\n");
+        argc = 0;
+    }
+
+    if (parsed.gen_table_huge_pages and not parsed.maybe_gen_table_fname)
+    {
+        fprintf(stderr, "Huge pages are for the generator table, -H requires -T.\n");
+        argc = 0;
+    }
+
+    if (parsed.maybe_top_fname.has_value() != parsed.maybe_top_k.has_value())
+    {
+        fprintf(stderr, "The best keys are saved to a file, -m and -o go together.\n");
+        argc = 0;
+    }
+
     if (show_help or (argc != N_REQUIRED) or (not parsed.maybe_pubkey and not parsed.maybe_pubkey_fname))
     {
         if (argc != N_REQUIRED)
@@ -215,8 +441,24 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
             "Usage: aladdin [options] <Number of bits to match:UINT>\n\n"
             "Options:\n"
             "         -n UINT64 number of tries, >= 1\n"
+            "         -b UINT   generate keys in blocks of UINT sharing one field inversion, >= 1 (default 1)\n"
+            "         -s UINT64 draw keys from a ChaCha20 stream keyed by UINT64, making the run reproducible\n"
+            "         -c STR    checkpoint file of a seeded run, resumed from if it exists, saved every 10 s and at exit;\n"
+            "                   -n then counts the tries of every invocation of the run\n"
             "         -k STR    single input pubkey, with or without preceding header byte\n"
             "         -i STR    file name with input pubkey(s), one per line\n"
+            "         -p        append the matching pubkey to every hit\n"
+            "         -g        also test the 5 keys the endomorphism and negation of secp256k1 give for every point\n"
+            "         -y        also test the negation (x, p - y) of every key, scored in the same pass, implied by -g\n"
+            "         -r        write hits as binary records, see hitdec, instead of text\n"
+            "         -f UINT   flush hits to stdout at least every UINT ms, 0 flushes as soon as they arrive (default 1000)\n"
+            "         -j STR    also write throughput, per-stage cycles and hits per target to JSON file STR every 10 s\n"
+            "         -T STR    multiply by G with the 64 MiB table mapped from file STR, which is built first if missing\n"
+            "         -H        with -T, copy the table onto huge pages instead of mapping the file\n"
+            "         -m UINT   keep only the UINT best keys of every target, from <bits to match> up, instead of writing every hit\n"
+            "         -o STR    with -m, write the best keys to file STR every 10 s and at exit\n"
+            "         -R UINT   look targets up in the near-neighbour index while 512 - <bits to match> <= UINT, else scan them (default when cheaper)\n"
+            "         -K STR    compare with the scalar, avx2 or avx512 kernels, at most what the CPU supports (default the most)\n"
             "         -h        show help\n");
 
         return show_help ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -243,6 +485,14 @@ int main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
+    if (args.maybe_kernels and not cpu_kernels_select(*args.maybe_kernels))
+    {
+        fprintf(stderr, "[!] The CPU lacks the %s kernels, it supports at most %s\n",
+            cpu_kernels_name(*args.maybe_kernels), cpu_kernels_name(cpu_kernels_supported()));
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "[i] Using the %s kernels%s\n", cpu_kernels_name(cpu_kernels()), cpu_kernels_vpopcntdq() ? " with VPOPCNTDQ" : "");
+
     targets_soa_t targets;
     if (args.maybe_pubkey)
     {
@@ -256,70 +506,370 @@ int main(int argc, char **argv)
         read_targets_from_file(*args.maybe_pubkey_fname, targets);
     }
 
-    EC_KEY *key_p = EC_KEY_new_by_curve_name(NID_secp256k1);
-    uncompressed_key_t uncompressed;
+    ossl_threads_setup();
+
+    if (args.maybe_gen_table_fname and not gen_table_open(*args.maybe_gen_table_fname, args.gen_table_huge_pages))
+    {
+        return EXIT_FAILURE;
+    }
+
+    keygen_t *kg_p = keygen_new(0, args.block_size, args.maybe_seed, 0);
+
+    if (kg_p == nullptr)
+    {
+        fprintf(stderr, "[!] Failed to allocate key generator\n");
+        return EXIT_FAILURE;
+    }
+
+    auto const SEED = args.maybe_seed.value_or(0);
+
+    // points tried in earlier invocations of the run
+    std::uint64_t ntried = 0;
+
+    if (args.maybe_checkpoint_fname and (access(args.maybe_checkpoint_fname->c_str(), F_OK) == 0))
+    {
+        checkpoint_t cp;
+
+        if (not checkpoint_load(*args.maybe_checkpoint_fname, cp))
+        {
+            fprintf(stderr, "[!] Failed to read checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+            return EXIT_FAILURE;
+        }
+        if ((cp.seed != SEED) or (cp.walk_len != 0) or (cp.counters.size() != 1))
+        {
+            fprintf(stderr, "[!] Checkpoint %s is of another run\n", args.maybe_checkpoint_fname->c_str());
+            return EXIT_FAILURE;
+        }
+
+        keygen_seek(*kg_p, cp.counters.front());
+        ntried = cp.ntried.front();
+        fprintf(stderr, "[i] Resuming from checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+        if (args.maybe_top_k)
+        {
+            fprintf(stderr, "[w] The best keys are only kept from the checkpoint on\n");
+        }
+    }
+
+    auto const BLOCK_SIZE = kg_p->block_size;
+    auto const NVARIANTS_TESTED = args.endomorphism ? NVARIANTS : (args.negation ? 2 : 1);
+
+    // keys are scored together with their negation, variant v with v + 3, when it is tested
+    bool const PAIRED = args.endomorphism or args.negation;
+    auto const NUNPAIRED = args.endomorphism ? NVARIANTS / 2 : 1;
+
+    // the points of a block, followed by their other variants when there are any
+    std::vector<uncompressed_key_t> uncompressed(BLOCK_SIZE * (args.endomorphism ? NVARIANTS : 1));
+    auto * variant_priv_p = BN_new();
 
     bool const infinite_loop = not args.maybe_ntries.has_value();
-    auto const ntries = args.maybe_ntries.has_value() ? *args.maybe_ntries : 0;
+    auto const ntries = args.maybe_ntries.has_value() ? *args.maybe_ntries - std::min(*args.maybe_ntries, ntried) : 0;
+
+    // past the last point tried, inside the block when -n ran out in it
+    auto next_counter = kg_p->next_counter + kg_p->next_first;
 
     auto const NTARGETS = targets.pubkeys.size();
 
-    for (std::uint64_t it = 0; infinite_loop or (it < ntries); ++it)
+    // high enough a match, only the targets near each key in the index, else all of them
+    near_index_t near;
+    bool const use_near = near_index_build(near, targets.pubkeys.data(), NTARGETS, args.min_match_nbits, args.maybe_max_radius);
+    if (use_near)
     {
-        EC_KEY_generate_key(key_p);
+        fprintf(stderr, "[i] Looking targets up within %u bits in the near-neighbour index\n", near.radius);
+    }
+
+    pubkey_match_t match;
+    if (not use_near)
+    {
+        pubkey_match_build(match, targets.pubkeys.data(), NTARGETS, args.min_match_nbits);
+    }
+    std::vector<std::uint32_t> tixs;
+    std::vector<std::uint32_t> neg_tixs;
+
+    std::optional<hit_stream_header_t> maybe_header;
+    if (args.raw_records)
+    {
+        std::uint8_t const flags = (args.with_pubkey ? HIT_STREAM_WITH_PUBKEY : 0) | (args.maybe_seed ? HIT_STREAM_SEEDED : 0);
+        maybe_header = hit_stream_header(HIT_STREAM_ALADDIN, flags, NTARGETS, SEED, 0);
+    }
+    auto const format = [&targets, &args, SEED](hit_record_t const & record, std::string & line)
+    {
+        auto resolved = record;
+        hit_record_resolve(resolved, SEED, 0);
+        hit_format_aladdin(resolved, targets.repr[record.tix], args.with_pubkey, line);
+    };
+    auto * writer_p = hit_writer_new(1, NTARGETS, STDOUT_FILENO, maybe_header, args.flush_ms, format);
+
+    // with -m, hits only enter the heaps of their targets, saved as a whole with -o
+    bool const keep_top = args.maybe_top_k.has_value();
+    top_hits_t top;
+    if (keep_top)
+    {
+        top_hits_init(top, NTARGETS, *args.maybe_top_k, args.min_match_nbits);
+    }
+    auto nentered_last = top.nentered;
+
+    auto const save_top = [keep_top, &args, &top, &maybe_header, &format]()
+    {
+        if (not keep_top)
+        {
+            return;
+        }
+
+        if (not top_hits_save(top, *args.maybe_top_fname, maybe_header, format))
+        {
+            fprintf(stderr, "[w] Failed to save the best keys to %s\n", args.maybe_top_fname->c_str());
+        }
+    };
+
+    auto const nhits = [keep_top, &top, writer_p]()
+    {
+        return keep_top ? top.nentered : hit_writer_nhits(*writer_p);
+    };
 
-        auto uncompressed_p = uncompressed.data();
-        i2o_ECPublicKey(key_p, &uncompressed_p);
+    auto const save_checkpoint = [&args, &next_counter, &ntried, writer_p, SEED]()
+    {
+        if (not args.maybe_checkpoint_fname)
+        {
+            return;
+        }
+
+        // the hits of everything before the checkpoint must be out before it is
+        hit_writer_sync(*writer_p);
+
+        if (not checkpoint_save(*args.maybe_checkpoint_fname, checkpoint_t{SEED, 0, {next_counter}, {ntried}}))
+        {
+            fprintf(stderr, "[w] Failed to save checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+        }
+    };
 
-        pubkey_t pubkey;
-        std::copy(uncompressed.cbegin() + 1, uncompressed.cend(), pubkey.vi8.begin());
+    stage_counters_t counters{};
+    auto const snap_start = telemetry_snapshot({&counters});
+    auto snap_last = snap_start;
 
-        for (auto tix = 0u; tix < NTARGETS; ++tix)
+    auto const write_stats = [&](telemetry_snapshot_t const & snap)
+    {
+        if (not args.maybe_stats_fname)
         {
-            // count mismatched bits
-            auto const & target = targets.pubkeys[tix];
+            return;
+        }
 
-            unsigned int mismatched = 0;
-            for (auto ix = 0u; ix < pubkey.vi64.size(); ++ix)
+        // the best keys skip the writer, their targets count the hits that entered the heaps
+        std::vector<std::uint64_t> nhits;
+        if (keep_top)
+        {
+            nhits = top.target_nentered;
+        }
+        else
+        {
+            hit_writer_target_nhits(*writer_p, nhits);
+        }
+
+        std::vector<std::pair<std::string_view, std::uint64_t>> target_nhits;
+        for (auto tix = 0u; tix < nhits.size(); ++tix)
+        {
+            if (nhits[tix] != 0)
             {
-                mismatched += __builtin_popcountl(pubkey.vi64[ix] ^ target.vi64[ix]);
+                target_nhits.emplace_back(targets.repr[tix], nhits[tix]);
             }
+        }
+
+        if (not telemetry_write_json(*args.maybe_stats_fname, snap_start, snap_last, snap, target_nhits))
+        {
+            fprintf(stderr, "[w] Failed to write stats to %s\n", args.maybe_stats_fname->c_str());
+        }
+    };
 
-            auto const matched = 64 * 8 - mismatched;
-            if (UNLIKELY(matched >= args.min_match_nbits))
+    using clock = std::chrono::steady_clock;
+    auto constexpr STATS_PERIOD = std::chrono::seconds(10);
+
+    for (std::uint64_t it = 0; infinite_loop or (it < ntries); /* nop */)
+    {
+        auto const t0 = tsc_now();
+        if (UNLIKELY(not keygen_next_block(*kg_p, uncompressed.data())))
+        {
+            fprintf(stderr, "[!] Failed to generate keys\n");
+            break;
+        }
+
+        // the block the run resumed in only counts from where it stopped
+        auto * const keys_p = uncompressed.data() + kg_p->first;
+        auto const block_nkeys = BLOCK_SIZE - kg_p->first;
+        auto const nkeys = infinite_loop ? block_nkeys : std::min<std::uint64_t>(block_nkeys, ntries - it);
+        auto const ncandidates = nkeys * NVARIANTS_TESTED;
+
+        if (args.endomorphism)
+        {
+            endomorphism_expand(keys_p, nkeys);
+        }
+
+        auto const t1 = tsc_now();
+
+        auto const push_hits = [&](pubkey_t const & pubkey, std::vector<std::uint32_t> const & tixs, std::size_t pix, unsigned int variant)
+        {
+            for (auto const tix : tixs)
             {
-                auto * priv_as_bn_p = EC_KEY_get0_private_key(key_p);
-                auto * hex_p = BN_bn2hex(priv_as_bn_p);
-                if (args.with_pubkey)
+                auto const matched = matched_bits(pubkey, targets.pubkeys[tix]);
+                if (matched < args.min_match_nbits)
+                {
+                    continue;
+                }
+                if (keep_top and not top_hits_qualifies(top, tix, matched))
                 {
-                    std::array<char, 2 * 64 + 1> pub_str;
+                    continue;
+                }
 
-                    for (auto ix = 0u; ix < pubkey.vi8.size(); ++ix)
-                    {
-                        {
-                            auto const nibble = pubkey.vi8[ix] >> 4;
+                hit_record_t record{};
+                record.tix = tix;
+                record.score = matched;
 
-                            pub_str[2 * ix + 0] = nibble >= 10 ? nibble + 'A' - 10 : nibble + '0';
-                        }
-                        {
-                            auto const nibble = pubkey.vi8[ix] & 0xF;
+                if (kg_p->seeded)
+                {
+                    record.flags = HIT_RECORD_COORD;
+                    record.coord = {kg_p->counter + pix, kg_p->stream, variant};
+                }
+                else if (variant == 0)
+                {
+                    hit_record_set_private_key(record, keygen_private_key(*kg_p, pix));
+                }
+                else
+                {
+                    // n - k for the negations
+                    endomorphism_private_key(keygen_private_key(*kg_p, pix), variant, variant_priv_p, kg_p->ctx_p);
+                    hit_record_set_private_key(record, variant_priv_p);
+                }
 
-                            pub_str[2 * ix + 1] = nibble >= 10 ? nibble + 'A' - 10 : nibble + '0';
-                        }
-                    }
-                    pub_str.back() = 0;
+                if (keep_top)
+                {
+                    top_hits_push(top, record);
+                }
+                else
+                {
+                    hit_writer_push(*writer_p, 0, record);
+                }
+            }
+        };
 
-                    printf("%s\t%03u\t%s\t%s\n", targets.repr[tix].c_str(), matched, hex_p, pub_str.data());
+        // key kix is variant kix / nkeys of point kix % nkeys, its negation variant kix / nkeys + 3
+        for (auto kix = 0u; kix < nkeys * NUNPAIRED; ++kix)
+        {
+            auto const pix = kg_p->first + kix % nkeys;
+            auto const variant = kix / nkeys;
+
+            pubkey_t pubkey;
+            std::copy(keys_p[kix].cbegin() + 1, keys_p[kix].cend(), pubkey.vi8.begin());
+
+            if (not PAIRED)
+            {
+                if (use_near)
+                {
+                    near_index_lookup(near, pubkey, tixs);
                 }
                 else
                 {
-                    printf("%s\t%03u\t%s\n", targets.repr[tix].c_str(), matched, hex_p);
+                    // all targets at once, returning those that match
+                    pubkey_match(match, pubkey, tixs);
                 }
-                fflush(stdout);
-                OPENSSL_free(hex_p);
+
+                push_hits(pubkey, tixs, pix, variant);
+                continue;
+            }
+
+            pubkey_t neg;
+            if (args.endomorphism)
+            {
+                auto const & neg_key = keys_p[kix + NUNPAIRED * nkeys];
+                std::copy(neg_key.cbegin() + 1, neg_key.cend(), neg.vi8.begin());
+            }
+            else
+            {
+                std::copy(pubkey.vi8.cbegin(), pubkey.vi8.cbegin() + 32, neg.vi8.begin());
+                fe_to_bytes(fe_neg(fe_from_bytes(pubkey.vi8.data() + 32)), neg.vi8.data() + 32);
             }
+
+            if (use_near)
+            {
+                near_index_lookup(near, pubkey, tixs);
+                near_index_lookup(near, neg, neg_tixs);
+            }
+            else
+            {
+                // both at once, x only compared once
+                pubkey_match_pair(match, pubkey, neg, tixs, neg_tixs);
+            }
+
+            push_hits(pubkey, tixs, pix, variant);
+            push_hits(neg, neg_tixs, pix, variant + NVARIANTS / 2);
+        }
+
+        // the lookups need not return targets whose heaps a hit can no longer enter
+        if (keep_top and (top.nentered != nentered_last))
+        {
+            nentered_last = top.nentered;
+
+            auto const bar = std::max(args.min_match_nbits, top_hits_min_bar(top));
+            if (use_near)
+            {
+                near_index_narrow(near, bar);
+            }
+            else
+            {
+                match.min_matched = bar;
+            }
+        }
+
+        auto const t2 = tsc_now();
+
+        std::uint64_t cycles[NSTAGES] = {};
+        cycles[STAGE_KEYGEN] = t1 - t0 - kg_p->serialize_cycles;
+        cycles[STAGE_SERIALIZE] = kg_p->serialize_cycles;
+        cycles[STAGE_COMPARE] = t2 - t1;
+
+        // tries count points, throughput every public key tested
+        it += nkeys;
+        stage_counters_add(counters, ncandidates, cycles);
+        next_counter = kg_p->counter + kg_p->first + nkeys;
+        ntried += nkeys;
+
+        if (UNLIKELY(clock::now() - snap_last.t >= STATS_PERIOD))
+        {
+            auto const snap = telemetry_snapshot({&counters});
+            auto const n = telemetry_nkeys(snap);
+            std::chrono::duration<double> const dt = snap.t - snap_last.t;
+
+            fprintf(stderr, "[i] %lu keys, %.0lf keys/s, %lu hits\n",
+                n, (n - telemetry_nkeys(snap_last)) / dt.count(), nhits());
+            telemetry_print(stderr, snap_last, snap);
+            write_stats(snap);
+
+            snap_last = snap;
+
+            save_top();
+            save_checkpoint();
         }
     }
 
+    save_top();
+    save_checkpoint();
+
+    {
+        auto const snap = telemetry_snapshot({&counters});
+        auto const n = telemetry_nkeys(snap);
+        std::chrono::duration<double> const dt = snap.t - snap_start.t;
+
+        fprintf(stderr, "[i] %lu keys in %.1lf s, %.0lf keys/s, %lu hits\n",
+            n, dt.count(), n / dt.count(), nhits());
+        telemetry_print(stderr, snap_start, snap);
+
+        // per-target counts are taken as the writer drains the hits
+        hit_writer_sync(*writer_p);
+        write_stats(snap);
+    }
+
+    hit_writer_free(writer_p);
+    BN_free(variant_priv_p);
+    keygen_free(kg_p);
+
+    ossl_threads_cleanup();
+
     return EXIT_SUCCESS;
 }
@@ -1,7 +1,7 @@
-aladdin: $(OSSL_DIR)/libcrypto.a aladdin.cpp aladdin.mk
+aladdin: $(OSSL_DIR)/libcrypto.a aladdin.cpp keygen.cpp keygen.hpp secp256k1.cpp secp256k1.hpp gen_table.cpp gen_table.hpp ossl_threads.cpp ossl_threads.hpp hit_writer.cpp hit_writer.hpp endomorphism.cpp endomorphism.hpp chacha20.cpp chacha20.hpp checkpoint.cpp checkpoint.hpp telemetry.cpp telemetry.hpp cpu_dispatch.cpp cpu_dispatch.hpp pubkey_match.cpp near_index.cpp near_index.hpp top_hits.cpp top_hits.hpp pubkey_match.hpp fd_io.cpp fd_io.hpp aladdin.mk
 	$(CXX) \
-	aladdin.cpp -o aladdin \
-	-std=c++17 -march=native \
+	aladdin.cpp keygen.cpp secp256k1.cpp gen_table.cpp ossl_threads.cpp hit_writer.cpp endomorphism.cpp chacha20.cpp checkpoint.cpp telemetry.cpp cpu_dispatch.cpp pubkey_match.cpp near_index.cpp top_hits.cpp fd_io.cpp -o aladdin \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt -Wno-psabi -pthread \
 	$(OSSL_DIR)/libcrypto.a \
 	-I$(OSSL_DIR) \
 	-I$(OSSL_DIR)/include \
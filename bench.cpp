@@ -0,0 +1,746 @@
+#include "keygen.hpp"
+#include "gen_table.hpp"
+#include "endomorphism.hpp"
+#include "unaddr.hpp"
+#include "sha256_mb.hpp"
+#include "ripemd160_mb.hpp"
+#include "target_index.hpp"
+#include "exact_index.hpp"
+#include "window_scan.hpp"
+#include "longest_run.hpp"
+#include "pubkey_match.hpp"
+#include "near_index.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <optional>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <functional>
+#include <random>
+#include <chrono>
+
+#include <openssl/ec.h>
+#include <openssl/objects.h>
+#include <openssl/sha.h>
+#include <openssl/ripemd.h>
+
+
+#define UNLIKELY(x) __builtin_expect((x),0)
+
+
+struct parsed_args
+{
+    bool help = false;
+    unsigned int nreps = 51;
+    unsigned int nwarmup = 5;
+    unsigned int min_match_nbits = 22;
+    std::optional<std::string> maybe_filter;
+    std::optional<std::string> maybe_gen_table_fname;
+    std::optional<cpu_kernels_t> maybe_kernels;
+};
+
+
+int parse_args(int argc, char* argv[], parsed_args & parsed)
+{
+    auto constexpr N_REQUIRED = 0u;
+    bool show_help = false;
+    int c = 0;
+
+    while (--argc > 0 && (*++argv)[0] == '-')
+    {
+        while ((c = *++argv[0]))
+        {
+            switch (c)
+            {
+                case 'r':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.nreps = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of repetitions passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'w':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 0)
+                        {
+                            parsed.nwarmup = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of warmup repetitions passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'n':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if ((val >= 1) and (val <= 160))
+                        {
+                            parsed.min_match_nbits = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of bits to match passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'f':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_filter = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'T':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_gen_table_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'K':
+                {
+                    if (--argc > 0)
+                    {
+                        cpu_kernels_t kernels;
+                        if (cpu_kernels_parse(argv[1], kernels))
+                        {
+                            parsed.maybe_kernels = kernels;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid kernels passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'h':
+                    show_help = true;
+                    parsed.help = show_help;
+                    break;
+
+                default:
+                {
+                    fprintf(stderr, "Illegal option [%c]\n", (char)c);
+                    argc = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (show_help or (argc != N_REQUIRED))
+    {
+        if (argc != N_REQUIRED)
+        {
+            fprintf(stderr, "Unexpected arguments.\n");
+        }
+
+        fprintf(stderr,
+            "\n"
+            "Usage: bench [options]\n\n"
+            "Times the stages of the candidate pipeline and prints one tab-separated line per benchmark:\n"
+            "name, operations per repetition, repetitions, then median, p99 and min nanoseconds per operation.\n\n"
+            "Options:\n"
+            "         -r UINT   timed repetitions of every benchmark, >= 1 (default 51)\n"
+            "         -w UINT   untimed warmup repetitions (default 5)\n"
+            "         -n UINT   number of bits to match in the compare benchmarks (default 22)\n"
+            "         -f STR    only run benchmarks whose name contains STR\n"
+            "         -T STR    also time gej_mul_gen with the generator table file STR, see main -T\n"
+            "         -K STR    time the scalar, avx2 or avx512 kernels, at most what the CPU supports (default the most)\n"
+            "         -h        show help\n");
+
+        return show_help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// keeps results alive so that the timed work is not optimized away
+static volatile std::uint64_t g_sink;
+
+
+// Run fn, which performs nops operations, nwarmup + nreps times and print
+// the distribution of the time per operation over the timed repetitions.
+static
+void run_bench(parsed_args const & args, char const * name, std::uint64_t nops, std::function<void()> const & fn)
+{
+    if (args.maybe_filter and (std::strstr(name, args.maybe_filter->c_str()) == nullptr))
+    {
+        return;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    for (auto rep = 0u; rep < args.nwarmup; ++rep)
+    {
+        fn();
+    }
+
+    std::vector<double> ns_per_op(args.nreps);
+    for (auto & x : ns_per_op)
+    {
+        auto const t0 = clock::now();
+        fn();
+        std::chrono::duration<double, std::nano> const dt = clock::now() - t0;
+
+        x = dt.count() / nops;
+    }
+
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    // nearest-rank percentiles
+    auto const percentile = [&ns_per_op](double p)
+    {
+        auto const rank = (std::size_t)std::ceil(p * ns_per_op.size());
+        return ns_per_op[std::max<std::size_t>(rank, 1) - 1];
+    };
+
+    printf("%s\t%lu\t%u\t%.1lf\t%.1lf\t%.1lf\n",
+        name, nops, args.nreps, percentile(0.5), percentile(0.99), ns_per_op.front());
+    fflush(stdout);
+}
+
+
+static
+std::string base58check(std::uint8_t version, hash160_t const & h160)
+{
+    static char const alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+    std::array<std::uint8_t, 25> payload;
+    payload[0] = version;
+    std::copy(h160.cbegin(), h160.cend(), payload.begin() + 1);
+
+    std::uint8_t d1[SHA256_DIGEST_LENGTH];
+    std::uint8_t d2[SHA256_DIGEST_LENGTH];
+    SHA256(payload.data(), 21, d1);
+    SHA256(d1, sizeof (d1), d2);
+    std::copy(d2, d2 + 4, payload.begin() + 21);
+
+    // repeated division of the big-endian payload by 58
+    std::string rv;
+    std::vector<std::uint8_t> num(payload.cbegin(), payload.cend());
+    while (std::any_of(num.cbegin(), num.cend(), [](std::uint8_t x){ return x != 0; }))
+    {
+        unsigned int rem = 0;
+        for (auto & byte : num)
+        {
+            auto const acc = rem * 256 + byte;
+            byte = acc / 58;
+            rem = acc % 58;
+        }
+        rv += alphabet[rem];
+    }
+    for (auto const byte : payload)
+    {
+        if (byte != 0)
+        {
+            break;
+        }
+        rv += '1';
+    }
+    std::reverse(rv.begin(), rv.end());
+
+    return rv;
+}
+
+
+static
+std::vector<hash_4_simd_t> random_hashes(std::mt19937_64 & rng, std::size_t n)
+{
+    std::vector<hash_4_simd_t> rv(n);
+
+    for (auto & h : rv)
+    {
+        h = hash_4_simd_t{};
+        for (auto & byte : h.h160)
+        {
+            byte = rng();
+        }
+    }
+
+    return rv;
+}
+
+
+int main(int argc, char **argv)
+{
+    parsed_args args;
+
+    if (parse_args(argc, argv, args) != EXIT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (args.help)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    if (args.maybe_kernels and not cpu_kernels_select(*args.maybe_kernels))
+    {
+        fprintf(stderr, "[!] The CPU lacks the %s kernels, it supports at most %s\n",
+            cpu_kernels_name(*args.maybe_kernels), cpu_kernels_name(cpu_kernels_supported()));
+        return EXIT_FAILURE;
+    }
+
+    // fixed seed, every build benchmarks the same inputs
+    std::mt19937_64 rng(0x5EEDBEEF);
+
+    auto * group_p = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    auto * ctx_p = BN_CTX_new();
+
+    printf("# kernels %s\n", cpu_kernels_name(cpu_kernels()));
+    printf("# name\tops\treps\tmedian_ns\tp99_ns\tmin_ns\n");
+
+    // key generation
+
+    {
+        auto * key_p = EC_KEY_new_by_curve_name(NID_secp256k1);
+
+        run_bench(args, "ec_key_generate_key", 16, [key_p]()
+        {
+            for (auto ix = 0u; ix < 16; ++ix)
+            {
+                EC_KEY_generate_key(key_p);
+            }
+        });
+
+        run_bench(args, "i2o_ECPublicKey", 1024, [key_p]()
+        {
+            std::array<std::uint8_t, 65> buf;
+            for (auto ix = 0u; ix < 1024; ++ix)
+            {
+                auto * p = buf.data();
+                g_sink += i2o_ECPublicKey(key_p, &p);
+            }
+        });
+
+        EC_KEY_free(key_p);
+    }
+
+    {
+        auto constexpr BLOCK_SIZE = 16u;
+        auto * kg_p = keygen_new(0, BLOCK_SIZE, std::uint64_t{1});
+        std::vector<uncompressed_key_t> keys(BLOCK_SIZE);
+
+        run_bench(args, "keygen_random_b16", BLOCK_SIZE, [kg_p, &keys]()
+        {
+            g_sink += keygen_next_block(*kg_p, keys.data());
+        });
+
+        keygen_free(kg_p);
+    }
+
+    {
+        auto constexpr BLOCK_SIZE = 256u;
+        auto * kg_p = keygen_new(std::uint64_t{1} << 40, BLOCK_SIZE, std::uint64_t{1});
+        std::vector<uncompressed_key_t> keys(BLOCK_SIZE);
+
+        run_bench(args, "keygen_walk_b256", 4 * BLOCK_SIZE, [kg_p, &keys]()
+        {
+            for (auto ix = 0u; ix < 4; ++ix)
+            {
+                g_sink += keygen_next_block(*kg_p, keys.data());
+            }
+        });
+
+        // the other 5 keys of each point of a block, per point
+        keys.resize(BLOCK_SIZE * NVARIANTS);
+        keygen_next_block(*kg_p, keys.data());
+
+        run_bench(args, "endomorphism_expand", BLOCK_SIZE, [&keys]()
+        {
+            endomorphism_expand(keys.data(), BLOCK_SIZE);
+            g_sink += keys.back()[1];
+        });
+
+        keygen_free(kg_p);
+    }
+
+    // point arithmetic, the secp256k1 backend against OpenSSL's generic code
+
+    {
+        std::uint8_t k[32];
+        std::generate(std::begin(k), std::end(k), [&rng]{ return (std::uint8_t)rng(); });
+
+        auto * k_p = BN_bin2bn(k, sizeof (k), nullptr);
+        auto * pub_p = EC_POINT_new(group_p);
+
+        run_bench(args, "EC_POINT_mul", 16, [&]()
+        {
+            for (auto ix = 0u; ix < 16; ++ix)
+            {
+                EC_POINT_mul(group_p, pub_p, k_p, nullptr, nullptr, ctx_p);
+            }
+        });
+
+        run_bench(args, "EC_POINT_add", 1024, [&]()
+        {
+            for (auto ix = 0u; ix < 1024; ++ix)
+            {
+                EC_POINT_add(group_p, pub_p, pub_p, EC_GROUP_get0_generator(group_p), ctx_p);
+            }
+        });
+
+        gej_t p;
+        run_bench(args, "gej_mul_gen", 16, [&]()
+        {
+            for (auto ix = 0u; ix < 16; ++ix)
+            {
+                k[31] = (std::uint8_t)ix;
+                gej_mul_gen(p, k);
+            }
+        });
+
+        if (args.maybe_gen_table_fname and gen_table_open(*args.maybe_gen_table_fname, false))
+        {
+            run_bench(args, "gej_mul_gen_table", 16, [&]()
+            {
+                for (auto ix = 0u; ix < 16; ++ix)
+                {
+                    k[31] = (std::uint8_t)ix;
+                    gej_mul_gen(p, k);
+                }
+            });
+        }
+
+        run_bench(args, "gej_add_ge", 1024, [&]()
+        {
+            for (auto ix = 0u; ix < 1024; ++ix)
+            {
+                gej_add_ge(p, p, SECP256K1_G);
+            }
+        });
+
+        run_bench(args, "gej_double", 1024, [&]()
+        {
+            for (auto ix = 0u; ix < 1024; ++ix)
+            {
+                gej_double(p, p);
+            }
+        });
+
+        auto a = p.x;
+        run_bench(args, "fe_mul", 1024, [&]()
+        {
+            for (auto ix = 0u; ix < 1024; ++ix)
+            {
+                a = fe_mul(a, p.y);
+            }
+        });
+
+        run_bench(args, "fe_inv", 16, [&]()
+        {
+            for (auto ix = 0u; ix < 16; ++ix)
+            {
+                a = fe_inv(a);
+            }
+        });
+        g_sink += a.v[0] + p.x.v[0];
+
+        EC_POINT_free(pub_p);
+        BN_free(k_p);
+    }
+
+    // hashing
+
+    auto constexpr NKEYS = 4096u;
+    std::vector<uncompressed_key_t> keys(NKEYS);
+    for (auto & key : keys)
+    {
+        key[0] = 0x04;
+        std::generate(key.begin() + 1, key.end(), [&rng]{ return (std::uint8_t)rng(); });
+    }
+    std::vector<hash256_t> h256s(NKEYS);
+    std::vector<hash_4_simd_t> h160s(NKEYS);
+
+    run_bench(args, "sha256_ripemd160_openssl", NKEYS, [&]()
+    {
+        for (auto ix = 0u; ix < NKEYS; ++ix)
+        {
+            SHA256(keys[ix].data(), keys[ix].size(), h256s[ix].data());
+            RIPEMD160(h256s[ix].data(), h256s[ix].size(), h160s[ix].h160.data());
+        }
+        g_sink += h160s.back().h160[0];
+    });
+
+    run_bench(args, "sha256_65_mb", NKEYS, [&]()
+    {
+        sha256_65_mb(keys.data(), h256s.data(), NKEYS);
+        g_sink += h256s.back()[0];
+    });
+
+    run_bench(args, "sha256_33_mb", NKEYS, [&]()
+    {
+        sha256_33_mb(keys.data(), h256s.data(), NKEYS);
+        g_sink += h256s.back()[0];
+    });
+
+    // leave the uncompressed digests for the stages below
+    sha256_65_mb(keys.data(), h256s.data(), NKEYS);
+
+    run_bench(args, "ripemd160_32_mb", NKEYS, [&]()
+    {
+        ripemd160_32_mb(h256s.data(), h160s.data(), NKEYS);
+        g_sink += h160s.back().h160[0];
+    });
+
+    // matching of hash160s, candidates are the hashes computed above
+
+    auto const MIN_MATCH_NBITS = args.min_match_nbits;
+
+    {
+        auto const others = random_hashes(rng, NKEYS);
+
+        run_bench(args, "longest_run", NKEYS, [&]()
+        {
+            for (auto ix = 0u; ix < NKEYS; ++ix)
+            {
+                g_sink += longest_run(others[ix], h160s[ix], MIN_MATCH_NBITS).len;
+            }
+        });
+    }
+
+    for (std::size_t const ntargets : {1u, 5764u, 1000000u})
+    {
+        auto const targets = random_hashes(rng, ntargets);
+
+        // the compare loop of main, indexed and linear
+        target_index_t index;
+        if (target_index_build(index, targets.data(), targets.size(), MIN_MATCH_NBITS))
+        {
+            auto const name = "compare_index_" + std::to_string(ntargets);
+            auto const nkeys = std::max<std::size_t>(1, std::min<std::size_t>(NKEYS, (1u << 24) / ntargets));
+            std::vector<std::uint32_t> tixs;
+
+            run_bench(args, name.c_str(), nkeys, [&]()
+            {
+                for (auto kix = 0u; kix < nkeys; ++kix)
+                {
+                    target_index_lookup(index, h160s[kix], tixs);
+                    for (auto const tix : tixs)
+                    {
+                        auto const run = longest_run(targets[tix], h160s[kix], MIN_MATCH_NBITS);
+                        if (UNLIKELY(run.len != 0))
+                        {
+                            g_sink += run.len;
+                        }
+                    }
+                }
+            });
+        }
+
+        {
+            auto const name = "compare_linear_" + std::to_string(ntargets);
+            auto const nkeys = std::max<std::size_t>(1, std::min<std::size_t>(NKEYS, (1u << 20) / ntargets));
+            window_scan_t scan;
+            window_scan_build(scan, targets.data(), targets.size(), MIN_MATCH_NBITS);
+            std::vector<std::uint32_t> tixs;
+
+            run_bench(args, name.c_str(), nkeys, [&]()
+            {
+                for (auto kix = 0u; kix < nkeys; ++kix)
+                {
+                    window_scan(scan, h160s[kix], tixs);
+                    for (auto const tix : tixs)
+                    {
+                        auto const run = longest_run(targets[tix], h160s[kix], MIN_MATCH_NBITS);
+                        if (UNLIKELY(run.len != 0))
+                        {
+                            g_sink += run.len;
+                        }
+                    }
+                }
+            });
+        }
+    }
+
+    // whole-hash matching of main at 160 bits, up to lists far past the caches;
+    // a stream of candidates too long to stay cached either, as in a scan
+    {
+        auto constexpr NCANDIDATES = 1u << 20;
+        auto const candidates = random_hashes(rng, NCANDIDATES);
+
+        for (std::size_t const ntargets : {1u, 5764u, 1000000u, 16000000u})
+        {
+            auto const name = "compare_exact_" + std::to_string(ntargets);
+            if (args.maybe_filter and (name.find(*args.maybe_filter) == std::string::npos))
+            {
+                continue;
+            }
+
+            exact_index_t index;
+            exact_index_build(index, random_hashes(rng, ntargets).data(), ntargets);
+            std::vector<std::uint32_t> tixs;
+
+            run_bench(args, name.c_str(), NCANDIDATES, [&]()
+            {
+                for (auto kix = 0u; kix < NCANDIDATES; ++kix)
+                {
+                    if (kix + 8 < NCANDIDATES)
+                    {
+                        exact_index_prefetch(index, candidates[kix + 8]);
+                    }
+                    exact_index_lookup(index, candidates[kix], tixs);
+                    g_sink += tixs.size();
+                }
+            });
+        }
+    }
+
+    {
+        std::vector<std::string> addresses;
+        for (auto const & h : random_hashes(rng, NKEYS))
+        {
+            addresses.push_back(base58check(0x00, h.h160));
+        }
+
+        run_bench(args, "unaddr", NKEYS, [&]()
+        {
+            for (auto const & address : addresses)
+            {
+                g_sink += unaddr(address)[0];
+            }
+        });
+    }
+
+    // matching of public keys, the compare loop of aladdin
+
+    for (std::size_t const ntargets : {1u, 5764u, 100000u})
+    {
+        std::vector<pubkey_t> targets(ntargets);
+        for (auto & target : targets)
+        {
+            std::generate(target.vi64.begin(), target.vi64.end(), [&rng]{ return rng(); });
+        }
+
+        auto const name = "aladdin_match_" + std::to_string(ntargets);
+        auto const nkeys = std::max<std::size_t>(1, std::min<std::size_t>(NKEYS, (1u << 20) / ntargets));
+        pubkey_match_t match;
+        pubkey_match_build(match, targets.data(), ntargets, 300);
+        std::vector<std::uint32_t> tixs;
+
+        run_bench(args, name.c_str(), nkeys, [&]()
+        {
+            for (auto kix = 0u; kix < nkeys; ++kix)
+            {
+                pubkey_t pubkey;
+                std::copy(keys[kix].cbegin() + 1, keys[kix].cend(), pubkey.vi8.begin());
+
+                pubkey_match(match, pubkey, tixs);
+                for (auto const tix : tixs)
+                {
+                    g_sink += matched_bits(pubkey, targets[tix]);
+                }
+            }
+        });
+    }
+
+    // the same through the near-neighbour index, at a radius it is built for
+
+    for (std::size_t const ntargets : {5764u, 100000u, 1000000u})
+    {
+        std::vector<pubkey_t> targets(ntargets);
+        for (auto & target : targets)
+        {
+            std::generate(target.vi64.begin(), target.vi64.end(), [&rng]{ return rng(); });
+        }
+
+        auto const name = "aladdin_near_" + std::to_string(ntargets);
+        near_index_t index;
+        near_index_build(index, targets.data(), ntargets, 480, 512u);
+        std::vector<std::uint32_t> tixs;
+
+        run_bench(args, name.c_str(), NKEYS, [&]()
+        {
+            for (auto kix = 0u; kix < NKEYS; ++kix)
+            {
+                pubkey_t pubkey;
+                std::copy(keys[kix].cbegin() + 1, keys[kix].cend(), pubkey.vi8.begin());
+
+                near_index_lookup(index, pubkey, tixs);
+                for (auto const tix : tixs)
+                {
+                    g_sink += matched_bits(pubkey, targets[tix]);
+                }
+            }
+        });
+    }
+
+    // what tgen does per key, in its blocks of 16
+    {
+        std::vector<gej_t> pubs(16);
+        std::vector<ge_t> affine(16);
+
+        run_bench(args, "tgen_mul_gen_b16", 16, [&]()
+        {
+            for (auto ix = 0u; ix < 16; ++ix)
+            {
+                std::uint8_t priv[32];
+                std::generate(std::begin(priv), std::end(priv), [&rng]{ return (std::uint8_t)rng(); });
+                gej_mul_gen(pubs[ix], priv);
+            }
+            ge_set_gej_batch(affine.data(), pubs.data(), 16);
+            for (auto const & pub : affine)
+            {
+                std::uint8_t bytes[65];
+                ge_to_uncompressed(pub, bytes);
+                g_sink += bytes[1];
+            }
+        });
+    }
+
+    BN_CTX_free(ctx_p);
+    EC_GROUP_free(group_p);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,8 @@
+bench: $(OSSL_DIR)/libcrypto.a bench.cpp unaddr.cpp unaddr.hpp keygen.cpp keygen.hpp secp256k1.cpp secp256k1.hpp gen_table.cpp gen_table.hpp endomorphism.cpp endomorphism.hpp chacha20.cpp chacha20.hpp sha256_mb.cpp sha256_mb.hpp ripemd160_mb.cpp ripemd160_mb.hpp simd_u32.hpp target_index.cpp target_index.hpp exact_index.cpp exact_index.hpp window_scan.cpp window_scan.hpp cpu_dispatch.cpp cpu_dispatch.hpp pubkey_match.cpp near_index.cpp near_index.hpp longest_run.hpp pubkey_match.hpp ntohl.h fd_io.cpp fd_io.hpp bench.mk
+	$(CXX) \
+	bench.cpp unaddr.cpp keygen.cpp secp256k1.cpp gen_table.cpp endomorphism.cpp chacha20.cpp sha256_mb.cpp ripemd160_mb.cpp target_index.cpp exact_index.cpp window_scan.cpp cpu_dispatch.cpp pubkey_match.cpp near_index.cpp fd_io.cpp -o bench \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt -Wno-psabi \
+	$(OSSL_DIR)/libcrypto.a \
+	-I$(OSSL_DIR) \
+	-I$(OSSL_DIR)/include \
+	-O3
@@ -1,6 +1,6 @@
 bn_rand: bn_rand.cpp
 	$(CXX) bn_rand.cpp -o bn_rand \
-	-std=c++17 -march=native \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt \
 	$(OSSL_DIR)/libcrypto.a \
 	-I$(OSSL_DIR) \
 	-I$(OSSL_DIR)/include \
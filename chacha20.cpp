@@ -0,0 +1,66 @@
+#include "chacha20.hpp"
+
+
+static inline
+std::uint32_t rotl(std::uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+
+static inline
+void quarter_round(std::uint32_t (&x)[16], int a, int b, int c, int d)
+{
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 12);
+    x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+    x[c] += x[d]; x[b] = rotl(x[b] ^ x[c], 7);
+}
+
+
+void chacha20_block(
+    std::uint32_t const (&key)[8],
+    std::uint64_t counter,
+    std::uint64_t nonce,
+    std::uint8_t (&out)[64])
+{
+    // "expand 32-byte k"
+    std::uint32_t const input[16] =
+    {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3],
+        key[4], key[5], key[6], key[7],
+        (std::uint32_t)counter, (std::uint32_t)(counter >> 32),
+        (std::uint32_t)nonce, (std::uint32_t)(nonce >> 32),
+    };
+
+    std::uint32_t x[16];
+    for (auto ix = 0u; ix < 16; ++ix)
+    {
+        x[ix] = input[ix];
+    }
+
+    for (auto round = 0u; round < 10; ++round)
+    {
+        quarter_round(x, 0, 4, 8, 12);
+        quarter_round(x, 1, 5, 9, 13);
+        quarter_round(x, 2, 6, 10, 14);
+        quarter_round(x, 3, 7, 11, 15);
+
+        quarter_round(x, 0, 5, 10, 15);
+        quarter_round(x, 1, 6, 11, 12);
+        quarter_round(x, 2, 7, 8, 13);
+        quarter_round(x, 3, 4, 9, 14);
+    }
+
+    // little-endian serialization of the state words
+    for (auto ix = 0u; ix < 16; ++ix)
+    {
+        auto const word = x[ix] + input[ix];
+
+        out[4 * ix + 0] = word;
+        out[4 * ix + 1] = word >> 8;
+        out[4 * ix + 2] = word >> 16;
+        out[4 * ix + 3] = word >> 24;
+    }
+}
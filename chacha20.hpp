@@ -0,0 +1,18 @@
+#pragma once
+
+#ifndef CHACHA20_HPP
+#define CHACHA20_HPP
+
+#include <cstdint>
+
+
+// One 64-byte ChaCha20 keystream block, in the original 64-bit counter /
+// 64-bit nonce layout, 20 rounds.
+void chacha20_block(
+    std::uint32_t const (&key)[8],
+    std::uint64_t counter,
+    std::uint64_t nonce,
+    std::uint8_t (&out)[64]);
+
+
+#endif /* CHACHA20_HPP */
@@ -0,0 +1,61 @@
+#include "checkpoint.hpp"
+
+#include <cstdio>
+#include <cinttypes>
+
+
+bool checkpoint_save(std::string const & fname, checkpoint_t const & cp)
+{
+    auto const tmp_fname = fname + ".tmp";
+    auto * f_p = fopen(tmp_fname.c_str(), "w");
+
+    if (f_p == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(f_p, "seed %" PRIu64 "\n", cp.seed);
+    fprintf(f_p, "walk %" PRIu64 "\n", cp.walk_len);
+    for (auto six = 0u; six < cp.counters.size(); ++six)
+    {
+        fprintf(f_p, "stream %u %" PRIu64 " %" PRIu64 "\n", six, cp.counters[six], cp.ntried[six]);
+    }
+
+    bool const ok = (fflush(f_p) == 0) and not ferror(f_p);
+    fclose(f_p);
+
+    return ok and (rename(tmp_fname.c_str(), fname.c_str()) == 0);
+}
+
+
+bool checkpoint_load(std::string const & fname, checkpoint_t & cp)
+{
+    auto * f_p = fopen(fname.c_str(), "r");
+
+    if (f_p == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = (fscanf(f_p, " seed %" SCNu64, &cp.seed) == 1)
+        and (fscanf(f_p, " walk %" SCNu64, &cp.walk_len) == 1);
+
+    cp.counters.clear();
+    cp.ntried.clear();
+
+    unsigned int six = 0;
+    std::uint64_t counter = 0;
+    std::uint64_t ntried = 0;
+    while (ok and (fscanf(f_p, " stream %u %" SCNu64 " %" SCNu64, &six, &counter, &ntried) == 3))
+    {
+        // streams are listed in order
+        ok = six == cp.counters.size();
+        cp.counters.push_back(counter);
+        cp.ntried.push_back(ntried);
+    }
+
+    ok = ok and feof(f_p) and not cp.counters.empty();
+    fclose(f_p);
+
+    return ok;
+}
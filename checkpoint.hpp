@@ -0,0 +1,28 @@
+#pragma once
+
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+// Progress of a seeded run: the counter of the first untried candidate of
+// every stream, and how many points it tried so far in all the invocations
+// of the run, which -n counts down from. Saved as a small text file, written next to the final one and renamed over it so
+// that a run killed mid-save leaves the previous checkpoint intact.
+typedef struct
+{
+    std::uint64_t seed;
+    std::uint64_t walk_len;
+    std::vector<std::uint64_t> counters;    // one per stream
+    std::vector<std::uint64_t> ntried;      // one per stream
+} checkpoint_t;
+
+
+bool checkpoint_save(std::string const & fname, checkpoint_t const & cp);
+bool checkpoint_load(std::string const & fname, checkpoint_t & cp);
+
+
+#endif /* CHECKPOINT_HPP */
@@ -0,0 +1,83 @@
+#include "cpu_dispatch.hpp"
+
+#include <cstring>
+
+
+static char const * const KERNEL_NAMES[] = {"scalar", "avx2", "avx512"};
+
+
+static
+cpu_kernels_t detect()
+{
+    // also tells whether the OS saves the vector registers
+    __builtin_cpu_init();
+
+    if (not (__builtin_cpu_supports("avx2") and __builtin_cpu_supports("bmi") and __builtin_cpu_supports("bmi2")))
+    {
+        return CPU_KERNELS_SCALAR;
+    }
+
+    if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512bw") and __builtin_cpu_supports("avx512vl"))
+    {
+        return CPU_KERNELS_AVX512;
+    }
+
+    return CPU_KERNELS_AVX2;
+}
+
+
+static cpu_kernels_t const g_supported = detect();
+static cpu_kernels_t g_kernels = g_supported;
+static bool const g_vpopcntdq = (g_supported == CPU_KERNELS_AVX512) and __builtin_cpu_supports("avx512vpopcntdq");
+
+
+cpu_kernels_t cpu_kernels_supported()
+{
+    return g_supported;
+}
+
+
+cpu_kernels_t cpu_kernels()
+{
+    return g_kernels;
+}
+
+
+bool cpu_kernels_select(cpu_kernels_t kernels)
+{
+    if (kernels > g_supported)
+    {
+        return false;
+    }
+
+    g_kernels = kernels;
+
+    return true;
+}
+
+
+bool cpu_kernels_vpopcntdq()
+{
+    return g_vpopcntdq and (g_kernels == CPU_KERNELS_AVX512);
+}
+
+
+char const * cpu_kernels_name(cpu_kernels_t kernels)
+{
+    return KERNEL_NAMES[kernels];
+}
+
+
+bool cpu_kernels_parse(char const * name, cpu_kernels_t & kernels)
+{
+    for (auto ix = 0u; ix < sizeof (KERNEL_NAMES) / sizeof (KERNEL_NAMES[0]); ++ix)
+    {
+        if (std::strcmp(name, KERNEL_NAMES[ix]) == 0)
+        {
+            kernels = (cpu_kernels_t)ix;
+            return true;
+        }
+    }
+
+    return false;
+}
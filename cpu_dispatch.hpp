@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef CPU_DISPATCH_HPP
+#define CPU_DISPATCH_HPP
+
+
+// Instruction sets the vector kernels come in, each level a superset of the
+// ones before. The best the CPU supports is detected from cpuid at startup,
+// and every entry point with kernels of its own switches on cpu_kernels().
+typedef enum : unsigned int
+{
+    CPU_KERNELS_SCALAR = 0,
+    CPU_KERNELS_AVX2 = 1,       // and BMI1/2
+    CPU_KERNELS_AVX512 = 2,     // F, BW and VL
+} cpu_kernels_t;
+
+
+// the level the CPU supports
+cpu_kernels_t cpu_kernels_supported();
+
+// the level in use, the supported one unless lowered
+cpu_kernels_t cpu_kernels();
+
+// Use kernels, at most what the CPU supports; to be called before any
+// thread starts. False if the CPU lacks them.
+bool cpu_kernels_select(cpu_kernels_t kernels);
+
+// the avx512 kernels in use and the CPU counts bits in vectors too (VPOPCNTDQ)
+bool cpu_kernels_vpopcntdq();
+
+char const * cpu_kernels_name(cpu_kernels_t kernels);
+
+// "scalar", "avx2" or "avx512"
+bool cpu_kernels_parse(char const * name, cpu_kernels_t & kernels);
+
+
+#endif /* CPU_DISPATCH_HPP */
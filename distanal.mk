@@ -1,4 +1,4 @@
 distanal: distanal.cpp
 	$(CXX) distanal.cpp -o distanal \
-	-std=c++17 -march=native \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt \
 	-O3
@@ -0,0 +1,100 @@
+#include "endomorphism.hpp"
+#include "secp256k1.hpp"
+
+#include <cstring>
+#include <cstdint>
+
+
+// beta and beta^2 mod p
+static constexpr fe_t BETA[2] =
+{
+    fe_const(0x7AE96A2B657C0710ULL, 0x6E64479EAC3434E9ULL, 0x9CF0497512F58995ULL, 0xC1396C28719501EEULL),
+    fe_const(0x851695D49A83F8EFULL, 0x919BB86153CBCB16ULL, 0x630FB68AED0A766AULL, 0x3EC693D68E6AFA40ULL),
+};
+
+// lambda and lambda^2 mod n
+static char const * const LAMBDA_HEX[2] =
+{
+    "5363AD4CC05C30E0A5261C028812645A122E22EA20816678DF02967C1B23BD72",
+    "AC9C52B33FA3CF1F5AD9E3FD77ED9BA4A880B9FC8EC739C2E0CFC810B51283CE",
+};
+
+
+typedef struct
+{
+    BIGNUM * lambda[2];
+    BIGNUM * order;
+} scalar_consts_t;
+
+
+static
+scalar_consts_t scalar_consts()
+{
+    scalar_consts_t c = {{nullptr, nullptr}, nullptr};
+
+    BN_hex2bn(&c.lambda[0], LAMBDA_HEX[0]);
+    BN_hex2bn(&c.lambda[1], LAMBDA_HEX[1]);
+    BN_hex2bn(&c.order, SECP256K1_ORDER_HEX);
+
+    return c;
+}
+
+
+void endomorphism_expand(uncompressed_key_t * keys_p, std::size_t nkeys)
+{
+    for (std::size_t ix = 0; ix < nkeys; ++ix)
+    {
+        auto const & key = keys_p[ix];
+        auto const x = fe_from_bytes(key.data() + 1);
+
+        std::uint8_t neg_y[32];
+        fe_to_bytes(fe_neg(fe_from_bytes(key.data() + 33)), neg_y);
+
+        for (auto vix = 1u; vix < NVARIANTS; ++vix)
+        {
+            auto & out = keys_p[vix * nkeys + ix];
+
+            out[0] = 0x04;
+            if (vix % 3 == 0)
+            {
+                std::memcpy(out.data() + 1, key.data() + 1, 32);
+            }
+            else
+            {
+                fe_to_bytes(fe_mul(x, BETA[vix % 3 - 1]), out.data() + 1);
+            }
+            std::memcpy(out.data() + 33, vix < 3 ? key.data() + 33 : neg_y, 32);
+        }
+    }
+}
+
+
+bool endomorphism_private_key(BIGNUM const * k_p, unsigned int variant, BIGNUM * out_p, BN_CTX * ctx_p)
+{
+    // initialized once, thread-safely, and only read after
+    static scalar_consts_t const consts = scalar_consts();
+
+    if (variant >= NVARIANTS)
+    {
+        return false;
+    }
+
+    if (variant % 3 == 0)
+    {
+        if (BN_copy(out_p, k_p) == nullptr)
+        {
+            return false;
+        }
+    }
+    else if (not BN_mod_mul(out_p, k_p, consts.lambda[variant % 3 - 1], consts.order, ctx_p))
+    {
+        return false;
+    }
+
+    if ((variant >= 3) and not BN_is_zero(out_p))
+    {
+        return BN_sub(out_p, consts.order, out_p);
+    }
+
+    return true;
+}
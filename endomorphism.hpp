@@ -0,0 +1,34 @@
+#pragma once
+
+#ifndef ENDOMORPHISM_HPP
+#define ENDOMORPHISM_HPP
+
+#include "keygen.hpp"
+
+#include <cstddef>
+
+#include <openssl/bn.h>
+
+
+// secp256k1 has an efficiently computable endomorphism: for a point
+// P = (x, y) = k*G, the point (beta*x, y) is lambda*P, beta and lambda
+// being cube roots of unity modulo p and n. Together with the negation
+// (x, -y) = -P, every computed point yields six public keys,
+//
+//   variant v:  x * beta^(v % 3),  y negated when v >= 3,
+//   private key k * lambda^(v % 3) mod n, negated mod n when v >= 3,
+//
+// at the cost of two field multiplications and a subtraction per point,
+// without another scalar multiplication. Variant 0 is the point itself.
+static constexpr unsigned int NVARIANTS = 6;
+
+
+// Fill keys_p[v * nkeys + ix], v = 1..NVARIANTS-1, with the variants of
+// the uncompressed keys keys_p[0, nkeys).
+void endomorphism_expand(uncompressed_key_t * keys_p, std::size_t nkeys);
+
+// Private key of the given variant of the key k_p, into out_p.
+bool endomorphism_private_key(BIGNUM const * k_p, unsigned int variant, BIGNUM * out_p, BN_CTX * ctx_p);
+
+
+#endif /* ENDOMORPHISM_HPP */
@@ -0,0 +1,145 @@
+#include "exact_index.hpp"
+
+#include "simd_u32.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <immintrin.h>
+
+
+// filter bits per target, for about 0.1 % false positives
+static constexpr std::size_t BITS_PER_TARGET = 16;
+
+
+static inline
+exact_index_entry_t entry_of(hash_4_simd_t const & h, std::uint32_t tix)
+{
+    exact_index_entry_t e;
+    std::memcpy(e.key, h.h160.data(), sizeof (e.key));
+    std::memcpy(&e.key_lo, h.h160.data() + sizeof (e.key), sizeof (e.key_lo));
+    e.key[0] = __builtin_bswap64(e.key[0]);
+    e.key[1] = __builtin_bswap64(e.key[1]);
+    e.key_lo = __builtin_bswap32(e.key_lo);
+    e.tix = tix;
+
+    return e;
+}
+
+
+// hash order, the key alone
+static inline
+bool key_less(exact_index_entry_t const & a, exact_index_entry_t const & b)
+{
+    if (a.key[0] != b.key[0])
+    {
+        return a.key[0] < b.key[0];
+    }
+    if (a.key[1] != b.key[1])
+    {
+        return a.key[1] < b.key[1];
+    }
+    return a.key_lo < b.key_lo;
+}
+
+
+static inline
+bool key_equal(exact_index_entry_t const & a, exact_index_entry_t const & b)
+{
+    return (a.key[0] == b.key[0]) and (a.key[1] == b.key[1]) and (a.key_lo == b.key_lo);
+}
+
+
+// in-order successor of node k of the n-node Eytzinger tree, 0 past the last
+static inline
+std::size_t successor(std::size_t k, std::size_t n)
+{
+    if (2 * k + 1 <= n)
+    {
+        k = 2 * k + 1;
+        while (2 * k <= n)
+        {
+            k = 2 * k;
+        }
+        return k;
+    }
+
+    // up past the right children, then once more
+    while (k & 1)
+    {
+        k >>= 1;
+    }
+    return k >> 1;
+}
+
+
+SIMD_AVX2
+bool exact_index_test_x8(exact_index_block_t const & block, std::uint32_t x)
+{
+    auto const salts = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(EXACT_INDEX_SALTS));
+    auto const shifts = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32(x), salts), 27);
+    auto const mask = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+
+    return _mm256_testc_si256(_mm256_load_si256(reinterpret_cast<__m256i const *>(block.lanes)), mask);
+}
+
+
+void exact_index_build(exact_index_t & index, hash_4_simd_t const * hashes_p, std::size_t ntargets)
+{
+    index.kernels = cpu_kernels();
+    index.nblocks = std::max<std::size_t>(1, (ntargets * BITS_PER_TARGET + 255) / 256);
+    index.blocks.assign(index.nblocks, exact_index_block_t{});
+
+    for (std::size_t tix = 0; tix < ntargets; ++tix)
+    {
+        auto & block = index.blocks[exact_index_block_ix(index, hashes_p[tix])];
+        auto const x = exact_index_bits_of(hashes_p[tix]);
+        for (auto lane = 0u; lane < 8; ++lane)
+        {
+            block.lanes[lane] |= 1u << ((x * EXACT_INDEX_SALTS[lane]) >> 27);
+        }
+    }
+
+    // sorted, ties by target index, then laid out by an in-order walk of the tree
+    std::vector<exact_index_entry_t> sorted(ntargets);
+    for (std::size_t tix = 0; tix < ntargets; ++tix)
+    {
+        sorted[tix] = entry_of(hashes_p[tix], tix);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), key_less);
+
+    index.entries.assign(ntargets + 1, exact_index_entry_t{});
+
+    std::size_t k = 1;
+    while (2 * k <= ntargets)
+    {
+        k = 2 * k;
+    }
+    for (auto const & e : sorted)
+    {
+        index.entries[k] = e;
+        k = successor(k, ntargets);
+    }
+}
+
+
+void exact_index_search(exact_index_t const & index, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    auto const n = index.entries.size() - 1;
+    auto const * entries_p = index.entries.data();
+    auto const key = entry_of(h160, 0);
+
+    // down to a leaf, left when not below the key: the lower bound is the
+    // last node left from, found by undoing the right turns taken since
+    std::size_t k = 1;
+    while (k <= n)
+    {
+        k = 2 * k + key_less(entries_p[k], key);
+    }
+    k >>= __builtin_ffsll(~k);
+
+    for (/* nop */; (k != 0) and key_equal(entries_p[k], key); k = successor(k, n))
+    {
+        tixs.push_back(entries_p[k].tix);
+    }
+}
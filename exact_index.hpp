@@ -0,0 +1,122 @@
+#pragma once
+
+#ifndef EXACT_INDEX_HPP
+#define EXACT_INDEX_HPP
+
+#include "ripemd160_mb.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// A target hash160 as big-endian words, so that integer comparisons give
+// memcmp order, and the index of its target. 24 bytes.
+typedef struct
+{
+    std::uint64_t key[2];
+    std::uint32_t key_lo;
+    std::uint32_t tix;
+} exact_index_entry_t;
+
+static_assert(sizeof (exact_index_entry_t) == 24u);
+
+typedef struct alignas(32)
+{
+    std::uint32_t lanes[8];
+} exact_index_block_t;
+
+
+// Index of target hash160s for whole-hash matches, which stays about as
+// fast for tens of millions of targets as for a few.
+//
+// A split block Bloom filter answers first, with a single 32-byte block per
+// hash: one bit in each of its eight 32-bit lanes, tested at once with
+// AVX2 when the CPU has it, a single cache miss. Only the hashes it lets through, about
+// one in a thousand when not an actual target, are searched for in the
+// sorted entries laid out in Eytzinger (breadth-first) order, entries[1]
+// the root, whose top levels share a few cache lines.
+//
+// About 26 bytes per target: 2 for the filter, 24 for an entry.
+typedef struct
+{
+    cpu_kernels_t kernels;
+
+    std::size_t nblocks;
+    std::vector<exact_index_block_t> blocks;
+
+    // entries[1 .. ntargets], entries[0] unused
+    std::vector<exact_index_entry_t> entries;
+} exact_index_t;
+
+
+void exact_index_build(exact_index_t & index, hash_4_simd_t const * hashes_p, std::size_t ntargets);
+
+
+// the block of h160 and the bit the filter sets in each of its lanes
+static inline
+std::size_t exact_index_block_ix(exact_index_t const & index, hash_4_simd_t const & h160)
+{
+    std::uint64_t x;
+    __builtin_memcpy(&x, h160.h160.data(), sizeof (x));
+
+    // x * nblocks / 2^64, for any number of blocks
+    return ((unsigned __int128)x * index.nblocks) >> 64;
+}
+
+static constexpr std::uint32_t EXACT_INDEX_SALTS[8] = {
+    0x47B6137B, 0x44974D91, 0x8824AD5B, 0xA2B7289D, 0x705495C7, 0x2DF1424B, 0x9EFC4947, 0x5C6BFB31};
+
+static inline
+std::uint32_t exact_index_bits_of(hash_4_simd_t const & h160)
+{
+    std::uint32_t x;
+    __builtin_memcpy(&x, h160.h160.data() + 8, sizeof (x));
+
+    return x;
+}
+
+static inline
+bool exact_index_test_x1(exact_index_block_t const & block, std::uint32_t x)
+{
+    std::uint32_t all = 1;
+    for (auto lane = 0u; lane < 8; ++lane)
+    {
+        all &= block.lanes[lane] >> ((x * EXACT_INDEX_SALTS[lane]) >> 27);
+    }
+
+    return all & 1;
+}
+
+bool exact_index_test_x8(exact_index_block_t const & block, std::uint32_t x);
+
+
+static inline
+void exact_index_prefetch(exact_index_t const & index, hash_4_simd_t const & h160)
+{
+    __builtin_prefetch(&index.blocks[exact_index_block_ix(index, h160)], 0, 3);
+}
+
+
+// Indices of the targets whose hash160 is h160, in ascending order, after
+// a search of the entries that the filter spares almost every candidate.
+void exact_index_search(exact_index_t const & index, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs);
+
+static inline
+void exact_index_lookup(exact_index_t const & index, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    tixs.clear();
+
+    auto const & block = index.blocks[exact_index_block_ix(index, h160)];
+    auto const x = exact_index_bits_of(h160);
+    auto const maybe = (index.kernels >= CPU_KERNELS_AVX2) ? exact_index_test_x8(block, x) : exact_index_test_x1(block, x);
+
+    if (__builtin_expect(maybe, 0))
+    {
+        exact_index_search(index, h160, tixs);
+    }
+}
+
+
+#endif /* EXACT_INDEX_HPP */
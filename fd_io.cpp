@@ -0,0 +1,29 @@
+#include "fd_io.hpp"
+
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+
+
+bool fd_write_all(int fd, void const * p, std::size_t n)
+{
+    auto const * bytes_p = static_cast<std::uint8_t const *>(p);
+
+    while (n != 0)
+    {
+        auto const rv = write(fd, bytes_p, n);
+        if (rv < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes_p += rv;
+        n -= rv;
+    }
+
+    return true;
+}
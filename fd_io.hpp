@@ -0,0 +1,13 @@
+#pragma once
+
+#ifndef FD_IO_HPP
+#define FD_IO_HPP
+
+#include <cstddef>
+
+
+// Writes all n bytes at p, retrying short and interrupted writes, false with errno set on failure.
+bool fd_write_all(int fd, void const * p, std::size_t n);
+
+
+#endif /* FD_IO_HPP */
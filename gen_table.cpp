@@ -0,0 +1,255 @@
+#include "gen_table.hpp"
+#include "fd_io.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+static constexpr char GEN_TABLE_MAGIC[8] = {'S', 'E', 'C', 'P', 'G', 'T', 'A', 'B'};
+static constexpr std::uint32_t GEN_TABLE_VERSION = 1;
+
+static constexpr std::size_t HUGE_PAGE_SIZE = std::size_t{2} << 20;
+
+
+static
+bool read_all(int fd, void * p, std::size_t n, off_t offset)
+{
+    auto * bytes_p = static_cast<std::uint8_t *>(p);
+
+    while (n != 0)
+    {
+        auto const rv = pread(fd, bytes_p, n, offset);
+        if (rv <= 0)
+        {
+            if ((rv < 0) and (errno == EINTR))
+            {
+                continue;
+            }
+            return false;
+        }
+        bytes_p += rv;
+        offset += rv;
+        n -= rv;
+    }
+
+    return true;
+}
+
+
+// FNV-1a style multiply-xor over 64-bit words, in four independent lanes
+// to stay far from the multiplier's latency: some ms for a whole table
+static
+std::uint64_t checksum(ge_storage_t const * points_p, std::size_t npoints)
+{
+    auto constexpr PRIME = 0x100000001B3ULL;
+    std::uint64_t h[4] = {0xCBF29CE484222325ULL, 1, 2, 3};
+
+    for (std::size_t ix = 0; ix < npoints; ++ix)
+    {
+        auto const & point = points_p[ix];
+        for (auto lix = 0u; lix < 4; ++lix)
+        {
+            h[lix] = ((h[lix] ^ point.x[lix]) * PRIME) ^ point.y[lix];
+        }
+    }
+
+    return ((h[0] * PRIME ^ h[1]) * PRIME ^ h[2]) * PRIME ^ h[3];
+}
+
+
+// written next to fname and renamed over it, so that concurrent launches
+// or a build killed midway never leave a partial table behind
+static
+bool build(std::string const & fname)
+{
+    auto const nbits = GEN_TABLE_FILE_WINDOW_NBITS;
+    auto const npoints = gen_table_npoints(nbits);
+
+    fprintf(stderr, "[i] Building generator table %s, done once\n", fname.c_str());
+
+    std::vector<ge_storage_t> points(npoints);
+    gen_table_fill(nbits, points.data());
+
+    gen_table_header_t header{};
+    std::memcpy(header.magic, GEN_TABLE_MAGIC, sizeof (header.magic));
+    header.version = GEN_TABLE_VERSION;
+    header.window_nbits = nbits;
+    header.npoints = npoints;
+    header.checksum = checksum(points.data(), npoints);
+
+    auto const tmp_fname = fname + ".tmp." + std::to_string(getpid());
+    auto const fd = open(tmp_fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "[!] Failed to create generator table %s: %s\n", tmp_fname.c_str(), strerror(errno));
+        return false;
+    }
+
+    bool ok = fd_write_all(fd, &header, sizeof (header))
+        and fd_write_all(fd, points.data(), points.size() * sizeof (points[0]))
+        and (fsync(fd) == 0);
+    ok = (close(fd) == 0) and ok;
+    ok = ok and (rename(tmp_fname.c_str(), fname.c_str()) == 0);
+
+    if (not ok)
+    {
+        fprintf(stderr, "[!] Failed to write generator table %s: %s\n", fname.c_str(), strerror(errno));
+        unlink(tmp_fname.c_str());
+    }
+
+    return ok;
+}
+
+
+static
+bool same_point(ge_t const & a, ge_storage_t const & b)
+{
+    ge_storage_t a_storage;
+    ge_to_storage(a, a_storage);
+
+    return std::memcmp(&a_storage, &b, sizeof (b)) == 0;
+}
+
+
+// the points are the ones written, and every window's first entry is its
+// base, 2^window_nbits times the previous one's: a table for this curve
+static
+bool check_points(gen_table_t const & table, std::uint64_t expected_checksum)
+{
+    auto const nbits = table.window_nbits;
+
+    if (checksum(table.points_p, gen_table_npoints(nbits)) != expected_checksum)
+    {
+        return false;
+    }
+
+    gej_t base_j;
+    gej_set_ge(base_j, SECP256K1_G);
+
+    for (std::size_t wix = 0; wix < 256 / nbits; ++wix)
+    {
+        ge_t base;
+        ge_set_gej(base, base_j);
+        if (not same_point(base, table.points_p[(wix << nbits) + 1]))
+        {
+            return false;
+        }
+
+        for (auto dix = 0u; dix < nbits; ++dix)
+        {
+            gej_double(base_j, base_j);
+        }
+    }
+
+    return true;
+}
+
+
+// the whole file, in huge pages if possible
+static
+void * read_huge(int fd, std::size_t size)
+{
+    auto const len = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+    auto * p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p == MAP_FAILED)
+    {
+        // no reserved huge pages, ask for transparent ones
+        p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        madvise(p, len, MADV_HUGEPAGE);
+    }
+
+    if (not read_all(fd, p, size, 0) or (mprotect(p, len, PROT_READ) != 0))
+    {
+        munmap(p, len);
+        return nullptr;
+    }
+
+    return p;
+}
+
+
+bool gen_table_open(std::string const & fname, bool huge_pages)
+{
+    auto fd = open(fname.c_str(), O_RDONLY);
+
+    if ((fd < 0) and (errno == ENOENT))
+    {
+        if (not build(fname))
+        {
+            return false;
+        }
+        fd = open(fname.c_str(), O_RDONLY);
+    }
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "[!] Failed to open generator table %s: %s\n", fname.c_str(), strerror(errno));
+        return false;
+    }
+
+    gen_table_header_t header;
+    struct stat st;
+    bool const header_ok = (fstat(fd, &st) == 0)
+        and read_all(fd, &header, sizeof (header), 0)
+        and (std::memcmp(header.magic, GEN_TABLE_MAGIC, sizeof (header.magic)) == 0)
+        and (header.version == GEN_TABLE_VERSION)
+        and ((header.window_nbits == 4) or (header.window_nbits == 8) or (header.window_nbits == 16))
+        and (header.npoints == gen_table_npoints(header.window_nbits))
+        and ((std::uint64_t)st.st_size == sizeof (header) + header.npoints * sizeof (ge_storage_t));
+
+    if (not header_ok)
+    {
+        fprintf(stderr, "[!] %s is not a generator table of this version\n", fname.c_str());
+        close(fd);
+        return false;
+    }
+
+    auto const size = (std::size_t)st.st_size;
+    void * p = nullptr;
+
+    if (huge_pages)
+    {
+        p = read_huge(fd, size);
+    }
+    else
+    {
+        p = mmap(nullptr, size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+        p = (p == MAP_FAILED) ? nullptr : p;
+    }
+    close(fd);
+
+    if (p == nullptr)
+    {
+        fprintf(stderr, "[!] Failed to map generator table %s: %s\n", fname.c_str(), strerror(errno));
+        return false;
+    }
+
+    gen_table_t const table =
+    {
+        header.window_nbits,
+        reinterpret_cast<ge_storage_t const *>(static_cast<std::uint8_t const *>(p) + sizeof (header)),
+    };
+
+    if (not check_points(table, header.checksum))
+    {
+        fprintf(stderr, "[!] Generator table %s is corrupt\n", fname.c_str());
+        return false;
+    }
+
+    gen_table_install(table);
+
+    return true;
+}
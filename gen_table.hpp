@@ -0,0 +1,43 @@
+#pragma once
+
+#ifndef GEN_TABLE_HPP
+#define GEN_TABLE_HPP
+
+#include "secp256k1.hpp"
+
+#include <string>
+
+
+// Generator tables too big to build at every launch: 16-bit windows, 16
+// mixed additions per k G, 64 MiB. A table is built once into a file, a
+// 64-byte header followed by the points in storage form, and memory-mapped
+// read-only from then on, so that every process and thread shares the same
+// page cache copy.
+//
+// With huge_pages the table is instead read into a private mapping backed
+// by huge pages where the system has them (MAP_HUGETLB, else transparent
+// huge pages), which spares the TLB misses of the scattered lookups at the
+// price of a copy per process.
+static constexpr unsigned int GEN_TABLE_FILE_WINDOW_NBITS = 16;
+
+typedef struct
+{
+    char magic[8];                  // "SECPGTAB"
+    std::uint32_t version;
+    std::uint32_t window_nbits;
+    std::uint64_t npoints;
+    std::uint64_t checksum;         // of the points, see gen_table.cpp
+    std::uint8_t reserved[32];
+} gen_table_header_t;
+
+static_assert(sizeof (gen_table_header_t) == 64);
+
+
+// Map the table in fname, building and writing it first if there is no such
+// file, and install it for gej_mul_gen. The mapping lives as long as the
+// process. False, with the reason on stderr, if the file cannot be written
+// or read or is not a valid table.
+bool gen_table_open(std::string const & fname, bool huge_pages);
+
+
+#endif /* GEN_TABLE_HPP */
@@ -0,0 +1,400 @@
+#include "hit_writer.hpp"
+#include "keygen.hpp"
+#include "endomorphism.hpp"
+#include "fd_io.hpp"
+
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <openssl/crypto.h>
+
+#include <unistd.h>
+
+
+// records a worker can have in flight before it has to wait for the writer
+static constexpr std::uint64_t RING_CAPACITY = 4096;
+static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0);
+
+// output is handed to write(2) at least every this many bytes
+static constexpr std::size_t OUTPUT_CAPACITY = 1u << 20;
+
+
+// Single-producer single-consumer ring. head is only written by the
+// producer, tail only by the consumer, each on its own cache line.
+typedef struct alignas(64)
+{
+    std::atomic<std::uint64_t> head;
+    alignas(64) std::atomic<std::uint64_t> tail;
+    alignas(64) hit_record_t slots[RING_CAPACITY];
+} hit_ring_t;
+
+
+struct hit_writer_s
+{
+    int fd;
+    bool binary;
+    std::size_t record_size;
+    unsigned int flush_ms;
+    hit_format_fn_t format;
+
+    std::unique_ptr<hit_ring_t[]> rings;
+    unsigned int nrings;
+
+    // counted by the writer thread as records are drained
+    std::unique_ptr<std::atomic<std::uint64_t>[]> target_nhits;
+    std::size_t ntargets;
+
+    std::atomic<bool> stop;
+
+    // hit_writer_sync() requests, and the last one the writer thread has completed
+    std::atomic<std::uint64_t> sync_requested;
+    std::atomic<std::uint64_t> sync_done;
+
+    std::thread thread;
+};
+
+
+hit_stream_header_t hit_stream_header(
+    hit_stream_kind_t kind,
+    std::uint8_t flags,
+    std::uint32_t ntargets,
+    std::uint64_t seed,
+    std::uint64_t walk_len)
+{
+    hit_stream_header_t header;
+
+    std::memcpy(header.magic, "NDGH", sizeof (header.magic));
+    header.version = 3;
+    header.kind = kind;
+    header.record_size = (flags & HIT_STREAM_SEEDED) ? HIT_RECORD_COORD_SIZE : sizeof (hit_record_t);
+    header.flags = flags;
+    header.ntargets = ntargets;
+    header.seed = seed;
+    header.walk_len = walk_len;
+
+    return header;
+}
+
+
+bool hit_stream_header_valid(hit_stream_header_t const & header)
+{
+    return std::memcmp(header.magic, "NDGH", sizeof (header.magic)) == 0
+        and header.version == 3
+        and header.record_size == ((header.flags & HIT_STREAM_SEEDED) ? HIT_RECORD_COORD_SIZE : sizeof (hit_record_t))
+        and (header.kind == HIT_STREAM_MAIN or header.kind == HIT_STREAM_ALADDIN);
+}
+
+
+void hit_record_set_private_key(hit_record_t & record, BIGNUM const * priv_p)
+{
+    std::memset(record.priv, 0, sizeof (record.priv));
+    BN_bn2bin(priv_p, record.priv + sizeof (record.priv) - BN_num_bytes(priv_p));
+}
+
+
+bool hit_record_resolve(hit_record_t & record, std::uint64_t seed, std::uint64_t walk_len)
+{
+    if (not (record.flags & HIT_RECORD_COORD))
+    {
+        return true;
+    }
+
+    thread_local BN_CTX * ctx_p = BN_CTX_new();
+
+    auto * priv_as_bn_p = BN_new();
+    bool const ok = (priv_as_bn_p != nullptr)
+        and keygen_replay(seed, record.coord.stream, walk_len, record.coord.counter, priv_as_bn_p)
+        and ((record.coord.variant == 0)
+            or endomorphism_private_key(priv_as_bn_p, record.coord.variant, priv_as_bn_p, ctx_p));
+
+    if (ok)
+    {
+        record.flags &= ~HIT_RECORD_COORD;
+        hit_record_set_private_key(record, priv_as_bn_p);
+    }
+    BN_free(priv_as_bn_p);
+
+    return ok;
+}
+
+
+static
+void append_private_key_hex(hit_record_t const & record, std::string & line)
+{
+    // through BN_bn2hex so that the text is exactly what the tools always printed
+    auto * priv_as_bn_p = BN_bin2bn(record.priv, sizeof (record.priv), nullptr);
+    auto * hex_p = BN_bn2hex(priv_as_bn_p);
+
+    line += hex_p;
+
+    OPENSSL_free(hex_p);
+    BN_free(priv_as_bn_p);
+}
+
+
+void hit_format_main(hit_record_t const & record, std::string_view address, bool with_encoding, std::string & line)
+{
+    char buf[16];
+    char const * encoding = (record.flags & HIT_RECORD_COMPRESSED) ? "\tc" : "\tu";
+
+    if (record.score == 160)
+    {
+        line += "wut ??? ";
+        line += address;
+        line += '\t';
+        append_private_key_hex(record, line);
+        if (with_encoding)
+        {
+            line += encoding;
+        }
+        line += '\n';
+    }
+
+    line += address;
+    snprintf(buf, sizeof (buf), "\t%03u\t%03u\t", record.score, record.offset);
+    line += buf;
+    append_private_key_hex(record, line);
+    if (with_encoding)
+    {
+        line += encoding;
+    }
+    line += '\n';
+}
+
+
+void hit_format_aladdin(hit_record_t const & record, std::string const & repr, bool with_pubkey, std::string & line)
+{
+    char buf[16];
+
+    line += repr;
+    snprintf(buf, sizeof (buf), "\t%03u\t", record.score);
+    line += buf;
+    append_private_key_hex(record, line);
+
+    if (with_pubkey)
+    {
+        // the record only carries the private key, the public key is derived again here
+        static char const HEX[] = "0123456789ABCDEF";
+
+        gej_t pub_j;
+        ge_t pub;
+        std::uint8_t pub_bytes[65];
+        gej_mul_gen(pub_j, record.priv);
+        ge_set_gej(pub, pub_j);
+        ge_to_uncompressed(pub, pub_bytes);
+
+        // x and y only, as aladdin prints them, without the 04 header byte
+        line += '\t';
+        for (auto ix = 1u; ix < sizeof (pub_bytes); ++ix)
+        {
+            line += HEX[pub_bytes[ix] >> 4];
+            line += HEX[pub_bytes[ix] & 0xF];
+        }
+    }
+
+    line += '\n';
+}
+
+
+// hands all of out to write(2) and empties it
+static
+void flush_out(int fd, std::string & out)
+{
+    if (not fd_write_all(fd, out.data(), out.size()))
+    {
+        fprintf(stderr, "[!] Failed to write hits: %s\n", strerror(errno));
+    }
+
+    out.clear();
+}
+
+
+static
+void writer_loop(hit_writer_t & writer)
+{
+    using clock = std::chrono::steady_clock;
+
+    std::string out;
+    out.reserve(OUTPUT_CAPACITY + 4096);
+
+    auto t_flush = clock::now();
+
+    for (;;)
+    {
+        // read before draining: everything pushed before stop was raised or a sync was
+        // requested gets drained below
+        bool const stopping = writer.stop.load(std::memory_order_acquire);
+        auto const sync_requested = writer.sync_requested.load(std::memory_order_acquire);
+        bool const syncing = sync_requested != writer.sync_done.load(std::memory_order_relaxed);
+        std::uint64_t ndrained = 0;
+
+        for (auto rix = 0u; rix < writer.nrings; ++rix)
+        {
+            auto & ring = writer.rings[rix];
+            auto const head = ring.head.load(std::memory_order_acquire);
+            auto tail = ring.tail.load(std::memory_order_relaxed);
+
+            for (/* nop */; tail != head; ++tail)
+            {
+                auto const & record = ring.slots[tail % RING_CAPACITY];
+
+                if (record.tix < writer.ntargets)
+                {
+                    auto & n = writer.target_nhits[record.tix];
+                    n.store(n.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                }
+
+                if (writer.binary)
+                {
+                    out.append((char const *)&record, writer.record_size);
+                }
+                else
+                {
+                    writer.format(record, out);
+                }
+                ++ndrained;
+
+                if (out.size() >= OUTPUT_CAPACITY)
+                {
+                    flush_out(writer.fd, out);
+                    t_flush = clock::now();
+                }
+            }
+            ring.tail.store(tail, std::memory_order_release);
+        }
+
+        auto const now = clock::now();
+        if (not out.empty()
+            and (writer.flush_ms == 0 or stopping or syncing or now - t_flush >= std::chrono::milliseconds(writer.flush_ms)))
+        {
+            flush_out(writer.fd, out);
+            t_flush = now;
+        }
+        if (syncing)
+        {
+            writer.sync_done.store(sync_requested, std::memory_order_release);
+        }
+
+        if (ndrained == 0)
+        {
+            if (stopping)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+
+hit_writer_t * hit_writer_new(
+    unsigned int nproducers,
+    std::size_t ntargets,
+    int fd,
+    std::optional<hit_stream_header_t> const & maybe_binary_header,
+    unsigned int flush_ms,
+    hit_format_fn_t format)
+{
+    auto * writer_p = new hit_writer_t;
+
+    writer_p->fd = fd;
+    writer_p->binary = maybe_binary_header.has_value();
+    writer_p->record_size = maybe_binary_header ? maybe_binary_header->record_size : 0;
+    writer_p->flush_ms = flush_ms;
+    writer_p->format = std::move(format);
+    writer_p->rings.reset(new hit_ring_t[nproducers]);
+    writer_p->nrings = nproducers;
+    writer_p->target_nhits.reset(new std::atomic<std::uint64_t>[ntargets]);
+    writer_p->ntargets = ntargets;
+    writer_p->stop = false;
+    writer_p->sync_requested = 0;
+    writer_p->sync_done = 0;
+
+    for (auto rix = 0u; rix < nproducers; ++rix)
+    {
+        writer_p->rings[rix].head = 0;
+        writer_p->rings[rix].tail = 0;
+    }
+    for (std::size_t tix = 0; tix < ntargets; ++tix)
+    {
+        writer_p->target_nhits[tix] = 0;
+    }
+
+    if (maybe_binary_header)
+    {
+        std::string out((char const *)&*maybe_binary_header, sizeof (hit_stream_header_t));
+        flush_out(fd, out);
+    }
+
+    writer_p->thread = std::thread(writer_loop, std::ref(*writer_p));
+
+    return writer_p;
+}
+
+
+void hit_writer_push(hit_writer_t & writer, unsigned int producer, hit_record_t const & record)
+{
+    auto & ring = writer.rings[producer];
+    auto const head = ring.head.load(std::memory_order_relaxed);
+
+    // full ring: hits are never dropped, the worker waits for the writer instead
+    while (head - ring.tail.load(std::memory_order_acquire) == RING_CAPACITY)
+    {
+        std::this_thread::yield();
+    }
+
+    ring.slots[head % RING_CAPACITY] = record;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+
+std::uint64_t hit_writer_nhits(hit_writer_t const & writer)
+{
+    std::uint64_t rv = 0;
+    for (auto rix = 0u; rix < writer.nrings; ++rix)
+    {
+        rv += writer.rings[rix].head.load(std::memory_order_relaxed);
+    }
+    return rv;
+}
+
+
+void hit_writer_target_nhits(hit_writer_t const & writer, std::vector<std::uint64_t> & nhits)
+{
+    nhits.resize(writer.ntargets);
+    for (std::size_t tix = 0; tix < writer.ntargets; ++tix)
+    {
+        nhits[tix] = writer.target_nhits[tix].load(std::memory_order_relaxed);
+    }
+}
+
+
+void hit_writer_sync(hit_writer_t & writer)
+{
+    auto const ticket = writer.sync_requested.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    while (writer.sync_done.load(std::memory_order_acquire) < ticket)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+
+void hit_writer_free(hit_writer_t * writer_p)
+{
+    if (writer_p == nullptr)
+    {
+        return;
+    }
+
+    writer_p->stop.store(true, std::memory_order_release);
+    writer_p->thread.join();
+
+    delete writer_p;
+}
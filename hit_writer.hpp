@@ -0,0 +1,139 @@
+#pragma once
+
+#ifndef HIT_WRITER_HPP
+#define HIT_WRITER_HPP
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+#include <openssl/bn.h>
+
+
+// Where a candidate of a seeded run came from, see keygen_t; the seed is
+// the same for the whole run and lives in the stream header.
+typedef struct __attribute__((packed))
+{
+    std::uint64_t counter;
+    std::uint32_t stream;
+    std::uint32_t variant;  // of the key of the point, see endomorphism.hpp
+} key_coord_t;
+static_assert(sizeof (key_coord_t) == 16u);
+
+
+enum : std::uint8_t
+{
+    HIT_RECORD_COORD = 1 << 0,  // the record holds coord instead of priv
+    HIT_RECORD_COMPRESSED = 1 << 1,  // main: the hash of the compressed public key matched
+};
+
+// Fixed-size binary record of a single hit.
+typedef struct __attribute__((packed))
+{
+    std::uint32_t tix;      // index into the targets as main sorts them by hash160, or in file order for aladdin
+    std::uint16_t score;    // main: matched run length, aladdin: number of matched bits
+    std::uint8_t offset;    // main: bit offset of the matched run
+    std::uint8_t flags;     // HIT_RECORD_* flags
+    union
+    {
+        std::uint8_t priv[32];  // private key, big-endian
+        key_coord_t coord;
+    };
+} hit_record_t;
+static_assert(sizeof (hit_record_t) == 40u);
+
+// records of seeded runs stop after the coordinates
+static constexpr std::size_t HIT_RECORD_COORD_SIZE = offsetof(hit_record_t, coord) + sizeof (key_coord_t);
+
+
+enum hit_stream_kind_t : std::uint8_t
+{
+    HIT_STREAM_MAIN = 0,
+    HIT_STREAM_ALADDIN = 1,
+};
+
+enum : std::uint8_t
+{
+    HIT_STREAM_WITH_PUBKEY = 1 << 0,
+    HIT_STREAM_SEEDED = 1 << 1,     // records are HIT_RECORD_COORD_SIZE long and hold coordinates
+    HIT_STREAM_COMPRESSED = 1 << 2, // main: compressed public keys were hashed too, lines name the encoding
+};
+
+// Header of a binary hit stream, followed by record_size-long prefixes of
+// hit_record_t records.
+typedef struct __attribute__((packed))
+{
+    char magic[4];          // "NDGH"
+    std::uint8_t version;   // 3, main target indices into targets sorted by hash160
+    std::uint8_t kind;      // hit_stream_kind_t
+    std::uint8_t record_size;
+    std::uint8_t flags;     // HIT_STREAM_* flags
+    std::uint32_t ntargets;
+    std::uint64_t seed;     // seeded runs only, as keygen_t
+    std::uint64_t walk_len;
+} hit_stream_header_t;
+static_assert(sizeof (hit_stream_header_t) == 28u);
+
+hit_stream_header_t hit_stream_header(
+    hit_stream_kind_t kind,
+    std::uint8_t flags,
+    std::uint32_t ntargets,
+    std::uint64_t seed = 0,
+    std::uint64_t walk_len = 0);
+bool hit_stream_header_valid(hit_stream_header_t const & header);
+
+
+void hit_record_set_private_key(hit_record_t & record, BIGNUM const * priv_p);
+
+// Replace the coordinates of a seeded hit with its private key, that of the
+// variant the coordinates name.
+bool hit_record_resolve(hit_record_t & record, std::uint64_t seed, std::uint64_t walk_len);
+
+// The TSV lines main and aladdin print for a hit, appended to line. With
+// with_encoding main lines end in a column telling which encoding of the
+// public key matched, u(ncompressed) or c(ompressed).
+void hit_format_main(hit_record_t const & record, std::string_view address, bool with_encoding, std::string & line);
+void hit_format_aladdin(hit_record_t const & record, std::string const & repr, bool with_pubkey, std::string & line);
+
+
+// Asynchronous hit writer.
+//
+// Every producer (worker thread) owns a lock-free single-producer
+// single-consumer ring of records. A dedicated writer thread drains the
+// rings into a large output buffer, either as raw records after a stream
+// header or formatted as TSV text (format gets to resolve coordinates), and hands the buffer to write(2) when it
+// fills up or flush_ms have passed since the last flush (0: after every
+// drained batch). Workers never format, allocate or make a syscall for a
+// hit; they only block if their ring is full.
+using hit_format_fn_t = std::function<void(hit_record_t const &, std::string &)>;
+
+typedef struct hit_writer_s hit_writer_t;
+
+hit_writer_t * hit_writer_new(
+    unsigned int nproducers,
+    std::size_t ntargets,
+    int fd,
+    std::optional<hit_stream_header_t> const & maybe_binary_header,
+    unsigned int flush_ms,
+    hit_format_fn_t format);
+
+void hit_writer_push(hit_writer_t & writer, unsigned int producer, hit_record_t const & record);
+
+// hits pushed so far
+std::uint64_t hit_writer_nhits(hit_writer_t const & writer);
+
+// hits written so far, per target
+void hit_writer_target_nhits(hit_writer_t const & writer, std::vector<std::uint64_t> & nhits);
+
+// Wait until every hit pushed before the call has been handed to write(2).
+void hit_writer_sync(hit_writer_t & writer);
+
+// Drain everything pushed so far, flush and stop the writer thread.
+void hit_writer_free(hit_writer_t * writer_p);
+
+
+#endif /* HIT_WRITER_HPP */
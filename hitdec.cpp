@@ -0,0 +1,329 @@
+#include "hit_writer.hpp"
+#include "endomorphism.hpp"
+#include "targets.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <optional>
+#include <vector>
+#include <fstream>
+#include <cctype>
+#include <algorithm>
+
+#include <openssl/crypto.h>
+
+
+struct parsed_args
+{
+    bool help = false;
+    std::optional<std::string> maybe_target;
+    std::optional<std::string> maybe_target_fname;
+
+    // replay of a single candidate
+    std::optional<key_coord_t> maybe_coord;
+    std::optional<std::uint64_t> maybe_seed;
+    std::uint64_t walk_len = 0;
+};
+
+
+int parse_args(int argc, char* argv[], parsed_args & parsed)
+{
+    auto constexpr N_REQUIRED = 0u;
+    bool show_help = false;
+    int c = 0;
+
+    while (--argc > 0 && (*++argv)[0] == '-')
+    {
+        while ((c = *++argv[0]))
+        {
+            switch (c)
+            {
+                case 'a':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_target = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'i':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_target_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'x':
+                {
+                    if (--argc > 0)
+                    {
+                        key_coord_t coord{};
+                        unsigned int stream = 0;
+                        unsigned int variant = 0;
+                        int nchars = 0;
+                        int nchars_variant = 0;
+                        bool valid = (sscanf(argv[1], "%u:%" SCNu64 "%n", &stream, &coord.counter, &nchars) == 2);
+                        if (valid and (argv[1][nchars] == ':'))
+                        {
+                            valid = (sscanf(argv[1] + nchars, ":%u%n", &variant, &nchars_variant) == 1)
+                                and (variant < NVARIANTS);
+                            nchars += nchars_variant;
+                        }
+
+                        if (valid and (argv[1][nchars] == '\0'))
+                        {
+                            coord.stream = stream;
+                            coord.variant = variant;
+                            parsed.maybe_coord = coord;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid coordinates passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 's':
+                {
+                    if (--argc > 0)
+                    {
+                        char * end_p = nullptr;
+                        auto val = strtoull(argv[1], &end_p, 0);
+                        if ((*argv[1] != '\0') and (*end_p == '\0'))
+                        {
+                            parsed.maybe_seed = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid seed passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'w':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.walk_len = strtoull(argv[1], nullptr, 0);
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'h':
+                    show_help = true;
+                    parsed.help = show_help;
+                    break;
+
+                default:
+                {
+                    fprintf(stderr, "Illegal option [%c]\n", (char)c);
+                    argc = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    bool const replay = parsed.maybe_coord.has_value();
+    bool const missing_seed = replay and not parsed.maybe_seed;
+
+    if (show_help or missing_seed or (argc != N_REQUIRED) or (not replay and not parsed.maybe_target and not parsed.maybe_target_fname))
+    {
+        if (missing_seed)
+        {
+            fprintf(stderr, "Replay needs the seed of the run, -x requires -s.\n");
+        }
+        if (argc != N_REQUIRED)
+        {
+            fprintf(stderr, "Unexpected arguments.\n");
+        }
+        if (not replay and not parsed.maybe_target and not parsed.maybe_target_fname)
+        {
+            fprintf(stderr, "Either or both -a and -i option must be specified.\n");
+        }
+
+        fprintf(stderr,
+            "\n"
+            "Usage: hitdec [options] < records\n"
+            "       hitdec -s UINT64 [-w UINT64] -x STREAM:COUNTER[:VARIANT]\n\n"
+            "Turns binary hit records written by main -r or aladdin -r back into their usual text lines.\n"
+            "Targets must be given the same way as to the run that wrote the records.\n"
+            "With -x, prints the private key of a single candidate of a seeded run instead.\n\n"
+            "Options:\n"
+            "         -a STR    single input target, as passed to main -a or aladdin -k\n"
+            "         -i STR    file name with input targets, one per line, as passed to main -i or aladdin -i\n"
+            "         -x STR    coordinates STREAM:COUNTER[:VARIANT] of a candidate to replay, VARIANT as of main -g (default 0)\n"
+            "         -s UINT64 seed of the run to replay\n"
+            "         -w UINT64 walk length of the run to replay, as saved in its checkpoint, 0 for random keys (default 0)\n"
+            "         -h        show help\n");
+
+        return show_help ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+static
+void read_targets_from_file(std::string const & ifname, std::vector<std::string> & targets)
+{
+    std::ifstream fcsv(ifname);
+
+    for (std::string line; std::getline(fcsv, line); /* nop */)
+    {
+        line.erase(
+            std::remove_if(line.begin(), line.end(),
+                [](unsigned char x){ return std::isspace(x); }),
+            line.end());
+        targets.push_back(line);
+    }
+    fcsv.close();
+}
+
+
+int main(int argc, char **argv)
+{
+    parsed_args args;
+
+    if (parse_args(argc, argv, args) != EXIT_SUCCESS)
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (args.help)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    if (args.maybe_coord)
+    {
+        hit_record_t record{};
+        record.flags = HIT_RECORD_COORD;
+        record.coord = *args.maybe_coord;
+
+        if (not hit_record_resolve(record, *args.maybe_seed, args.walk_len))
+        {
+            fprintf(stderr, "[!] Failed to replay the candidate\n");
+            return EXIT_FAILURE;
+        }
+
+        auto * priv_as_bn_p = BN_bin2bn(record.priv, sizeof (record.priv), nullptr);
+        auto * hex_p = BN_bn2hex(priv_as_bn_p);
+        printf("%s\n", hex_p);
+
+        OPENSSL_free(hex_p);
+        BN_free(priv_as_bn_p);
+
+        return EXIT_SUCCESS;
+    }
+
+    hit_stream_header_t header;
+    if (fread(&header, sizeof (header), 1, stdin) != 1 or not hit_stream_header_valid(header))
+    {
+        fprintf(stderr, "[!] Input is not a hit record stream\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> targets;
+    if (header.kind == HIT_STREAM_MAIN)
+    {
+        // main indexes its targets in hash160 order, load them as it does
+        targets_t main_targets{};
+        if (args.maybe_target_fname and not targets_load(main_targets, *args.maybe_target_fname, std::nullopt))
+        {
+            return EXIT_FAILURE;
+        }
+        if (args.maybe_target)
+        {
+            targets_add(main_targets, *args.maybe_target);
+        }
+
+        for (std::size_t tix = 0; tix < main_targets.ntargets; ++tix)
+        {
+            targets.emplace_back(targets_address(main_targets, tix));
+        }
+        targets_release(main_targets);
+    }
+    else if (args.maybe_target)
+    {
+        auto target = *args.maybe_target;
+
+        // aladdin drops the header byte of a 65-byte pubkey passed with -k
+        if (target.size() == 2 * 65)
+        {
+            target.erase(0, 2);
+        }
+        targets.push_back(target);
+    }
+    if ((header.kind == HIT_STREAM_ALADDIN) and args.maybe_target_fname)
+    {
+        read_targets_from_file(*args.maybe_target_fname, targets);
+    }
+
+    if (targets.size() != header.ntargets)
+    {
+        fprintf(stderr, "[!] Records were written for %u targets, %zu given\n", header.ntargets, targets.size());
+        return EXIT_FAILURE;
+    }
+
+    bool const with_pubkey = header.flags & HIT_STREAM_WITH_PUBKEY;
+    bool const with_encoding = header.flags & HIT_STREAM_COMPRESSED;
+    auto const RECORD_SIZE = header.record_size;
+    std::vector<std::uint8_t> buf(4096 * RECORD_SIZE);
+    std::string out;
+
+    for (std::size_t nread; (nread = fread(buf.data(), RECORD_SIZE, buf.size() / RECORD_SIZE, stdin)) != 0; /* nop */)
+    {
+        for (auto ix = 0u; ix < nread; ++ix)
+        {
+            hit_record_t record{};
+            std::memcpy(&record, buf.data() + ix * RECORD_SIZE, RECORD_SIZE);
+
+            if (not hit_record_resolve(record, header.seed, header.walk_len))
+            {
+                fprintf(stderr, "[!] Failed to replay the candidate of a record\n");
+                return EXIT_FAILURE;
+            }
+
+            if (record.tix >= targets.size())
+            {
+                fprintf(stderr, "[!] Record with target index %u out of range\n", record.tix);
+                return EXIT_FAILURE;
+            }
+
+            if (header.kind == HIT_STREAM_MAIN)
+            {
+                hit_format_main(record, targets[record.tix], with_encoding, out);
+            }
+            else
+            {
+                hit_format_aladdin(record, targets[record.tix], with_pubkey, out);
+            }
+        }
+
+        fwrite(out.data(), 1, out.size(), stdout);
+        out.clear();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,8 @@
+hitdec: $(OSSL_DIR)/libcrypto.a hitdec.cpp hit_writer.cpp hit_writer.hpp targets.cpp targets.hpp unaddr.cpp unaddr.hpp endomorphism.cpp endomorphism.hpp keygen.cpp keygen.hpp secp256k1.cpp secp256k1.hpp chacha20.cpp chacha20.hpp fd_io.cpp fd_io.hpp hitdec.mk
+	$(CXX) \
+	hitdec.cpp hit_writer.cpp targets.cpp unaddr.cpp endomorphism.cpp keygen.cpp secp256k1.cpp chacha20.cpp fd_io.cpp -o hitdec \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt -pthread \
+	$(OSSL_DIR)/libcrypto.a $(LZMA_FLAGS) \
+	-I$(OSSL_DIR) \
+	-I$(OSSL_DIR)/include \
+	-O3
@@ -0,0 +1,374 @@
+#include "keygen.hpp"
+#include "chacha20.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include <x86intrin.h>
+
+#include <openssl/rand.h>
+
+
+keygen_t * keygen_new(
+    std::uint64_t walk_nsteps,
+    std::size_t block_size,
+    std::optional<std::uint64_t> const & maybe_seed,
+    std::uint32_t stream,
+    std::uint64_t walk_stride)
+{
+    auto * kg_p = new keygen_t{};
+
+    kg_p->walk_nsteps = walk_nsteps;
+    kg_p->walk_stride = walk_stride;
+    kg_p->block_size = block_size;
+    kg_p->seeded = maybe_seed.has_value();
+    kg_p->seed = maybe_seed.value_or(0);
+    kg_p->stream = stream;
+
+    if (walk_nsteps != 0)
+    {
+        // whole blocks, short of overflowing when walks are practically endless
+        auto const nblocks = std::min<std::uint64_t>(
+            walk_nsteps / block_size + (walk_nsteps % block_size != 0),
+            std::numeric_limits<std::uint64_t>::max() / block_size);
+        kg_p->walk_len = nblocks * block_size;
+    }
+    kg_p->ctx_p = BN_CTX_new();
+    kg_p->base_p = BN_new();
+    kg_p->priv_p = BN_new();
+
+    if ((kg_p->ctx_p == nullptr) or (kg_p->base_p == nullptr) or (kg_p->priv_p == nullptr)
+        or not BN_hex2bn(&kg_p->order_p, SECP256K1_ORDER_HEX))
+    {
+        keygen_free(kg_p);
+        return nullptr;
+    }
+
+    kg_p->points.resize(block_size);
+    kg_p->affine.resize(block_size);
+
+    // the step of a walk, d G
+    kg_p->stride_point = SECP256K1_G;
+    if ((walk_nsteps != 0) and (walk_stride != 1))
+    {
+        std::uint8_t d[32] = {};
+        for (auto bix = 0u; bix < sizeof (walk_stride); ++bix)
+        {
+            d[sizeof (d) - 1 - bix] = walk_stride >> (8 * bix);
+        }
+
+        gej_t stride_j;
+        gej_mul_gen(stride_j, d);
+        ge_set_gej(kg_p->stride_point, stride_j);
+    }
+
+    if (walk_nsteps == 0)
+    {
+        kg_p->privs.resize(block_size, nullptr);
+        for (auto & priv_p : kg_p->privs)
+        {
+            priv_p = BN_new();
+
+            if (priv_p == nullptr)
+            {
+                keygen_free(kg_p);
+                return nullptr;
+            }
+        }
+    }
+
+    return kg_p;
+}
+
+
+void keygen_free(keygen_t * kg_p)
+{
+    if (kg_p == nullptr)
+    {
+        return;
+    }
+
+    for (auto * priv_p : kg_p->privs)
+    {
+        BN_free(priv_p);
+    }
+    BN_free(kg_p->priv_p);
+    BN_free(kg_p->base_p);
+    BN_free(kg_p->order_p);
+    BN_CTX_free(kg_p->ctx_p);
+
+    delete kg_p;
+}
+
+
+void keygen_seek(keygen_t & kg, std::uint64_t counter)
+{
+    // blocks start at multiples of the block size, which divides walk_len
+    kg.next_first = counter % kg.block_size;
+    kg.next_counter = counter - kg.next_first;
+    kg.walk_continues = false;
+}
+
+
+static
+bool rand_scalar(keygen_t & kg, BIGNUM * k_p)
+{
+    do
+    {
+        if (not BN_rand_range(k_p, kg.order_p))
+        {
+            return false;
+        }
+    } while (BN_is_zero(k_p));
+
+    return true;
+}
+
+
+// k = x mod (n - 1) + 1, x the first 32 bytes of ChaCha20 block draw_ix
+// keyed by the seed with the stream as nonce, so that k is never 0
+static
+bool seeded_scalar(
+    std::uint64_t seed,
+    std::uint32_t stream,
+    std::uint64_t draw_ix,
+    BIGNUM const * order_p,
+    BIGNUM * k_p,
+    BN_CTX * ctx_p)
+{
+    std::uint32_t const key[8] = {(std::uint32_t)seed, (std::uint32_t)(seed >> 32), 0, 0, 0, 0, 0, 0};
+    std::uint8_t block[64];
+
+    chacha20_block(key, draw_ix, stream, block);
+
+    BN_CTX_start(ctx_p);
+    auto * x_p = BN_CTX_get(ctx_p);
+    auto * n_1_p = BN_CTX_get(ctx_p);
+
+    bool const ok = (n_1_p != nullptr)
+        and BN_bin2bn(block, 32, x_p)
+        and BN_copy(n_1_p, order_p)
+        and BN_sub_word(n_1_p, 1)
+        and BN_mod(k_p, x_p, n_1_p, ctx_p)
+        and BN_add_word(k_p, 1);
+
+    BN_CTX_end(ctx_p);
+
+    return ok;
+}
+
+
+// draw_ix is the counter of the candidate in random mode, the walk number in walk mode
+static
+bool draw_scalar(keygen_t & kg, std::uint64_t draw_ix, BIGNUM * k_p)
+{
+    return kg.seeded
+        ? seeded_scalar(kg.seed, kg.stream, draw_ix, kg.order_p, k_p, kg.ctx_p)
+        : rand_scalar(kg, k_p);
+}
+
+
+// k G, k in [0, n)
+static
+bool mul_gen(gej_t & r, BIGNUM const * k_p)
+{
+    std::uint8_t k[32];
+    auto const nbytes = BN_num_bytes(k_p);
+
+    if (nbytes > (int)sizeof (k))
+    {
+        return false;
+    }
+
+    std::memset(k, 0, sizeof (k) - nbytes);
+    BN_bn2bin(k_p, k + sizeof (k) - nbytes);
+    gej_mul_gen(r, k);
+
+    return true;
+}
+
+
+static
+bool random_block(keygen_t & kg)
+{
+    // unseeded, the bytes of the whole block in one call to the pool, far
+    // cheaper than one per key; the rare one out of [1, n) is drawn again
+    std::vector<std::uint8_t> bytes;
+    if (not kg.seeded)
+    {
+        bytes.resize(32 * kg.block_size);
+        if (RAND_bytes(bytes.data(), bytes.size()) != 1)
+        {
+            return false;
+        }
+    }
+
+    for (auto ix = 0u; ix < kg.block_size; ++ix)
+    {
+        auto * k_p = kg.privs[ix];
+        bool const drawn = kg.seeded
+            ? draw_scalar(kg, kg.counter + ix, k_p)
+            : (BN_bin2bn(bytes.data() + 32 * ix, 32, k_p) != nullptr)
+                and ((not BN_is_zero(k_p) and (BN_cmp(k_p, kg.order_p) < 0)) or rand_scalar(kg, k_p));
+
+        if (not drawn or not mul_gen(kg.points[ix], k_p))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static
+bool walk_block(keygen_t & kg)
+{
+    auto const N = kg.block_size;
+
+    kg.offset = kg.counter % kg.walk_len;
+
+    if ((kg.offset == 0) or not kg.walk_continues)
+    {
+        // start of a walk, or a resumed one: draw its base, first point is (base + offset stride) G
+        if (not draw_scalar(kg, kg.counter / kg.walk_len, kg.base_p)
+            or not mul_gen(kg.points[0], keygen_private_key(kg, 0)))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        gej_add_ge(kg.points[0], kg.points[N - 1], kg.stride_point);
+    }
+
+    for (auto ix = 1u; ix < N; ++ix)
+    {
+        gej_add_ge(kg.points[ix], kg.points[ix - 1], kg.stride_point);
+    }
+
+    return true;
+}
+
+
+bool keygen_next_block(keygen_t & kg, uncompressed_key_t * uncompressed_p)
+{
+    auto const N = kg.block_size;
+    auto const generate = kg.walk_nsteps == 0 ? random_block : walk_block;
+
+    kg.counter = kg.next_counter;
+    kg.first = kg.next_first;
+    kg.next_first = 0;
+    if (not generate(kg))
+    {
+        return false;
+    }
+
+    // the walk wrapped onto the point at infinity (k + offset == n), skip to the next walk;
+    // random keys are never 0 so this only happens in walk mode
+    while (std::any_of(kg.points.cbegin(), kg.points.cend(),
+        [](gej_t const & point){ return point.infinity; }))
+    {
+        kg.counter = (kg.counter / kg.walk_len + 1) * kg.walk_len;
+        kg.first = 0;
+        kg.walk_continues = false;
+        if (not generate(kg))
+        {
+            return false;
+        }
+    }
+
+    kg.next_counter = kg.counter + N;
+    kg.walk_continues = true;
+
+    ge_set_gej_batch(kg.affine.data(), kg.points.data(), N);
+
+    auto const t0 = __rdtsc();
+    for (auto ix = 0u; ix < N; ++ix)
+    {
+        ge_to_uncompressed(kg.affine[ix], uncompressed_p[ix].data());
+    }
+    kg.serialize_cycles = __rdtsc() - t0;
+
+    return true;
+}
+
+
+BIGNUM const * keygen_private_key(keygen_t & kg, std::size_t ix)
+{
+    if (kg.walk_nsteps == 0)
+    {
+        return kg.privs[ix];
+    }
+
+    // (base + offset + ix) mod n
+    if (kg.walk_stride == 1)
+    {
+        BN_copy(kg.priv_p, kg.base_p);
+        BN_add_word(kg.priv_p, kg.offset + ix);
+        if (BN_cmp(kg.priv_p, kg.order_p) >= 0)
+        {
+            BN_sub(kg.priv_p, kg.priv_p, kg.order_p);
+        }
+        return kg.priv_p;
+    }
+
+    // (base + (offset + ix) stride) mod n
+    BN_set_word(kg.priv_p, kg.offset + ix);
+    BN_mul_word(kg.priv_p, kg.walk_stride);
+    BN_mod_add(kg.priv_p, kg.priv_p, kg.base_p, kg.order_p, kg.ctx_p);
+
+    return kg.priv_p;
+}
+
+
+bool keygen_replay(
+    std::uint64_t seed,
+    std::uint32_t stream,
+    std::uint64_t walk_len,
+    std::uint64_t counter,
+    BIGNUM * priv_p,
+    std::uint64_t walk_stride)
+{
+    static BIGNUM const * const order_p = []()
+    {
+        BIGNUM * rv_p = nullptr;
+        BN_hex2bn(&rv_p, SECP256K1_ORDER_HEX);
+        return rv_p;
+    }();
+    thread_local BN_CTX * ctx_p = BN_CTX_new();
+
+    if (walk_len == 0)
+    {
+        return seeded_scalar(seed, stream, counter, order_p, priv_p, ctx_p);
+    }
+
+    if (walk_stride != 1)
+    {
+        BN_CTX_start(ctx_p);
+        auto * step_p = BN_CTX_get(ctx_p);
+
+        bool const ok = (step_p != nullptr)
+            and seeded_scalar(seed, stream, counter / walk_len, order_p, priv_p, ctx_p)
+            and BN_set_word(step_p, counter % walk_len)
+            and BN_mul_word(step_p, walk_stride)
+            and BN_mod_add(priv_p, priv_p, step_p, order_p, ctx_p);
+
+        BN_CTX_end(ctx_p);
+
+        return ok;
+    }
+
+    if (not seeded_scalar(seed, stream, counter / walk_len, order_p, priv_p, ctx_p)
+        or not BN_add_word(priv_p, counter % walk_len))
+    {
+        return false;
+    }
+    if (BN_cmp(priv_p, order_p) >= 0)
+    {
+        BN_sub(priv_p, priv_p, order_p);
+    }
+
+    return true;
+}
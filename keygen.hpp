@@ -0,0 +1,116 @@
+#pragma once
+
+#ifndef KEYGEN_HPP
+#define KEYGEN_HPP
+
+#include <array>
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+#include "secp256k1.hpp"
+
+#include <openssl/bn.h>
+
+
+using uncompressed_key_t = std::array<std::uint8_t, 65>;
+
+
+// Source of candidate secp256k1 keys, one per worker thread.
+//
+// Keys are produced in blocks of block_size points. The points of a block
+// are computed in Jacobian coordinates and normalized to affine together
+// with a single shared field inversion (Montgomery's trick) before they are
+// serialized.
+//
+// With walk_nsteps == 0 every candidate is an independent random key.
+// Otherwise a random base key k is drawn and the candidates are
+// k, k+1, k+2, ... obtained by adding G to the previous point, so each
+// candidate costs a single point addition instead of a full scalar
+// multiplication. A new base is drawn every walk_nsteps candidates,
+// rounded up to a whole number of blocks. With a walk_stride d other than
+// 1 the candidates are k, k+d, k+2d, ..., adding dG instead of G.
+//
+// Every candidate has a counter, its position in the generator's stream.
+// Unseeded, keys come from the OpenSSL random pool. Seeded, random keys and
+// walk bases are drawn from ChaCha20 keyed by the seed with the stream id as
+// nonce, so a candidate is fully identified by (seed, stream, counter) and a
+// stream can be resumed from any candidate.
+typedef struct
+{
+    std::uint64_t walk_nsteps;
+    std::uint64_t walk_stride;
+    std::size_t block_size;
+
+    // walk_nsteps rounded up to whole blocks, 0 in random mode
+    std::uint64_t walk_len;
+
+    bool seeded;
+    std::uint64_t seed;
+    std::uint32_t stream;
+
+    // counter of the first candidate of the current block, and of the next block
+    std::uint64_t counter;
+    std::uint64_t next_counter;
+
+    // candidates of the current block, and of the next one, that come before
+    // the counter the stream was resumed at: only the block resumed in has any
+    std::size_t first;
+    std::size_t next_first;
+
+    // whether the next block continues the walk of the current one
+    bool walk_continues;
+
+    BN_CTX *ctx_p;
+    BIGNUM *order_p;
+
+    // points of the current block, and the same normalized to affine
+    std::vector<gej_t> points;
+    std::vector<ge_t> affine;
+
+    // private keys of the current block, random mode only
+    std::vector<BIGNUM *> privs;
+
+    // TSC cycles the most recent block spent serializing its points
+    std::uint64_t serialize_cycles;
+
+    // walk state, the block holds keys base + (offset + [0, block_size)) stride
+    BIGNUM *base_p;
+    BIGNUM *priv_p;
+    std::uint64_t offset;
+    ge_t stride_point;
+} keygen_t;
+
+
+keygen_t * keygen_new(
+    std::uint64_t walk_nsteps,
+    std::size_t block_size,
+    std::optional<std::uint64_t> const & maybe_seed = std::nullopt,
+    std::uint32_t stream = 0,
+    std::uint64_t walk_stride = 1);
+void keygen_free(keygen_t * kg_p);
+
+// Continue the stream at the given counter. The next block is the one
+// holding it, its candidates before it are skipped by setting first.
+void keygen_seek(keygen_t & kg, std::uint64_t counter);
+
+// Generate the next block of candidates and store their uncompressed public
+// keys, block_size of them.
+bool keygen_next_block(keygen_t & kg, uncompressed_key_t * uncompressed_p);
+
+// Private key of the ix-th candidate of the most recent block, owned by kg.
+BIGNUM const * keygen_private_key(keygen_t & kg, std::size_t ix);
+
+// Private key of the candidate at counter of a seeded stream, without
+// generating the stream; walk_len and walk_stride as in keygen_t.
+bool keygen_replay(
+    std::uint64_t seed,
+    std::uint32_t stream,
+    std::uint64_t walk_len,
+    std::uint64_t counter,
+    BIGNUM * priv_p,
+    std::uint64_t walk_stride = 1);
+
+
+#endif /* KEYGEN_HPP */
@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef LONGEST_RUN_HPP
+#define LONGEST_RUN_HPP
+
+#include "ripemd160_mb.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+
+typedef struct
+{
+    unsigned int len;
+    unsigned int offset;
+} run_t;
+
+
+// 192-bit logical right shift by 1..64 bits of three little-endian 64-bit words
+static inline
+void shr192(std::uint64_t (&x)[3], unsigned int k)
+{
+    if (k == 64)
+    {
+        x[0] = x[1];
+        x[1] = x[2];
+        x[2] = 0;
+    }
+    else
+    {
+        x[0] = (x[0] >> k) | (x[1] << (64 - k));
+        x[1] = (x[1] >> k) | (x[2] << (64 - k));
+        x[2] = x[2] >> k;
+    }
+}
+
+
+// Longest run of equal bits of two 160-bit hashes, i.e. of zero bits of
+// their XOR, bit i of a hash being bit i % 8 of its byte i / 8. Returns the
+// run length and the bit offset where it starts, lowest offset first on
+// ties, or {0, 0} when no run reaches min_len bits.
+//
+// A handful of shift-and steps first tells whether any run reaches min_len,
+// which is all the common case needs. Only then are the runs of equal bits
+// walked with count trailing zeros, carrying a run across the 64-bit lanes.
+static inline
+run_t longest_run(hash_4_simd_t const & a, hash_4_simd_t const & b, unsigned int min_len)
+{
+    std::uint64_t m[3];
+    for (auto wix = 0u; wix < 3; ++wix)
+    {
+        std::uint64_t x;
+        std::uint64_t y;
+        std::memcpy(&x, a.h256.data() + 8 * wix, sizeof (x));
+        std::memcpy(&y, b.h256.data() + 8 * wix, sizeof (y));
+        m[wix] = ~(x ^ y);
+    }
+    m[2] &= 0xFFFF'FFFFULL;
+
+    // y keeps the bits that start a run of at least len equal bits
+    {
+        std::uint64_t y[3] = {m[0], m[1], m[2]};
+        auto len = 1u;
+
+        for (/* nop */; 2 * len <= min_len; len *= 2)
+        {
+            std::uint64_t t[3] = {y[0], y[1], y[2]};
+            shr192(t, len);
+            y[0] &= t[0];
+            y[1] &= t[1];
+            y[2] &= t[2];
+        }
+        if (min_len > len)
+        {
+            std::uint64_t t[3] = {y[0], y[1], y[2]};
+            shr192(t, min_len - len);
+            y[0] &= t[0];
+            y[1] &= t[1];
+            y[2] &= t[2];
+        }
+
+        if (__builtin_expect((y[0] | y[1] | y[2]) == 0, 1))
+        {
+            return {0, 0};
+        }
+    }
+
+    run_t best = {0, 0};
+    unsigned int carry_len = 0;
+    unsigned int carry_offset = 0;
+
+    for (auto wix = 0u; wix < 3; ++wix)
+    {
+        auto x = m[wix];
+        auto next_carry_len = 0u;
+        auto next_carry_offset = 0u;
+
+        while (x != 0)
+        {
+            auto const start = (unsigned int)__builtin_ctzll(x);
+
+            // adding the lowest set bit clears the lowest run of ones and sets the bit past it
+            auto const z = x + (x & -x);
+            auto const end = z == 0 ? 64u : (unsigned int)__builtin_ctzll(z);
+
+            auto len = end - start;
+            auto offset = 64 * wix + start;
+            if ((start == 0) and (carry_len != 0))
+            {
+                len += carry_len;
+                offset = carry_offset;
+            }
+
+            if (len > best.len)
+            {
+                best = {len, offset};
+            }
+            if (end == 64)
+            {
+                next_carry_len = len;
+                next_carry_offset = offset;
+            }
+
+            x &= z;
+        }
+
+        carry_len = next_carry_len;
+        carry_offset = next_carry_offset;
+    }
+
+    return best;
+}
+
+
+#endif /* LONGEST_RUN_HPP */
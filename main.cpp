@@ -1,150 +1,285 @@
 #include "parse_args.hpp"
-#include "unaddr.hpp"
+#include "targets.hpp"
+#include "ossl_threads.hpp"
+#include "keygen.hpp"
+#include "gen_table.hpp"
+#include "endomorphism.hpp"
+#include "sha256_mb.hpp"
+#include "ripemd160_mb.hpp"
+#include "target_index.hpp"
+#include "exact_index.hpp"
+#include "window_scan.hpp"
+#include "longest_run.hpp"
+#include "cpu_dispatch.hpp"
+#include "hit_writer.hpp"
+#include "checkpoint.hpp"
+#include "telemetry.hpp"
 
 #include <cstdlib>
 #include <cstdint>
 #include <array>
 #include <vector>
-#include <fstream>
-#include <cctype>
 #include <algorithm>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
 
 #include <openssl/ec.h>
 #include <openssl/objects.h>
-#include <openssl/sha.h>
-#include <openssl/ripemd.h>
 
-#include <immintrin.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 
 #define LIKELY(x) __builtin_expect((x),1)
 #define UNLIKELY(x) __builtin_expect((x),0)
 
-using uncompressed_key_t = std::array<std::uint8_t, 65>;
-using hash256_t = std::array<std::uint8_t, 32>;
+// candidates ahead whose filter block is prefetched in exact matching
+static constexpr unsigned int EXACT_PREFETCH_DISTANCE = 8;
 
-typedef union
+// Lets the main thread sleep between stats reports until the workers are done.
+typedef struct
 {
-    __v32qi v32;
-    __m256i m256;
-    hash160_t h160;
-    hash256_t h256;
-} hash_4_simd_t;
-static_assert(sizeof (hash160_t) == 20u);
-static_assert(sizeof (hash256_t) == 32u);
+    std::mutex mutex;
+    std::condition_variable cv;
+    unsigned int nrunning;
+} worker_pool_t;
 
-typedef struct
+
+// Per-worker progress counters, padded so that workers do not share cache lines.
+typedef struct alignas(64)
 {
-    std::vector<std::string> addresses;
-    std::vector<hash_4_simd_t> hashes;
-} targets_soa_t;
+    stage_counters_t stages;
+
+    // stream counter to resume at and points tried in the run, published
+    // together after the hits of the block are pushed
+    std::mutex progress_mutex;
+    std::uint64_t next_counter;
+    std::uint64_t ntried;
+} worker_stats_t;
 
 
 static
-__v32qi SHR(__v32qi iv, unsigned int imm)
+void search_worker(
+    keygen_t & kg,
+    targets_t const & targets,
+    target_index_t const * index_p,
+    exact_index_t const * exact_p,
+    window_scan_t const * scan_p,
+    unsigned int const min_match_nbits,
+    bool const hash_uncompressed,
+    bool const hash_compressed,
+    unsigned int const nvariants,
+    bool const infinite_loop,
+    std::uint64_t const ntries,
+    worker_stats_t & stats,
+    hit_writer_t & writer,
+    unsigned int const wix,
+    worker_pool_t & pool)
 {
-    // [1234][5678][9ABC][DEFG]
-    __m256i data = (__m256i)iv;
-
-    while (imm >= 64)
-    {
-        imm -= 64;
-        data = _mm256_permute4x64_epi64(data, 0b00'11'10'01);
-        data = _mm256_blend_epi32(_mm256_setzero_si256(), data, 0b0'0'1'1'1'1'1'1);
-    }
+    auto const BLOCK_SIZE = kg.block_size;
 
-    if (imm == 0)
-    {
-        return (__v32qi)data;
-    }
+    // the points of a block, followed by their other variants when there are any
+    auto const NCANDIDATES = BLOCK_SIZE * nvariants;
+    std::vector<uncompressed_key_t> uncompressed(NCANDIDATES);
+    std::vector<hash256_t> h256s(NCANDIDATES);
+    std::vector<hash_4_simd_t> h160s(hash_uncompressed ? NCANDIDATES : 0);
+    std::vector<hash_4_simd_t> h160cs(hash_compressed ? NCANDIDATES : 0);
 
-    // [4...][8...][C...][G...] <- [1234][5678][9ABC][DEFG]
-    __m256i innerCarry = _mm256_slli_epi64(data, 64 - imm);
+    std::vector<std::uint32_t> tixs;
+    auto * variant_priv_p = BN_new();
 
-    // [G...][4...][8...][C...] <- [4...][8...][C...][G...]
-    __m256i rotate = _mm256_permute4x64_epi64(innerCarry, 0b00'11'10'01);
+    // every hash of the block against the targets, flags telling the encoding the hashes are of;
+    // candidate kix is variant kix / nkeys of point kix % nkeys
+    auto const compare = [&](std::vector<hash_4_simd_t> const & hashes, std::size_t const nkeys, std::uint8_t const flags)
+    {
+        for (auto kix = 0u; kix < nkeys * nvariants; ++kix)
+        {
+            auto const & h160 = hashes[kix];
 
-    // [....][4...][8...][C...] <- [G...][4...][8...][C...]
-    innerCarry = _mm256_blend_epi32(_mm256_setzero_si256(), rotate, 0b0'0'1'1'1'1'1'1);
+            auto const report = [&](unsigned int tix, run_t const & run)
+            {
+                hit_record_t record{};
+                record.tix = tix;
+                record.score = run.len;
+                record.offset = run.offset;
+                record.flags = flags;
+
+                auto const pix = kg.first + kix % nkeys;
+                auto const variant = kix / nkeys;
+                if (kg.seeded)
+                {
+                    // the writer, or hitdec, turns these back into the key
+                    record.flags |= HIT_RECORD_COORD;
+                    record.coord = {kg.counter + pix, kg.stream, (std::uint32_t)variant};
+                }
+                else if (variant == 0)
+                {
+                    hit_record_set_private_key(record, keygen_private_key(kg, pix));
+                }
+                else
+                {
+                    endomorphism_private_key(keygen_private_key(kg, pix), variant, variant_priv_p, kg.ctx_p);
+                    hit_record_set_private_key(record, variant_priv_p);
+                }
 
-    // [.123][.567][.9AB][.DEF] <- [1234][5678][9ABC][DEFG]
-    data = _mm256_srli_epi64(data, imm);
+                hit_writer_push(writer, wix, record);
+            };
 
-    // [.123][4567][89AB][CDEF]
-    data = _mm256_or_si256(data, innerCarry);
-    return (__v32qi)data;
-}
+            auto const check_target = [&](unsigned int tix)
+            {
+                auto const run = longest_run(targets.hashes_p[tix], h160, min_match_nbits);
+                if (UNLIKELY(run.len != 0))
+                {
+                    report(tix, run);
+                }
+            };
 
-static
-__v32qi SHL(__v32qi iv, unsigned int imm)
-{
-    // [1234][5678][9ABC][DEFG]
-    __m256i data = (__m256i)iv;
+            if (exact_p != nullptr)
+            {
+                if (kix + EXACT_PREFETCH_DISTANCE < nkeys * nvariants)
+                {
+                    exact_index_prefetch(*exact_p, hashes[kix + EXACT_PREFETCH_DISTANCE]);
+                }
 
-    while (imm >= 64)
-    {
-        imm -= 64;
-        data = _mm256_permute4x64_epi64(data, 0b10'01'00'11);
-        data = _mm256_blend_epi32(_mm256_setzero_si256(), data, 0b1'1'1'1'1'1'0'0);
-    }
+                // whole hashes, without the target hashes themselves
+                exact_index_lookup(*exact_p, h160, tixs);
+                for (auto const tix : tixs)
+                {
+                    report(tix, {160, 0});
+                }
+            }
+            else if (index_p != nullptr)
+            {
+                // only the targets sharing a whole chunk with h160 can hold a matching run
+                target_index_lookup(*index_p, h160, tixs);
+                for (auto const tix : tixs)
+                {
+                    check_target(tix);
+                }
+            }
+            else
+            {
+                // the window test over all targets at once, then the runs of those that pass
+                window_scan(*scan_p, h160, tixs);
+                for (auto const tix : tixs)
+                {
+                    check_target(tix);
+                }
+            }
+        }
+    };
 
-    if (imm == 0)
+    for (std::uint64_t it = 0; infinite_loop or (it < ntries); /* nop */)
     {
-        return (__v32qi)data;
-    }
+        auto const t0 = tsc_now();
+        if (UNLIKELY(not keygen_next_block(kg, uncompressed.data())))
+        {
+            fprintf(stderr, "[!] Failed to generate keys\n");
+            break;
+        }
 
-    // [...1][...5][...9][...D] <- [1234][5678][9ABC][DEFG]
-    __m256i innerCarry = _mm256_srli_epi64(data, 64 - imm);
+        // the block a stream resumed in only counts from where it stopped
+        auto * const keys_p = uncompressed.data() + kg.first;
+        auto const block_nkeys = BLOCK_SIZE - kg.first;
+        auto const nkeys = infinite_loop ? block_nkeys : std::min<std::uint64_t>(block_nkeys, ntries - it);
+        auto const ncandidates = nkeys * nvariants;
 
-    // [...5][...9][...D][...1] <- [...1][...5][...9][...D]
-    __m256i rotate = _mm256_permute4x64_epi64(innerCarry, 0b10'01'00'11);
+        if (nvariants != 1)
+        {
+            endomorphism_expand(keys_p, nkeys);
+        }
 
-    // [...5][...9][...D][....] <- [...5][...9][...D][...1]
-    innerCarry = _mm256_blend_epi32(_mm256_setzero_si256(), rotate, 0b1'1'1'1'1'1'0'0);
+        // both encodings are hashed from the same serialized points, one after the other through h256s
+        std::uint64_t sha256_cycles = 0;
+        std::uint64_t ripemd160_cycles = 0;
+        auto const hash = [&](auto sha256_f, std::vector<hash_4_simd_t> & hashes)
+        {
+            auto const ta = tsc_now();
+            sha256_f(keys_p, h256s.data(), ncandidates);
+            auto const tb = tsc_now();
+            ripemd160_32_mb(h256s.data(), hashes.data(), ncandidates);
+            sha256_cycles += tb - ta;
+            ripemd160_cycles += tsc_now() - tb;
+        };
+
+        auto const t1 = tsc_now();
+        if (hash_uncompressed)
+        {
+            hash(sha256_65_mb, h160s);
+        }
+        if (hash_compressed)
+        {
+            hash(sha256_33_mb, h160cs);
+        }
+        auto const t2 = tsc_now();
 
-    // [234.][678.][ABC.][EFG.] <- [1234][5678][9ABC][DEFG]
-    data = _mm256_slli_epi64(data, imm);
+        if (hash_uncompressed)
+        {
+            compare(h160s, nkeys, 0);
+        }
+        if (hash_compressed)
+        {
+            compare(h160cs, nkeys, HIT_RECORD_COMPRESSED);
+        }
 
-    // [2345][6789][ABCD][EFG.]
-    data = _mm256_or_si256(data, innerCarry);
-    return (__v32qi)data;
-}
+        auto const t3 = tsc_now();
 
+        std::uint64_t cycles[NSTAGES];
+        cycles[STAGE_KEYGEN] = t1 - t0 - kg.serialize_cycles;
+        cycles[STAGE_SERIALIZE] = kg.serialize_cycles;
+        cycles[STAGE_SHA256] = sha256_cycles;
+        cycles[STAGE_RIPEMD160] = ripemd160_cycles;
+        cycles[STAGE_COMPARE] = t3 - t2;
 
-static
-std::array<__v32qi, 160> make_masks(unsigned int match_nbits)
-{
-    auto const NMASK_CHECKS = 1 + 160 - match_nbits;
-    std::array<__v32qi, 160> masks;
+        // tries count points, throughput every public key tested
+        it += nkeys;
+        stage_counters_add(stats.stages, ncandidates * (hash_uncompressed + hash_compressed), cycles);
+        {
+            // past the last point tried, inside the block when -n ran out in it
+            std::lock_guard<std::mutex> lock(stats.progress_mutex);
+            stats.next_counter = kg.counter + kg.first + nkeys;
+            stats.ntried += nkeys;
+        }
+    }
 
-    __v32qi mask = SHR((__v32qi)(~_mm256_setzero_si256()), 256 - match_nbits);
+    BN_free(variant_priv_p);
 
-    for (auto ix = 0u; ix < NMASK_CHECKS; ++ix)
     {
-        masks[ix] = mask;
-        mask = SHL(mask, 1);
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        --pool.nrunning;
     }
-    
-    return masks;
+    pool.cv.notify_one();
 }
 
 
 static
-void read_targets_from_file(std::string const & ifname, targets_soa_t & targets)
+void pin_thread(std::thread & thread, unsigned int const ix)
 {
-    std::ifstream fcsv(ifname);
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
 
-    for (std::string line; std::getline(fcsv, line); /* nop */)
+    if (sched_getaffinity(0, sizeof (allowed), &allowed) != 0 or CPU_COUNT(&allowed) == 0)
     {
-        line.erase(
-            std::remove_if(line.begin(), line.end(),
-                [](unsigned char x){ return std::isspace(x); }),
-            line.end());
-        hash_4_simd_t h = {.h160 = unaddr(line)};
-        targets.addresses.push_back(line);
-        targets.hashes.push_back(h);
+        return;
+    }
+
+    // ix-th allowed cpu, wrapping around when there are more threads than cpus
+    auto nth = ix % CPU_COUNT(&allowed);
+    for (auto cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed) and (nth-- == 0))
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cpu, &cpuset);
+            pthread_setaffinity_np(thread.native_handle(), sizeof (cpuset), &cpuset);
+            break;
+        }
     }
-    fcsv.close();
 }
 
 
@@ -162,68 +297,257 @@ int main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
-    targets_soa_t targets;
+    if (args.maybe_kernels and not cpu_kernels_select(*args.maybe_kernels))
+    {
+        fprintf(stderr, "[!] The CPU lacks the %s kernels, it supports at most %s\n",
+            cpu_kernels_name(*args.maybe_kernels), cpu_kernels_name(cpu_kernels_supported()));
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "[i] Using the %s kernels\n", cpu_kernels_name(cpu_kernels()));
+
+    targets_t targets{};
+    if (args.maybe_address_fname
+        and not targets_load(targets, *args.maybe_address_fname, args.maybe_target_cache_fname))
+    {
+        return EXIT_FAILURE;
+    }
     if (args.maybe_address)
     {
-        hash_4_simd_t h = {.h160 = unaddr(*args.maybe_address)};
-        targets.addresses.push_back(*args.maybe_address);
-        targets.hashes.push_back(h);
+        targets_add(targets, *args.maybe_address);
     }
-    if (args.maybe_address_fname)
+
+    ossl_threads_setup();
+
+    if (args.maybe_gen_table_fname and not gen_table_open(*args.maybe_gen_table_fname, args.gen_table_huge_pages))
+    {
+        return EXIT_FAILURE;
+    }
+
+    auto const NTHREADS = args.nthreads;
+
+    // with a seed, worker wix draws stream wix
+    std::vector<keygen_t *> keygens(NTHREADS, nullptr);
+    for (auto wix = 0u; wix < NTHREADS; ++wix)
     {
-        read_targets_from_file(*args.maybe_address_fname, targets);
+        keygens[wix] = keygen_new(args.walk_nsteps, args.block_size, args.maybe_seed, wix);
+
+        if (keygens[wix] == nullptr)
+        {
+            fprintf(stderr, "[!] Failed to allocate key generator\n");
+            return EXIT_FAILURE;
+        }
     }
 
-    pid_t const pid = getpid();
+    auto const WALK_LEN = keygens.front()->walk_len;
+
+    // points each stream tried in earlier invocations of the run
+    std::vector<std::uint64_t> ntried(NTHREADS, 0);
+
+    if (args.maybe_checkpoint_fname and (access(args.maybe_checkpoint_fname->c_str(), F_OK) == 0))
+    {
+        checkpoint_t cp;
+
+        if (not checkpoint_load(*args.maybe_checkpoint_fname, cp))
+        {
+            fprintf(stderr, "[!] Failed to read checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+            return EXIT_FAILURE;
+        }
+        if ((cp.seed != *args.maybe_seed) or (cp.walk_len != WALK_LEN) or (cp.counters.size() != NTHREADS))
+        {
+            fprintf(stderr, "[!] Checkpoint %s is of a run with another seed, walk length or number of threads\n",
+                args.maybe_checkpoint_fname->c_str());
+            return EXIT_FAILURE;
+        }
 
-    EC_KEY *key_p = EC_KEY_new_by_curve_name(NID_secp256k1);
-    uncompressed_key_t uncompressed;
+        for (auto wix = 0u; wix < NTHREADS; ++wix)
+        {
+            keygen_seek(*keygens[wix], cp.counters[wix]);
+        }
+        ntried = cp.ntried;
+        fprintf(stderr, "[i] Resuming from checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+    }
 
     bool const infinite_loop = not args.maybe_ntries.has_value();
     auto const ntries = args.maybe_ntries.has_value() ? *args.maybe_ntries : 0;
 
-    auto const NTARGETS = targets.hashes.size();
-    auto const NMASK_CHECKS = 1 + 160 - args.min_match_nbits;
-    std::array<__v32qi, 160> const masks = make_masks(args.min_match_nbits);
+    // a whole hash to match, the filtered exact index takes over the hashes
+    exact_index_t exact;
+    bool const use_exact = not args.linear_scan and (args.min_match_nbits == 160);
+    if (use_exact)
+    {
+        exact_index_build(exact, targets.hashes_p, targets.ntargets);
+        targets_release_hashes(targets);
+    }
+
+    target_index_t index;
+    bool const use_index = not args.linear_scan and not use_exact
+        and target_index_build(index, targets.hashes_p, targets.ntargets, args.min_match_nbits);
+
+    window_scan_t scan;
+    if (not use_exact and not use_index)
+    {
+        window_scan_build(scan, targets.hashes_p, targets.ntargets, args.min_match_nbits);
+    }
+
+    auto const SEED = args.maybe_seed.value_or(0);
+
+    std::optional<hit_stream_header_t> maybe_header;
+    if (args.raw_records)
+    {
+        maybe_header = hit_stream_header(HIT_STREAM_MAIN,
+            (args.maybe_seed ? HIT_STREAM_SEEDED : 0) | (args.hash_compressed ? HIT_STREAM_COMPRESSED : 0),
+            targets.ntargets, SEED, WALK_LEN);
+    }
+    bool const with_encoding = args.hash_compressed;
+    auto * writer_p = hit_writer_new(NTHREADS, targets.ntargets, STDOUT_FILENO, maybe_header, args.flush_ms,
+        [&targets, SEED, WALK_LEN, with_encoding](hit_record_t const & record, std::string & line)
+        {
+            auto resolved = record;
+            hit_record_resolve(resolved, SEED, WALK_LEN);
+            hit_format_main(resolved, targets_address(targets, record.tix), with_encoding, line);
+        });
 
-    hash256_t h256;
-    hash_4_simd_t h160;
+    std::vector<worker_stats_t> stats(NTHREADS);
+    for (auto wix = 0u; wix < NTHREADS; ++wix)
+    {
+        stats[wix].next_counter = keygens[wix]->next_counter + keygens[wix]->next_first;
+        stats[wix].ntried = ntried[wix];
+    }
+    worker_pool_t pool;
+    pool.nrunning = NTHREADS;
 
-    for (std::uint64_t it = 0; infinite_loop or (it < ntries); ++it)
+    std::vector<std::thread> workers;
+    for (auto wix = 0u; wix < NTHREADS; ++wix)
     {
-        EC_KEY_generate_key(key_p);
+        // split the requested number of tries evenly among the workers, less what they already tried
+        auto const worker_share = ntries / NTHREADS + (wix < ntries % NTHREADS);
+        auto const worker_ntries = worker_share - std::min(worker_share, ntried[wix]);
+
+        workers.emplace_back(search_worker,
+            std::ref(*keygens[wix]), std::cref(targets), use_index ? &index : nullptr, use_exact ? &exact : nullptr, &scan, args.min_match_nbits,
+            args.hash_uncompressed, args.hash_compressed, args.endomorphism ? NVARIANTS : 1, infinite_loop, worker_ntries, std::ref(stats[wix]), std::ref(*writer_p), wix, std::ref(pool));
+        pin_thread(workers.back(), wix);
+    }
+
+    // hits go out through the writer thread, the main thread only reports the aggregated throughput
+    using clock = std::chrono::steady_clock;
+    auto constexpr STATS_PERIOD = std::chrono::seconds(10);
 
-        auto uncompressed_p = uncompressed.data();
-        i2o_ECPublicKey(key_p, &uncompressed_p);
+    std::vector<stage_counters_t const *> counters;
+    for (auto const & s : stats)
+    {
+        counters.push_back(&s.stages);
+    }
 
-        SHA256(uncompressed.data(), uncompressed.size(), h256.data());
-        RIPEMD160(h256.data(), h256.size(), h160.h160.data());
+    auto const snap_start = telemetry_snapshot(counters);
+    auto snap_last = snap_start;
 
-        for (auto tix = 0u; tix < NTARGETS; ++tix)
+    auto const write_stats = [&](telemetry_snapshot_t const & snap)
+    {
+        if (not args.maybe_stats_fname)
         {
-            auto const diff = targets.hashes[tix].v32 ^ h160.v32;
-            if (UNLIKELY(_mm256_testz_si256((__m256i)diff, ~_mm256_setzero_si256()) != 0))
-            {
-                auto * priv_as_bn_p = EC_KEY_get0_private_key(key_p);
-                auto * hex_p = BN_bn2hex(priv_as_bn_p);
-                printf("wut ??? %s\t%s\n", targets.addresses[tix].c_str(), hex_p);
-                fflush(stdout);
-                OPENSSL_free(hex_p);
-            }
+            return;
+        }
+
+        std::vector<std::uint64_t> nhits;
+        hit_writer_target_nhits(*writer_p, nhits);
 
-            for (auto ix = 0u; ix < NMASK_CHECKS; ++ix)
+        std::vector<std::pair<std::string_view, std::uint64_t>> target_nhits;
+        for (auto tix = 0u; tix < nhits.size(); ++tix)
+        {
+            if (nhits[tix] != 0)
             {
-                if (UNLIKELY(_mm256_testz_si256((__m256i)diff, (__m256i)masks[ix]) != 0))
-                {
-                    auto * priv_as_bn_p = EC_KEY_get0_private_key(key_p);
-                    auto * hex_p = BN_bn2hex(priv_as_bn_p);
-                    printf("%s\t%03u\t%s\n", targets.addresses[tix].c_str(), ix, hex_p);
-                    fflush(stdout);
-                    OPENSSL_free(hex_p);
-                }
+                target_nhits.emplace_back(targets_address(targets, tix), nhits[tix]);
             }
         }
+
+        if (not telemetry_write_json(*args.maybe_stats_fname, snap_start, snap_last, snap, target_nhits))
+        {
+            fprintf(stderr, "[w] Failed to write stats to %s\n", args.maybe_stats_fname->c_str());
+        }
+    };
+
+    auto const save_checkpoint = [&]()
+    {
+        if (not args.maybe_checkpoint_fname)
+        {
+            return;
+        }
+
+        checkpoint_t cp{SEED, WALK_LEN, {}, {}};
+        for (auto & s : stats)
+        {
+            std::lock_guard<std::mutex> lock(s.progress_mutex);
+            cp.counters.push_back(s.next_counter);
+            cp.ntried.push_back(s.ntried);
+        }
+
+        // the hits of everything before the checkpoint must be out before it is
+        hit_writer_sync(*writer_p);
+
+        if (not checkpoint_save(*args.maybe_checkpoint_fname, cp))
+        {
+            fprintf(stderr, "[w] Failed to save checkpoint %s\n", args.maybe_checkpoint_fname->c_str());
+        }
+    };
+
+    for (bool done = false; not done; /* nop */)
+    {
+        {
+            std::unique_lock<std::mutex> lock(pool.mutex);
+            pool.cv.wait_for(lock, STATS_PERIOD - (clock::now() - snap_last.t),
+                [&pool]{ return pool.nrunning == 0; });
+            done = pool.nrunning == 0;
+        }
+
+        if (clock::now() - snap_last.t >= STATS_PERIOD)
+        {
+            auto const snap = telemetry_snapshot(counters);
+            auto const n = telemetry_nkeys(snap);
+            std::chrono::duration<double> const dt = snap.t - snap_last.t;
+
+            fprintf(stderr, "[i] %lu keys, %.0lf keys/s (%u threads), %lu hits\n",
+                n, (n - telemetry_nkeys(snap_last)) / dt.count(), NTHREADS, hit_writer_nhits(*writer_p));
+            telemetry_print(stderr, snap_last, snap);
+            write_stats(snap);
+
+            snap_last = snap;
+
+            save_checkpoint();
+        }
+    }
+
+    for (auto & worker : workers)
+    {
+        worker.join();
     }
 
+    save_checkpoint();
+
+    {
+        auto const snap = telemetry_snapshot(counters);
+        auto const n = telemetry_nkeys(snap);
+        std::chrono::duration<double> const dt = snap.t - snap_start.t;
+
+        fprintf(stderr, "[i] %lu keys in %.1lf s, %.0lf keys/s (%u threads), %lu hits\n",
+            n, dt.count(), n / dt.count(), NTHREADS, hit_writer_nhits(*writer_p));
+        telemetry_print(stderr, snap_start, snap);
+
+        // per-target counts are taken as the writer drains the hits
+        hit_writer_sync(*writer_p);
+        write_stats(snap);
+    }
+
+    hit_writer_free(writer_p);
+
+    for (auto * kg_p : keygens)
+    {
+        keygen_free(kg_p);
+    }
+
+    targets_release(targets);
+
+    ossl_threads_cleanup();
+
     return EXIT_SUCCESS;
 }
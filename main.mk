@@ -1,8 +1,8 @@
-main: $(OSSL_DIR)/libcrypto.a main.cpp parse_args.cpp parse_args.hpp unaddr.cpp unaddr.hpp ntohl.h main.mk
+main: $(OSSL_DIR)/libcrypto.a main.cpp parse_args.cpp parse_args.hpp unaddr.cpp unaddr.hpp targets.cpp targets.hpp ossl_threads.cpp ossl_threads.hpp keygen.cpp keygen.hpp secp256k1.cpp secp256k1.hpp gen_table.cpp gen_table.hpp sha256_mb.cpp sha256_mb.hpp ripemd160_mb.cpp ripemd160_mb.hpp simd_u32.hpp target_index.cpp target_index.hpp exact_index.cpp exact_index.hpp window_scan.cpp window_scan.hpp cpu_dispatch.cpp cpu_dispatch.hpp longest_run.hpp hit_writer.cpp hit_writer.hpp endomorphism.cpp endomorphism.hpp chacha20.cpp chacha20.hpp checkpoint.cpp checkpoint.hpp telemetry.cpp telemetry.hpp ntohl.h fd_io.cpp fd_io.hpp main.mk
 	$(CXX) \
-	main.cpp parse_args.cpp unaddr.cpp -o main \
-	-std=c++17 -march=native \
-	$(OSSL_DIR)/libcrypto.a \
+	main.cpp parse_args.cpp unaddr.cpp targets.cpp ossl_threads.cpp keygen.cpp secp256k1.cpp gen_table.cpp sha256_mb.cpp ripemd160_mb.cpp target_index.cpp exact_index.cpp window_scan.cpp cpu_dispatch.cpp hit_writer.cpp endomorphism.cpp chacha20.cpp checkpoint.cpp telemetry.cpp fd_io.cpp -o main \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt -Wno-psabi -pthread \
+	$(OSSL_DIR)/libcrypto.a $(LZMA_FLAGS) \
 	-I$(OSSL_DIR) \
 	-I$(OSSL_DIR)/include \
 	-O3
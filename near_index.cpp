@@ -0,0 +1,137 @@
+#include "near_index.hpp"
+
+#include <algorithm>
+
+
+static constexpr unsigned int SUBSTRING_NBITS = 16;
+static constexpr unsigned int NSUBSTRINGS = 512 / SUBSTRING_NBITS;
+static constexpr std::size_t NVALUES = std::size_t{1} << SUBSTRING_NBITS;
+
+// the cost of a probed bucket and of a candidate verified out of order, in
+// targets compared by a scan, which streams through them 8 at a time
+static constexpr std::size_t PROBE_COST = 10;
+static constexpr std::size_t VERIFY_COST = 70;
+
+
+static inline
+std::uint32_t substring_of(pubkey_t const & pubkey, unsigned int six)
+{
+    return (pubkey.vi64[six / 4] >> (SUBSTRING_NBITS * (six % 4))) & (NVALUES - 1);
+}
+
+
+bool near_index_build(
+    near_index_t & index,
+    pubkey_t const * pubkeys_p, std::size_t ntargets,
+    unsigned int min_matched,
+    std::optional<unsigned int> maybe_max_radius)
+{
+    if (min_matched > 512)
+    {
+        return false;
+    }
+
+    auto const radius = 512 - min_matched;
+    auto const substring_radius = radius / NSUBSTRINGS;
+
+    if (maybe_max_radius and (radius > *maybe_max_radius))
+    {
+        return false;
+    }
+
+    // values at most substring_radius bits away, nearest first
+    std::vector<std::uint16_t> flips;
+    for (auto nflipped = 0u; nflipped <= std::min(substring_radius, SUBSTRING_NBITS); ++nflipped)
+    {
+        for (std::uint32_t f = 0; f < NVALUES; ++f)
+        {
+            if ((unsigned int)__builtin_popcount(f) == nflipped)
+            {
+                flips.push_back(f);
+            }
+        }
+    }
+
+    // every probe of a key, and the targets a random key finds in them
+    auto const nprobes = NSUBSTRINGS * flips.size();
+    auto const nverified = nprobes * ntargets / NVALUES;
+    if (not maybe_max_radius and (nprobes * PROBE_COST + nverified * VERIFY_COST > ntargets))
+    {
+        return false;
+    }
+
+    index.radius = radius;
+    index.flips = flips;
+    index.nflips = flips.size();
+    index.starts.assign(NSUBSTRINGS, {});
+    index.tixs.assign(NSUBSTRINGS, {});
+
+    for (auto six = 0u; six < NSUBSTRINGS; ++six)
+    {
+        auto & starts = index.starts[six];
+        auto & tixs = index.tixs[six];
+
+        // counting sort of the targets by substring value
+        starts.assign(NVALUES + 1, 0);
+        for (std::size_t tix = 0; tix < ntargets; ++tix)
+        {
+            ++starts[substring_of(pubkeys_p[tix], six) + 1];
+        }
+        for (std::size_t v = 0; v < NVALUES; ++v)
+        {
+            starts[v + 1] += starts[v];
+        }
+
+        tixs.resize(ntargets);
+        std::vector<std::uint32_t> fill(starts.cbegin(), starts.cend() - 1);
+        for (std::size_t tix = 0; tix < ntargets; ++tix)
+        {
+            tixs[fill[substring_of(pubkeys_p[tix], six)]++] = tix;
+        }
+    }
+
+    return true;
+}
+
+
+void near_index_narrow(near_index_t & index, unsigned int min_matched)
+{
+    if (512 - std::min(min_matched, 512u) >= index.radius)
+    {
+        return;
+    }
+
+    index.radius = 512 - std::min(min_matched, 512u);
+    auto const substring_radius = index.radius / NSUBSTRINGS;
+    index.nflips = std::partition_point(index.flips.cbegin(), index.flips.cend(),
+        [substring_radius](std::uint16_t f){ return (unsigned int)__builtin_popcount(f) <= substring_radius; })
+        - index.flips.cbegin();
+}
+
+
+void near_index_lookup(
+    near_index_t const & index,
+    pubkey_t const & pubkey,
+    std::vector<std::uint32_t> & tixs)
+{
+    tixs.clear();
+
+    for (auto six = 0u; six < NSUBSTRINGS; ++six)
+    {
+        auto const value = substring_of(pubkey, six);
+        auto const * starts_p = index.starts[six].data();
+        auto const * tixs_p = index.tixs[six].data();
+
+        for (std::size_t fix = 0; fix < index.nflips; ++fix)
+        {
+            auto const v = value ^ index.flips[fix];
+            tixs.insert(tixs.end(), tixs_p + starts_p[v], tixs_p + starts_p[v + 1]);
+        }
+    }
+
+    if (tixs.size() > 1)
+    {
+        std::sort(tixs.begin(), tixs.end());
+        tixs.erase(std::unique(tixs.begin(), tixs.end()), tixs.end());
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef NEAR_INDEX_HPP
+#define NEAR_INDEX_HPP
+
+#include "pubkey_match.hpp"
+
+#include <vector>
+#include <optional>
+#include <cstddef>
+#include <cstdint>
+
+
+// Multi-index hashing of target public keys for matches of at least n of
+// their 512 bits, i.e. within Hamming radius r = 512 - n.
+//
+// The keys are split into 32 substrings of 16 bits. A key within distance
+// r of a target is within floor(r / 32) of it on at least one substring, so
+// that a lookup only enumerates the values that close to each substring of
+// the key, and reads the targets carrying them from one exact-match table
+// per substring. Small radii flip at most a few bits of each substring: the
+// buckets probed and the targets they hold grow far slower than the list.
+typedef struct
+{
+    unsigned int radius;
+
+    // the substring values to probe are v ^ flips[..], nearest first, popcount(flips[..]) <= radius / 32;
+    // only the first nflips of them once the radius is narrowed
+    std::vector<std::uint16_t> flips;
+    std::size_t nflips;
+
+    // per substring, the targets whose substring is v are tixs[starts[v] .. starts[v + 1])
+    std::vector<std::vector<std::uint32_t>> starts;
+    std::vector<std::vector<std::uint32_t>> tixs;
+} near_index_t;
+
+
+// Build the index, returns false when the radius is too large for it to
+// beat a scan of all the targets: past max_radius when given, else when it
+// would probe and verify more than a fraction of the targets per key.
+bool near_index_build(
+    near_index_t & index,
+    pubkey_t const * pubkeys_p, std::size_t ntargets,
+    unsigned int min_matched,
+    std::optional<unsigned int> maybe_max_radius);
+
+// Narrow the radius to 512 - min_matched when that is smaller, so that
+// lookups probe fewer buckets, as a scan given a higher min_matched would
+// compare fewer bits. The radius never grows back past the one built for.
+void near_index_narrow(near_index_t & index, unsigned int min_matched);
+
+// Indices of the targets within floor(radius / 32) of pubkey on at least one
+// substring, in ascending order and without duplicates: all those within
+// the radius and some more, still to be verified with matched_bits().
+void near_index_lookup(
+    near_index_t const & index,
+    pubkey_t const & pubkey,
+    std::vector<std::uint32_t> & tixs);
+
+
+#endif /* NEAR_INDEX_HPP */
@@ -3,7 +3,7 @@ OSSL_FLAGS?="-march=native"
 
 $(OSSL_DIR)/libcrypto.a: $(OSSL_DIR)/config openssl.mk
 	patch --forward -p0 < patches/openssl-x86_64-bintuils-2.20.51.patch; [ $$? -lt 2 ]
-	cd $(OSSL_DIR) && ./config no-threads no-shared no-rc2 no-rc4 no-rc5 no-idea no-des no-bf no-cast no-camellia no-seed no-dh $(OSSL_FLAGS) && cd ..
+	cd $(OSSL_DIR) && ./config threads no-shared no-rc2 no-rc4 no-rc5 no-idea no-des no-bf no-cast no-camellia no-seed no-dh $(OSSL_FLAGS) && cd ..
 	$(MAKE) -C $(OSSL_DIR) $(OSSL_MAKEFLAGS) depend
 	$(MAKE) -C $(OSSL_DIR) $(OSSL_MAKEFLAGS) build_crypto
 
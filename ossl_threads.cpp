@@ -0,0 +1,50 @@
+#include "ossl_threads.hpp"
+
+#include <mutex>
+#include <memory>
+
+#include <openssl/crypto.h>
+
+#include <pthread.h>
+
+
+static std::unique_ptr<std::mutex[]> g_locks;
+
+
+static
+void locking_callback(int mode, int type, char const * /* file */, int /* line */)
+{
+    if (mode & CRYPTO_LOCK)
+    {
+        g_locks[type].lock();
+    }
+    else
+    {
+        g_locks[type].unlock();
+    }
+}
+
+
+static
+unsigned long id_callback()
+{
+    return (unsigned long)pthread_self();
+}
+
+
+void ossl_threads_setup()
+{
+    g_locks = std::make_unique<std::mutex[]>(CRYPTO_num_locks());
+
+    CRYPTO_set_id_callback(id_callback);
+    CRYPTO_set_locking_callback(locking_callback);
+}
+
+
+void ossl_threads_cleanup()
+{
+    CRYPTO_set_locking_callback(nullptr);
+    CRYPTO_set_id_callback(nullptr);
+
+    g_locks.reset();
+}
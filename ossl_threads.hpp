@@ -0,0 +1,14 @@
+#pragma once
+
+#ifndef OSSL_THREADS_HPP
+#define OSSL_THREADS_HPP
+
+
+// Install the static locking and thread id callbacks OpenSSL 0.9.8
+// needs before its global state (md_rand pool, error queues, ex_data)
+// can be touched from more than one thread.
+void ossl_threads_setup();
+void ossl_threads_cleanup();
+
+
+#endif /* OSSL_THREADS_HPP */
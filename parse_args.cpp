@@ -37,6 +37,66 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
                     }
                     break;
                 }
+                case 't':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.nthreads = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of threads passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'w':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoll(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.walk_nsteps = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of walk steps passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'b':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.block_size = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid block size passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
                 case 'a':
                 {
                     if (--argc > 0)
@@ -59,6 +119,148 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
                     }
                     break;
                 }
+                case 'C':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_target_cache_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'f':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 0)
+                        {
+                            parsed.flush_ms = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid flush interval passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 's':
+                {
+                    if (--argc > 0)
+                    {
+                        char * end_p = nullptr;
+                        auto val = strtoull(argv[1], &end_p, 0);
+                        if ((*argv[1] != '\0') and (*end_p == '\0'))
+                        {
+                            parsed.maybe_seed = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid seed passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'c':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_checkpoint_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'j':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_stats_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'T':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_gen_table_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'H':
+                    parsed.gen_table_huge_pages = true;
+                    break;
+
+                case 'e':
+                {
+                    if (--argc > 0)
+                    {
+                        auto const * enc = argv[1];
+                        if (strcmp(enc, "u") == 0 or strcmp(enc, "c") == 0 or strcmp(enc, "uc") == 0)
+                        {
+                            parsed.hash_uncompressed = strchr(enc, 'u') != nullptr;
+                            parsed.hash_compressed = strchr(enc, 'c') != nullptr;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid public key encodings passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'K':
+                {
+                    if (--argc > 0)
+                    {
+                        cpu_kernels_t kernels;
+                        if (cpu_kernels_parse(argv[1], kernels))
+                        {
+                            parsed.maybe_kernels = kernels;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid kernels passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'l':
+                    parsed.linear_scan = true;
+                    break;
+
+                case 'g':
+                    parsed.endomorphism = true;
+                    break;
+
+                case 'r':
+                    parsed.raw_records = true;
+                    break;
+
                 case 'h':
                     show_help = true;
                     parsed.help = show_help;
@@ -85,6 +287,24 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
         }
     }
 
+    if (parsed.maybe_checkpoint_fname and not parsed.maybe_seed)
+    {
+        fprintf(stderr, "Checkpoints need a seeded run, -c requires -s.\n");
+        argc = 0;
+    }
+
+    if (parsed.maybe_target_cache_fname and not parsed.maybe_address_fname)
+    {
+        fprintf(stderr, "The cache is of a target file, -C requires -i.\n");
+        argc = 0;
+    }
+
+    if (parsed.gen_table_huge_pages and not parsed.maybe_gen_table_fname)
+    {
+        fprintf(stderr, "Huge pages are for the generator table, -H requires -T.\n");
+        argc = 0;
+    }
+
     if (show_help or (argc != N_REQUIRED) or (not parsed.maybe_address and not parsed.maybe_address_fname))
     {
         if (argc != N_REQUIRED)
@@ -99,10 +319,27 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
         fprintf(stderr,
             "\n"
             "Usage: main [options] <Number of bits to match:UINT>\n\n"
+            "160 bits look up whole hashes in an index with a Bloom filter in front, as fast for tens of millions of targets.\n\n"
             "Options:\n"
             "         -n UINT64 number of tries, >= 1\n"
+            "         -t UINT   number of worker threads, >= 1 (default 1)\n"
+            "         -w UINT64 walk k, k+1, k+2, ... by point addition, drawing new random k every UINT64 keys\n"
+            "         -b UINT   generate keys in blocks of UINT sharing one field inversion, >= 1 (default 1)\n"
+            "         -s UINT64 draw keys from a ChaCha20 stream per thread keyed by UINT64, making the run reproducible\n"
+            "         -c STR    checkpoint file of a seeded run, resumed from if it exists, saved every 10 s and at exit;\n"
+            "                   -n then counts the tries of every invocation of the run\n"
             "         -a STR    single input address\n"
-            "         -i STR    file name with input address(es), one per line\n"
+            "         -i STR    file name with input address(es), one per line, plain or xz-compressed, or a -C cache\n"
+            "         -C STR    cache of the parsed -i file, mapped instead of parsing when up to date, else written\n"
+            "         -e STR    public key encodings to hash, u(ncompressed), c(ompressed) or uc for both from the same point (default u)\n"
+            "         -g        also test the 5 keys the endomorphism and negation of secp256k1 give for every point\n"
+            "         -l        compare against every target instead of looking them up in the chunk index\n"
+            "         -r        write hits as binary records, see hitdec, instead of text\n"
+            "         -f UINT   flush hits to stdout at least every UINT ms, 0 flushes as soon as they arrive (default 1000)\n"
+            "         -j STR    also write throughput, per-stage cycles and hits per target to JSON file STR every 10 s\n"
+            "         -T STR    multiply by G with the 64 MiB table mapped from file STR, which is built first if missing\n"
+            "         -H        with -T, copy the table onto huge pages instead of mapping the file\n"
+            "         -K STR    hash and compare with the scalar, avx2 or avx512 kernels, at most what the CPU supports (default the most)\n"
             "         -h        show help\n");
 
         return show_help ? EXIT_SUCCESS : EXIT_FAILURE;
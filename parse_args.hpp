@@ -3,6 +3,8 @@
 #ifndef PARSE_ARGS_HPP
 #define PARSE_ARGS_HPP
 
+#include "cpu_dispatch.hpp"
+
 #include <string>
 #include <optional>
 #include <cstdint>
@@ -11,10 +13,26 @@
 struct parsed_args
 {
     bool help = false;
+    bool linear_scan = false;
+    bool raw_records = false;
+    bool hash_uncompressed = true;
+    bool hash_compressed = false;
+    bool endomorphism = false;
+    bool gen_table_huge_pages = false;
+    unsigned int flush_ms = 1000;
     unsigned int min_match_nbits;
+    unsigned int nthreads = 1;
+    std::uint64_t walk_nsteps = 0;
+    unsigned int block_size = 1;
     std::optional<std::string> maybe_address;
     std::optional<std::string> maybe_address_fname;
+    std::optional<std::string> maybe_target_cache_fname;
     std::optional<std::uint64_t> maybe_ntries;
+    std::optional<std::uint64_t> maybe_seed;
+    std::optional<std::string> maybe_checkpoint_fname;
+    std::optional<std::string> maybe_stats_fname;
+    std::optional<std::string> maybe_gen_table_fname;
+    std::optional<cpu_kernels_t> maybe_kernels;
 };
 
 int parse_args(int argc, char* argv[], parsed_args & parsed);
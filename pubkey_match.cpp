@@ -0,0 +1,516 @@
+#include "pubkey_match.hpp"
+#include "simd_u32.hpp"
+
+#include <immintrin.h>
+
+
+#define SIMD_AVX512_VPOPCNTDQ __attribute__((target("avx2,bmi,bmi2,avx512f,avx512bw,avx512vl,avx512vpopcntdq")))
+
+
+// targets in a group, the lanes of the widest kernel
+static constexpr std::size_t GROUP = 8;
+static constexpr std::size_t NWORDS = 8;
+
+
+void pubkey_match_build(pubkey_match_t & match, pubkey_t const * pubkeys_p, std::size_t ntargets, unsigned int min_matched)
+{
+    match.kernels = cpu_kernels();
+    match.vpopcntdq = cpu_kernels_vpopcntdq();
+    match.ntargets = ntargets;
+    match.min_matched = min_matched;
+
+    auto const ngroups = (ntargets + GROUP - 1) / GROUP;
+    match.words.assign(ngroups * GROUP * NWORDS, 0);
+    for (std::size_t tix = 0; tix < ntargets; ++tix)
+    {
+        for (auto wix = 0u; wix < NWORDS; ++wix)
+        {
+            match.words[GROUP * NWORDS * (tix / GROUP) + GROUP * wix + tix % GROUP] = pubkeys_p[tix].vi64[wix];
+        }
+    }
+}
+
+
+static
+void match_x1(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    auto const max_mismatched = 64 * NWORDS - match.min_matched;
+
+    for (std::size_t tix = 0; tix < match.ntargets; ++tix)
+    {
+        auto const * target_p = match.words.data() + GROUP * NWORDS * (tix / GROUP) + tix % GROUP;
+
+        // halfway, most targets are out already when min_matched is high
+        std::size_t mismatched = 0;
+        for (auto wix = 0u; wix < NWORDS / 2; ++wix)
+        {
+            mismatched += __builtin_popcountll(target_p[GROUP * wix] ^ pubkey.vi64[wix]);
+        }
+        if (mismatched > max_mismatched)
+        {
+            continue;
+        }
+        for (auto wix = NWORDS / 2; wix < NWORDS; ++wix)
+        {
+            mismatched += __builtin_popcountll(target_p[GROUP * wix] ^ pubkey.vi64[wix]);
+        }
+
+        if (__builtin_expect(mismatched <= max_mismatched, 0))
+        {
+            tixs.push_back(tix);
+        }
+    }
+}
+
+
+// x counted once, then y and the y of the negation on top of it
+static
+void match_pair_x1(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    auto const max_mismatched = 64 * NWORDS - match.min_matched;
+
+    for (std::size_t tix = 0; tix < match.ntargets; ++tix)
+    {
+        auto const * target_p = match.words.data() + GROUP * NWORDS * (tix / GROUP) + tix % GROUP;
+
+        std::size_t x_mismatched = 0;
+        for (auto wix = 0u; wix < NWORDS / 2; ++wix)
+        {
+            x_mismatched += __builtin_popcountll(target_p[GROUP * wix] ^ pubkey.vi64[wix]);
+        }
+        if (x_mismatched > max_mismatched)
+        {
+            continue;
+        }
+
+        auto mismatched = x_mismatched;
+        auto neg_mismatched = x_mismatched;
+        for (auto wix = NWORDS / 2; wix < NWORDS; ++wix)
+        {
+            mismatched += __builtin_popcountll(target_p[GROUP * wix] ^ pubkey.vi64[wix]);
+            neg_mismatched += __builtin_popcountll(target_p[GROUP * wix] ^ neg.vi64[wix]);
+        }
+
+        if (__builtin_expect(mismatched <= max_mismatched, 0))
+        {
+            tixs.push_back(tix);
+        }
+        if (__builtin_expect(neg_mismatched <= max_mismatched, 0))
+        {
+            neg_tixs.push_back(tix);
+        }
+    }
+}
+
+
+// bit counts of the bytes of x, through a 16-entry table of the nibbles
+SIMD_AVX2
+static inline
+__m256i popcount_bytes(__m256i x)
+{
+    auto const lut = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    auto const nibbles = _mm256_set1_epi8(0x0F);
+
+    auto const lo = _mm256_and_si256(x, nibbles);
+    auto const hi = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbles);
+
+    return _mm256_add_epi8(_mm256_shuffle_epi8(lut, lo), _mm256_shuffle_epi8(lut, hi));
+}
+
+
+// Counts are kept per byte, 64 at most over the 8 words, and summed per
+// target with vpsadbw only when compared.
+SIMD_AVX2
+static
+void match_x4(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    auto const max_mismatched = _mm256_set1_epi64x(64 * NWORDS - match.min_matched);
+    auto const zero = _mm256_setzero_si256();
+
+    __m256i key[NWORDS];
+    for (auto wix = 0u; wix < NWORDS; ++wix)
+    {
+        key[wix] = _mm256_set1_epi64x(pubkey.vi64[wix]);
+    }
+
+    for (std::size_t tix = 0; tix < match.ntargets; tix += 4)
+    {
+        auto const * group_p = match.words.data() + GROUP * NWORDS * (tix / GROUP) + tix % GROUP;
+
+        auto counts = zero;
+        unsigned int out = 0;
+        for (auto wix = 0u; wix < NWORDS; ++wix)
+        {
+            auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(group_p + GROUP * wix));
+            counts = _mm256_add_epi8(counts, popcount_bytes(_mm256_xor_si256(x, key[wix])));
+
+            // every other word, whether all 4 targets are past the limit
+            if (wix % 2 == 1)
+            {
+                auto const past = _mm256_cmpgt_epi64(_mm256_sad_epu8(counts, zero), max_mismatched);
+                out = _mm256_movemask_pd(_mm256_castsi256_pd(past));
+                if (out == 0xF)
+                {
+                    break;
+                }
+            }
+        }
+
+        for (auto m = out ^ 0xFu; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            auto const hit = tix + __builtin_ctz(m);
+            if (hit < match.ntargets)
+            {
+                tixs.push_back(hit);
+            }
+        }
+    }
+}
+
+
+// 4 targets past the limit, as the bits of a mask
+SIMD_AVX2
+static inline
+unsigned int past_x4(__m256i counts, __m256i max_mismatched)
+{
+    auto const past = _mm256_cmpgt_epi64(_mm256_sad_epu8(counts, _mm256_setzero_si256()), max_mismatched);
+    return _mm256_movemask_pd(_mm256_castsi256_pd(past));
+}
+
+
+SIMD_AVX2
+static
+void match_pair_x4(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    auto const max_mismatched = _mm256_set1_epi64x(64 * NWORDS - match.min_matched);
+
+    __m256i key[NWORDS];
+    __m256i neg_key[NWORDS];
+    for (auto wix = 0u; wix < NWORDS; ++wix)
+    {
+        key[wix] = _mm256_set1_epi64x(pubkey.vi64[wix]);
+        neg_key[wix] = _mm256_set1_epi64x(neg.vi64[wix]);
+    }
+
+    for (std::size_t tix = 0; tix < match.ntargets; tix += 4)
+    {
+        auto const * group_p = match.words.data() + GROUP * NWORDS * (tix / GROUP) + tix % GROUP;
+
+        auto counts = _mm256_setzero_si256();
+        unsigned int out = 0;
+        for (auto wix = 0u; (wix < NWORDS / 2) and (out != 0xF); ++wix)
+        {
+            auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(group_p + GROUP * wix));
+            counts = _mm256_add_epi8(counts, popcount_bytes(_mm256_xor_si256(x, key[wix])));
+
+            if (wix % 2 == 1)
+            {
+                out = past_x4(counts, max_mismatched);
+            }
+        }
+        if (out == 0xF)
+        {
+            continue;
+        }
+
+        auto neg_counts = counts;
+        auto neg_out = out;
+        for (auto wix = NWORDS / 2; wix < NWORDS; ++wix)
+        {
+            auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(group_p + GROUP * wix));
+            counts = _mm256_add_epi8(counts, popcount_bytes(_mm256_xor_si256(x, key[wix])));
+            neg_counts = _mm256_add_epi8(neg_counts, popcount_bytes(_mm256_xor_si256(x, neg_key[wix])));
+
+            if (wix % 2 == 1)
+            {
+                out = past_x4(counts, max_mismatched);
+                neg_out = past_x4(neg_counts, max_mismatched);
+                if ((out & neg_out) == 0xF)
+                {
+                    break;
+                }
+            }
+        }
+
+        for (auto m = out ^ 0xFu; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            auto const hit = tix + __builtin_ctz(m);
+            if (hit < match.ntargets)
+            {
+                tixs.push_back(hit);
+            }
+        }
+        for (auto m = neg_out ^ 0xFu; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            auto const hit = tix + __builtin_ctz(m);
+            if (hit < match.ntargets)
+            {
+                neg_tixs.push_back(hit);
+            }
+        }
+    }
+}
+
+
+// Counts of 8 targets, per byte through the nibble table, which AVX-512 BW
+// looks up in whole 64-byte registers.
+struct count_lut_x8
+{
+    SIMD_AVX512 static __m512i add(__m512i counts, __m512i x)
+    {
+        auto const lut = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+        auto const nibbles = _mm512_set1_epi8(0x0F);
+
+        auto const lo = _mm512_and_si512(x, nibbles);
+        auto const hi = _mm512_and_si512(_mm512_srli_epi16(x, 4), nibbles);
+
+        return _mm512_add_epi8(counts, _mm512_add_epi8(_mm512_shuffle_epi8(lut, lo), _mm512_shuffle_epi8(lut, hi)));
+    }
+
+    SIMD_AVX512 static __m512i totals(__m512i counts)
+    {
+        return _mm512_sad_epu8(counts, _mm512_setzero_si512());
+    }
+};
+
+// Counts of 8 targets, per 64-bit lane with VPOPCNTDQ.
+struct count_vpopcntdq_x8
+{
+    SIMD_AVX512_VPOPCNTDQ static __m512i add(__m512i counts, __m512i x)
+    {
+        return _mm512_add_epi64(counts, _mm512_popcnt_epi64(x));
+    }
+
+    SIMD_AVX512_VPOPCNTDQ static __m512i totals(__m512i counts)
+    {
+        return counts;
+    }
+};
+
+
+template <typename C>
+SIMD_AVX512
+static inline
+void match_x8(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    auto const max_mismatched = _mm512_set1_epi64(64 * NWORDS - match.min_matched);
+
+    __m512i key[NWORDS];
+    for (auto wix = 0u; wix < NWORDS; ++wix)
+    {
+        key[wix] = _mm512_set1_epi64(pubkey.vi64[wix]);
+    }
+
+    for (std::size_t tix = 0; tix < match.ntargets; tix += GROUP)
+    {
+        auto const * group_p = match.words.data() + NWORDS * tix;
+
+        // the padding past the last target is out from the start
+        __mmask8 const valid = (match.ntargets - tix >= GROUP) ? 0xFF : (1u << (match.ntargets - tix)) - 1;
+
+        auto counts = _mm512_setzero_si512();
+        __mmask8 in = valid;
+        for (auto wix = 0u; wix < NWORDS; ++wix)
+        {
+            counts = C::add(counts, _mm512_xor_si512(_mm512_loadu_si512(group_p + GROUP * wix), key[wix]));
+
+            // every other word, whether any target is still within the limit
+            if (wix % 2 == 1)
+            {
+                in = _mm512_mask_cmple_epu64_mask(valid, C::totals(counts), max_mismatched);
+                if (in == 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        for (auto m = (unsigned int)in; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            tixs.push_back(tix + __builtin_ctz(m));
+        }
+    }
+}
+
+template <typename C>
+SIMD_AVX512
+static inline
+void match_pair_x8(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    auto const max_mismatched = _mm512_set1_epi64(64 * NWORDS - match.min_matched);
+
+    __m512i key[NWORDS];
+    __m512i neg_key[NWORDS];
+    for (auto wix = 0u; wix < NWORDS; ++wix)
+    {
+        key[wix] = _mm512_set1_epi64(pubkey.vi64[wix]);
+        neg_key[wix] = _mm512_set1_epi64(neg.vi64[wix]);
+    }
+
+    for (std::size_t tix = 0; tix < match.ntargets; tix += GROUP)
+    {
+        auto const * group_p = match.words.data() + NWORDS * tix;
+
+        __mmask8 const valid = (match.ntargets - tix >= GROUP) ? 0xFF : (1u << (match.ntargets - tix)) - 1;
+
+        auto counts = _mm512_setzero_si512();
+        __mmask8 in = valid;
+        for (auto wix = 0u; (wix < NWORDS / 2) and (in != 0); ++wix)
+        {
+            counts = C::add(counts, _mm512_xor_si512(_mm512_loadu_si512(group_p + GROUP * wix), key[wix]));
+
+            if (wix % 2 == 1)
+            {
+                in = _mm512_mask_cmple_epu64_mask(valid, C::totals(counts), max_mismatched);
+            }
+        }
+        if (in == 0)
+        {
+            continue;
+        }
+
+        auto neg_counts = counts;
+        __mmask8 neg_in = in;
+        for (auto wix = NWORDS / 2; wix < NWORDS; ++wix)
+        {
+            auto const x = _mm512_loadu_si512(group_p + GROUP * wix);
+            counts = C::add(counts, _mm512_xor_si512(x, key[wix]));
+            neg_counts = C::add(neg_counts, _mm512_xor_si512(x, neg_key[wix]));
+
+            if (wix % 2 == 1)
+            {
+                in = _mm512_mask_cmple_epu64_mask(in, C::totals(counts), max_mismatched);
+                neg_in = _mm512_mask_cmple_epu64_mask(neg_in, C::totals(neg_counts), max_mismatched);
+                if ((in | neg_in) == 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        for (auto m = (unsigned int)in; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            tixs.push_back(tix + __builtin_ctz(m));
+        }
+        for (auto m = (unsigned int)neg_in; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            neg_tixs.push_back(tix + __builtin_ctz(m));
+        }
+    }
+}
+
+
+
+SIMD_AVX512 __attribute__((flatten))
+static
+void match_x8_lut(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    match_x8<count_lut_x8>(match, pubkey, tixs);
+}
+
+
+SIMD_AVX512_VPOPCNTDQ __attribute__((flatten))
+static
+void match_x8_vpopcntdq(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    match_x8<count_vpopcntdq_x8>(match, pubkey, tixs);
+}
+
+
+SIMD_AVX512 __attribute__((flatten))
+static
+void match_pair_x8_lut(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    match_pair_x8<count_lut_x8>(match, pubkey, neg, tixs, neg_tixs);
+}
+
+
+SIMD_AVX512_VPOPCNTDQ __attribute__((flatten))
+static
+void match_pair_x8_vpopcntdq(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    match_pair_x8<count_vpopcntdq_x8>(match, pubkey, neg, tixs, neg_tixs);
+}
+
+
+void pubkey_match(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs)
+{
+    tixs.clear();
+
+    if (match.min_matched > 64 * NWORDS)
+    {
+        return;
+    }
+
+    switch (match.kernels)
+    {
+        case CPU_KERNELS_AVX512:
+            if (match.vpopcntdq)
+            {
+                match_x8_vpopcntdq(match, pubkey, tixs);
+            }
+            else
+            {
+                match_x8_lut(match, pubkey, tixs);
+            }
+            break;
+        case CPU_KERNELS_AVX2:
+            match_x4(match, pubkey, tixs);
+            break;
+        default:
+            match_x1(match, pubkey, tixs);
+            break;
+    }
+}
+
+
+void pubkey_match_pair(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs)
+{
+    tixs.clear();
+    neg_tixs.clear();
+
+    if (match.min_matched > 64 * NWORDS)
+    {
+        return;
+    }
+
+    switch (match.kernels)
+    {
+        case CPU_KERNELS_AVX512:
+            if (match.vpopcntdq)
+            {
+                match_pair_x8_vpopcntdq(match, pubkey, neg, tixs, neg_tixs);
+            }
+            else
+            {
+                match_pair_x8_lut(match, pubkey, neg, tixs, neg_tixs);
+            }
+            break;
+        case CPU_KERNELS_AVX2:
+            match_pair_x4(match, pubkey, neg, tixs, neg_tixs);
+            break;
+        default:
+            match_pair_x1(match, pubkey, neg, tixs, neg_tixs);
+            break;
+    }
+}
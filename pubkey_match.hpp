@@ -0,0 +1,76 @@
+#pragma once
+
+#ifndef PUBKEY_MATCH_HPP
+#define PUBKEY_MATCH_HPP
+
+#include "cpu_dispatch.hpp"
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// x and y of a public key, without the header byte
+using pubkey_i8_t = std::array<std::uint8_t, 64>;
+using pubkey_i64_t = std::array<std::uint64_t, 8>;
+
+typedef union
+{
+    pubkey_i8_t vi8;
+    pubkey_i64_t vi64;
+} pubkey_t;
+
+
+// number of equal bits of two public keys, out of 512
+static inline
+unsigned int matched_bits(pubkey_t const & a, pubkey_t const & b)
+{
+    unsigned int mismatched = 0;
+    for (auto ix = 0u; ix < a.vi64.size(); ++ix)
+    {
+        mismatched += __builtin_popcountl(a.vi64[ix] ^ b.vi64[ix]);
+    }
+
+    return 64 * 8 - mismatched;
+}
+
+
+// Target public keys for a scan of all of them: tells which targets share
+// at least min_matched bits with a key.
+//
+// The keys are transposed in groups of 8 targets, word w of the targets of
+// group g side by side at words[64 g + 8 w ..], so that a vector register
+// loads the same word of 4 (AVX2) or 8 (AVX-512) targets. Bits are counted
+// with VPOPCNTDQ when the CPU has it, else through a nibble lookup table
+// with vpshufb, and a group is given up as soon as all of its targets are
+// past 512 - min_matched mismatched bits.
+typedef struct
+{
+    cpu_kernels_t kernels;
+    bool vpopcntdq;
+    std::size_t ntargets;
+    unsigned int min_matched;
+
+    // padded to a multiple of 8 targets
+    std::vector<std::uint64_t> words;
+} pubkey_match_t;
+
+
+void pubkey_match_build(pubkey_match_t & match, pubkey_t const * pubkeys_p, std::size_t ntargets, unsigned int min_matched);
+
+// Indices of the targets sharing at least min_matched bits with pubkey, in
+// ascending order: exactly those matched_bits() scores that high.
+void pubkey_match(pubkey_match_t const & match, pubkey_t const & pubkey, std::vector<std::uint32_t> & tixs);
+
+// The same for a key and its negation (x, p - y), which shares its x: the
+// bits of x are counted once for both, and a target whose x alone is past
+// the limit is out for both, so that the negation comes at about half the
+// cost of a key of its own. tixs for pubkey, neg_tixs for neg.
+void pubkey_match_pair(
+    pubkey_match_t const & match,
+    pubkey_t const & pubkey, pubkey_t const & neg,
+    std::vector<std::uint32_t> & tixs, std::vector<std::uint32_t> & neg_tixs);
+
+
+#endif /* PUBKEY_MATCH_HPP */
@@ -0,0 +1,251 @@
+#include "ripemd160_mb.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <algorithm>
+#include <utility>
+
+
+static constexpr std::uint32_t H0[5] =
+{
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0,
+};
+
+// message word, rotation and constant of every step of the left and right lines
+static constexpr unsigned int RL[80] =
+{
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 4, 13, 1, 10, 6, 15, 3, 12, 0, 9, 5, 2, 14, 11, 8,
+    3, 10, 14, 4, 9, 15, 8, 1, 2, 7, 0, 6, 13, 11, 5, 12,
+    1, 9, 11, 10, 0, 8, 12, 4, 13, 3, 7, 15, 14, 5, 6, 2,
+    4, 0, 5, 9, 7, 12, 2, 10, 14, 1, 3, 8, 11, 6, 15, 13,
+};
+
+static constexpr unsigned int RR[80] =
+{
+    5, 14, 7, 0, 9, 2, 11, 4, 13, 6, 15, 8, 1, 10, 3, 12,
+    6, 11, 3, 7, 0, 13, 5, 10, 14, 15, 8, 12, 4, 9, 1, 2,
+    15, 5, 1, 3, 7, 14, 6, 9, 11, 8, 12, 2, 10, 0, 4, 13,
+    8, 6, 4, 1, 3, 11, 15, 0, 5, 12, 2, 13, 9, 7, 10, 14,
+    12, 15, 10, 4, 1, 5, 8, 7, 6, 2, 13, 14, 0, 3, 9, 11,
+};
+
+static constexpr int SL[80] =
+{
+    11, 14, 15, 12, 5, 8, 7, 9, 11, 13, 14, 15, 6, 7, 9, 8,
+    7, 6, 8, 13, 11, 9, 7, 15, 7, 12, 15, 9, 11, 7, 13, 12,
+    11, 13, 6, 7, 14, 9, 13, 15, 14, 8, 13, 6, 5, 12, 7, 5,
+    11, 12, 14, 15, 14, 15, 9, 8, 9, 14, 5, 6, 8, 6, 5, 12,
+    9, 15, 5, 11, 6, 8, 13, 12, 5, 12, 13, 14, 11, 8, 5, 6,
+};
+
+static constexpr int SR[80] =
+{
+    8, 9, 9, 11, 13, 15, 15, 5, 7, 7, 8, 11, 14, 14, 12, 6,
+    9, 13, 15, 7, 12, 8, 9, 11, 7, 7, 12, 7, 6, 15, 13, 11,
+    9, 7, 15, 11, 8, 6, 6, 14, 12, 13, 5, 14, 13, 13, 7, 5,
+    15, 5, 8, 11, 14, 14, 6, 14, 6, 9, 12, 9, 12, 5, 15, 8,
+    8, 5, 12, 9, 12, 5, 14, 6, 8, 13, 6, 5, 15, 13, 11, 11,
+};
+
+static constexpr std::uint32_t KL[5] = {0x00000000, 0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xA953FD4E};
+static constexpr std::uint32_t KR[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3, 0x7A6D76E9, 0x00000000};
+
+// padding of a 32-byte message: words 0..7 are the message, then 0x80, zeros, bit length
+static constexpr std::uint32_t pad_word(unsigned int ix)
+{
+    return ix == 8 ? 0x80 : (ix == 14 ? 32 * 8 : 0);
+}
+
+
+// f(j, x, y, z) of the j-th group of 16 steps
+template <typename V, unsigned int G>
+static inline __attribute__((always_inline))
+typename V::vec_t f(typename V::vec_t x, typename V::vec_t y, typename V::vec_t z)
+{
+    if constexpr (G == 0)
+    {
+        return V::xor3(x, y, z);
+    }
+    else if constexpr (G == 1)
+    {
+        return V::ch(x, y, z);
+    }
+    else if constexpr (G == 2)
+    {
+        // (x | ~y) ^ z
+        if constexpr (V::LANES == 16)
+        {
+            return V::template ternlog<0x59>(x, y, z);
+        }
+        else
+        {
+            return V::xor_(V::or_(x, V::not_(y)), z);
+        }
+    }
+    else if constexpr (G == 3)
+    {
+        return V::ch(z, x, y);
+    }
+    else
+    {
+        // x ^ (y | ~z)
+        if constexpr (V::LANES == 16)
+        {
+            return V::template ternlog<0x2D>(x, y, z);
+        }
+        else
+        {
+            return V::xor_(x, V::or_(y, V::not_(z)));
+        }
+    }
+}
+
+
+// one step of a line: a = rol(a + f(b, c, d) + X[r] + K, s) + e; c = rol(c, 10)
+template <typename V, unsigned int G, unsigned int R, int S, std::uint32_t K>
+static inline __attribute__((always_inline))
+void step(
+    typename V::vec_t & a, typename V::vec_t b, typename V::vec_t & c, typename V::vec_t d, typename V::vec_t e,
+    typename V::vec_t const (&x)[8])
+{
+    auto t = V::add(a, f<V, G>(b, c, d));
+
+    // message words past the digest are padding constants, folded into K
+    if constexpr (R < 8)
+    {
+        t = V::add(t, x[R]);
+    }
+    if constexpr ((K + pad_word(R)) != 0)
+    {
+        t = V::add(t, V::set1(K + pad_word(R)));
+    }
+
+    a = V::add(V::template rol<S>(t), e);
+    c = V::template rol<10>(c);
+}
+
+
+// Steps rotate the roles of the five state words instead of moving them around.
+template <typename V, std::size_t J>
+static inline __attribute__((always_inline))
+void left_step(typename V::vec_t (&s)[5], typename V::vec_t const (&x)[8])
+{
+    constexpr auto I = (5 - J % 5) % 5;
+    step<V, J / 16, RL[J], SL[J], KL[J / 16]>(
+        s[I], s[(I + 1) % 5], s[(I + 2) % 5], s[(I + 3) % 5], s[(I + 4) % 5], x);
+}
+
+
+template <typename V, std::size_t J>
+static inline __attribute__((always_inline))
+void right_step(typename V::vec_t (&s)[5], typename V::vec_t const (&x)[8])
+{
+    constexpr auto I = (5 - J % 5) % 5;
+    step<V, 4 - J / 16, RR[J], SR[J], KR[J / 16]>(
+        s[I], s[(I + 1) % 5], s[(I + 2) % 5], s[(I + 3) % 5], s[(I + 4) % 5], x);
+}
+
+
+template <typename V, std::size_t... J>
+static inline __attribute__((always_inline))
+void lines(
+    typename V::vec_t (&l)[5], typename V::vec_t (&r)[5], typename V::vec_t const (&x)[8],
+    std::index_sequence<J...>)
+{
+    (left_step<V, J>(l, x), ...);
+    (right_step<V, J>(r, x), ...);
+}
+
+
+template <typename V>
+static inline __attribute__((always_inline))
+void ripemd160_32(hash256_t const * digests_p, hash_4_simd_t * hashes_p)
+{
+    using vec_t = typename V::vec_t;
+
+    vec_t x[8];
+    V::load_transposed(digests_p, x);
+
+    vec_t l[5];
+    vec_t r[5];
+    for (auto ix = 0u; ix < 5; ++ix)
+    {
+        l[ix] = r[ix] = V::set1(H0[ix]);
+    }
+
+    lines<V>(l, r, x, std::make_index_sequence<80>{});
+
+    // after 80 steps (a multiple of 5) the roles are back where they started
+    vec_t out[8] =
+    {
+        V::add(V::set1(H0[1]), V::add(l[2], r[3])),
+        V::add(V::set1(H0[2]), V::add(l[3], r[4])),
+        V::add(V::set1(H0[3]), V::add(l[4], r[0])),
+        V::add(V::set1(H0[4]), V::add(l[0], r[1])),
+        V::add(V::set1(H0[0]), V::add(l[1], r[2])),
+        V::set1(0),
+        V::set1(0),
+        V::set1(0),
+    };
+    V::store_transposed(hashes_p, out);
+}
+
+
+void ripemd160_32_x1(hash256_t const * digests_p, hash_4_simd_t * hashes_p)
+{
+    ripemd160_32<u32x1>(digests_p, hashes_p);
+}
+
+
+SIMD_AVX2 __attribute__((flatten))
+void ripemd160_32_x8(hash256_t const * digests_p, hash_4_simd_t * hashes_p)
+{
+    ripemd160_32<u32x8>(digests_p, hashes_p);
+}
+
+
+SIMD_AVX512 __attribute__((flatten))
+void ripemd160_32_x16(hash256_t const * digests_p, hash_4_simd_t * hashes_p)
+{
+    ripemd160_32<u32x16>(digests_p, hashes_p);
+}
+
+
+template <unsigned int LANES, typename HashF>
+static
+void ripemd160_mb(hash256_t const * digests_p, hash_4_simd_t * hashes_p, std::size_t ndigests, HashF hash)
+{
+    auto const nfull = ndigests - ndigests % LANES;
+    for (std::size_t ix = 0; ix < nfull; ix += LANES)
+    {
+        hash(digests_p + ix, hashes_p + ix);
+    }
+
+    if (nfull != ndigests)
+    {
+        // partial group of lanes goes through a padded copy
+        std::array<hash256_t, LANES> digests{};
+        std::array<hash_4_simd_t, LANES> hashes;
+
+        std::copy(digests_p + nfull, digests_p + ndigests, digests.begin());
+        hash(digests.data(), hashes.data());
+        std::copy(hashes.cbegin(), hashes.cbegin() + (ndigests - nfull), hashes_p + nfull);
+    }
+}
+
+
+void ripemd160_32_mb(hash256_t const * digests_p, hash_4_simd_t * hashes_p, std::size_t ndigests)
+{
+    switch (cpu_kernels())
+    {
+        case CPU_KERNELS_AVX512:
+            ripemd160_mb<16>(digests_p, hashes_p, ndigests, ripemd160_32_x16);
+            break;
+        case CPU_KERNELS_AVX2:
+            ripemd160_mb<8>(digests_p, hashes_p, ndigests, ripemd160_32_x8);
+            break;
+        default:
+            ripemd160_mb<1>(digests_p, hashes_p, ndigests, ripemd160_32_x1);
+            break;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef RIPEMD160_MB_HPP
+#define RIPEMD160_MB_HPP
+
+#include "simd_u32.hpp"
+#include "unaddr.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+using hash256_t = std::array<std::uint8_t, 32>;
+
+// 160-bit hash zero-extended to the 32 bytes of an AVX2 register, aligned
+// as one whatever the build flags
+typedef union alignas(32)
+{
+    hash160_t h160;
+    hash256_t h256;
+} hash_4_simd_t;
+static_assert(sizeof (hash160_t) == 20u);
+static_assert(sizeof (hash256_t) == 32u);
+static_assert(sizeof (hash_4_simd_t) == 32u);
+
+
+// Multi-buffer RIPEMD-160 of 32-byte messages (SHA-256 digests), one message
+// per SIMD lane. A 32-byte message always fits a single block with fixed
+// padding. The 160-bit results are written zero-extended straight into
+// hash_4_simd_t. Bit-exact with RIPEMD160(digest.data(), digest.size(), h160).
+
+// a single digest, in general-purpose registers
+void ripemd160_32_x1(hash256_t const * digests_p, hash_4_simd_t * hashes_p);
+
+// 8 digests across AVX2 lanes
+void ripemd160_32_x8(hash256_t const * digests_p, hash_4_simd_t * hashes_p);
+
+// 16 digests across AVX-512 lanes
+void ripemd160_32_x16(hash256_t const * digests_p, hash_4_simd_t * hashes_p);
+
+// any number of digests, as many at a time as the kernels of cpu_kernels() take
+void ripemd160_32_mb(hash256_t const * digests_p, hash_4_simd_t * hashes_p, std::size_t ndigests);
+
+
+#endif /* RIPEMD160_MB_HPP */
@@ -4,6 +4,12 @@ set -e
 # Call executable passed as first argument, with remaining
 # arguments passed to it
 
+if [ "${1}" == "main" ]; then
+    # main runs its own pool of worker threads, one per cpu
+    ./${1} -t $(nproc) ${@: 2} | xz -9 > log.txt.xz
+    exit
+fi
+
 ./${1} ${@: 2} | xz -9 > log1.txt.xz &
 ./${1} ${@: 2} | xz -9 > log2.txt.xz &
 ./${1} ${@: 2} | xz -9 > log3.txt.xz &
@@ -0,0 +1,168 @@
+#include "sample_writer.hpp"
+#include "fd_io.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+
+// rows are handed to write(2) at least every this many bytes
+static constexpr std::size_t OUTPUT_CAPACITY = 1u << 20;
+
+// magic, version 1.0, header length, dictionary padded with spaces to this
+// many bytes in all, a multiple of 64 as numpy writes them
+static constexpr std::size_t NPY_HEADER_SIZE = 128;
+
+
+bool sample_format_parse(char const * s, sample_format_t & format)
+{
+    static char const * const NAMES[] = {"hex", "packed", "u8", "f32"};
+
+    for (auto fix = 0u; fix < sizeof (NAMES) / sizeof (NAMES[0]); ++fix)
+    {
+        if (std::strcmp(s, NAMES[fix]) == 0)
+        {
+            format = (sample_format_t)fix;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+static
+void write_all(sample_writer_t & writer, char const * p, std::size_t n)
+{
+    if (not fd_write_all(writer.fd, p, n))
+    {
+        if (not writer.failed)
+        {
+            fprintf(stderr, "[!] Failed to write samples: %s\n", strerror(errno));
+        }
+        writer.failed = true;
+    }
+}
+
+
+static
+void flush(sample_writer_t & writer)
+{
+    write_all(writer, writer.buf.data(), writer.buf.size());
+    writer.buf.clear();
+}
+
+
+static
+std::string npy_header(sample_writer_t const & writer)
+{
+    auto const packed = writer.format == SAMPLE_FORMAT_PACKED;
+    auto const ncols = packed ? (writer.nbits + 7) / 8 : writer.nbits;
+
+    char dict[NPY_HEADER_SIZE];
+    auto const len = snprintf(dict, sizeof (dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%lu, %lu), }",
+        writer.format == SAMPLE_FORMAT_F32 ? "<f4" : "|u1", writer.nrows, ncols);
+
+    std::string header("\x93NUMPY\x01\x00", 8);
+    std::uint16_t const header_len = NPY_HEADER_SIZE - 10;
+    header += (char)(header_len & 0xFF);
+    header += (char)(header_len >> 8);
+    header.append(dict, len);
+    header.append(NPY_HEADER_SIZE - 1 - header.size(), ' ');
+    header += '\n';
+
+    return header;
+}
+
+
+bool sample_writer_open(sample_writer_t & writer, int fd, sample_format_t format, bool npy, std::size_t nbits)
+{
+    writer.fd = fd;
+    writer.format = format;
+    writer.npy = npy;
+    writer.nbits = nbits;
+    writer.nrows = 0;
+    writer.npy_offset = 0;
+    writer.failed = false;
+    writer.buf.clear();
+    writer.buf.reserve(OUTPUT_CAPACITY + 4096);
+
+    // the header is written again once the rows are counted
+    if (npy)
+    {
+        writer.npy_offset = lseek(fd, 0, SEEK_CUR);
+        if (writer.npy_offset < 0)
+        {
+            fprintf(stderr, "[!] A .npy output must be a file\n");
+            return false;
+        }
+        writer.buf = npy_header(writer);
+    }
+
+    return true;
+}
+
+
+void sample_writer_push(sample_writer_t & writer, std::uint8_t const * packed_p)
+{
+    auto const nbits = writer.nbits;
+
+    switch (writer.format)
+    {
+        case SAMPLE_FORMAT_PACKED:
+            writer.buf.append(reinterpret_cast<char const *>(packed_p), (nbits + 7) / 8);
+            break;
+        case SAMPLE_FORMAT_U8:
+            for (std::size_t bix = 0; bix < nbits; ++bix)
+            {
+                writer.buf += (char)((packed_p[bix / 8] >> (7 - bix % 8)) & 1);
+            }
+            break;
+        case SAMPLE_FORMAT_F32:
+            for (std::size_t bix = 0; bix < nbits; ++bix)
+            {
+                float const x = (packed_p[bix / 8] >> (7 - bix % 8)) & 1;
+                writer.buf.append(reinterpret_cast<char const *>(&x), sizeof (x));
+            }
+            break;
+        default:
+            break;
+    }
+
+    ++writer.nrows;
+    if (writer.buf.size() >= OUTPUT_CAPACITY)
+    {
+        flush(writer);
+    }
+}
+
+
+void sample_writer_append(sample_writer_t & writer, std::string const & bytes)
+{
+    writer.buf += bytes;
+
+    if (writer.buf.size() >= OUTPUT_CAPACITY)
+    {
+        flush(writer);
+    }
+}
+
+
+bool sample_writer_close(sample_writer_t & writer)
+{
+    flush(writer);
+
+    if (writer.npy and not writer.failed)
+    {
+        auto const header = npy_header(writer);
+        if (pwrite(writer.fd, header.data(), header.size(), writer.npy_offset) != (ssize_t)header.size())
+        {
+            fprintf(stderr, "[!] Failed to write the .npy header: %s\n", strerror(errno));
+            writer.failed = true;
+        }
+    }
+
+    return not writer.failed;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#ifndef SAMPLE_WRITER_HPP
+#define SAMPLE_WRITER_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+
+enum sample_format_t
+{
+    SAMPLE_FORMAT_HEX = 0,  // the text lines of tgen
+    SAMPLE_FORMAT_PACKED,   // the bits of a row packed 8 per byte
+    SAMPLE_FORMAT_U8,       // one uint8 0 or 1 per bit
+    SAMPLE_FORMAT_F32,      // one little-endian float32 0.0 or 1.0 per bit
+};
+
+bool sample_format_parse(char const * s, sample_format_t & format);
+
+
+// Rows of bits of a dataset, written to fd through a large buffer handed
+// to write(2) whole, in one of the binary formats, optionally after a .npy
+// header. A row is given packed, most significant bit first, so that
+// numpy.unpackbits() turns packed rows into the u8 ones. The number of rows
+// is only known at the end, when it is written into the header in place:
+// the shape is padded to a fixed length and fd must be seekable.
+typedef struct
+{
+    int fd;
+    sample_format_t format;
+    bool npy;
+    std::size_t nbits;      // per row
+    std::uint64_t nrows;
+    std::int64_t npy_offset;    // of the header in fd
+    std::string buf;
+    bool failed;
+} sample_writer_t;
+
+
+bool sample_writer_open(sample_writer_t & writer, int fd, sample_format_t format, bool npy, std::size_t nbits);
+
+// One row of nbits bits, MSB first, from packed_p.
+void sample_writer_push(sample_writer_t & writer, std::uint8_t const * packed_p);
+
+// Bytes as they are, the text lines of SAMPLE_FORMAT_HEX.
+void sample_writer_append(sample_writer_t & writer, std::string const & bytes);
+
+// Write out what is left and the final .npy header, false if any write failed.
+bool sample_writer_close(sample_writer_t & writer);
+
+
+#endif /* SAMPLE_WRITER_HPP */
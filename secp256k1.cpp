@@ -0,0 +1,610 @@
+#include "secp256k1.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+using u128 = unsigned __int128;
+
+static constexpr std::uint64_t M52 = (std::uint64_t{1} << 52) - 1;
+static constexpr std::uint64_t M48 = (std::uint64_t{1} << 48) - 1;
+
+// 2^256 mod p, and 2^260 mod p for the products' columns from the fifth on
+static constexpr std::uint64_t P_FOLD = 0x1000003D1ULL;
+static constexpr std::uint64_t R_FOLD = P_FOLD << 4;
+
+// p in limbs; fe_sub adds 32 p to stay non-negative
+static constexpr fe_t P = {{0xFFFFEFFFFFC2FULL, M52, M52, M52, M48}};
+static constexpr unsigned int SUB_NP = 32;
+
+static constexpr fe_t FE_ZERO = {{0, 0, 0, 0, 0}};
+static constexpr fe_t FE_ONE = {{1, 0, 0, 0, 0}};
+static constexpr fe_t FE_SEVEN = {{7, 0, 0, 0, 0}};
+
+ge_t const SECP256K1_G =
+{
+    fe_const(0x79BE667EF9DCBBACULL, 0x55A06295CE870B07ULL, 0x029BFCDB2DCE28D9ULL, 0x59F2815B16F81798ULL),
+    fe_const(0x483ADA7726A3C465ULL, 0x5DA4FBFC0E1108A8ULL, 0xFD17B448A6855419ULL, 0x9C47D08FFB10D4B8ULL),
+    false,
+};
+
+
+// carries propagated and the top limb's excess folded back in, magnitude 1
+static inline __attribute__((always_inline))
+void fe_normalize_weak(fe_t & a)
+{
+    auto const top = a.v[4] >> 48;
+    a.v[4] &= M48;
+    a.v[0] += top * P_FOLD;
+    a.v[1] += a.v[0] >> 52;
+    a.v[0] &= M52;
+    a.v[2] += a.v[1] >> 52;
+    a.v[1] &= M52;
+    a.v[3] += a.v[2] >> 52;
+    a.v[2] &= M52;
+    a.v[4] += a.v[3] >> 52;
+    a.v[3] &= M52;
+}
+
+
+// the canonical representation, limbs in range and value below p
+static
+void fe_normalize(fe_t & a)
+{
+    // a carry out of the top may remain after one pass, never after two
+    fe_normalize_weak(a);
+    fe_normalize_weak(a);
+
+    // a >= p exactly when a + P_FOLD reaches 2^256, and then a - p is that sum less 2^256
+    if ((a.v[4] == M48) and ((a.v[3] & a.v[2] & a.v[1]) == M52) and (a.v[0] >= P.v[0]))
+    {
+        a.v[0] += P_FOLD;
+        a.v[1] += a.v[0] >> 52;
+        a.v[0] &= M52;
+        a.v[2] += a.v[1] >> 52;
+        a.v[1] &= M52;
+        a.v[3] += a.v[2] >> 52;
+        a.v[2] &= M52;
+        a.v[4] += a.v[3] >> 52;
+        a.v[3] &= M52;
+        a.v[4] &= M48;
+    }
+}
+
+
+fe_t fe_from_bytes(std::uint8_t const * be_p)
+{
+    std::uint64_t w[4];
+    for (auto ix = 0u; ix < 4; ++ix)
+    {
+        std::memcpy(&w[ix], be_p + 8 * ix, sizeof (w[ix]));
+        w[ix] = __builtin_bswap64(w[ix]);
+    }
+    return fe_const(w[0], w[1], w[2], w[3]);
+}
+
+
+void fe_to_bytes(fe_t const & a, std::uint8_t * be_p)
+{
+    auto n = a;
+    fe_normalize(n);
+
+    std::uint64_t const w[4] =
+    {
+        (n.v[3] >> 36) | (n.v[4] << 16),
+        (n.v[2] >> 24) | (n.v[3] << 28),
+        (n.v[1] >> 12) | (n.v[2] << 40),
+        n.v[0] | (n.v[1] << 52),
+    };
+    for (auto ix = 0u; ix < 4; ++ix)
+    {
+        auto const be = __builtin_bswap64(w[ix]);
+        std::memcpy(be_p + 8 * ix, &be, sizeof (be));
+    }
+}
+
+
+fe_t fe_add(fe_t const & a, fe_t const & b)
+{
+    fe_t r;
+    for (auto ix = 0u; ix < 5; ++ix)
+    {
+        r.v[ix] = a.v[ix] + b.v[ix];
+    }
+    return r;
+}
+
+
+fe_t fe_sub(fe_t const & a, fe_t const & b)
+{
+    // a + 32 p - b, every limb of 32 p exceeding those of a b of magnitude 31
+    fe_t r;
+    for (auto ix = 0u; ix < 5; ++ix)
+    {
+        r.v[ix] = a.v[ix] + SUB_NP * P.v[ix] - b.v[ix];
+    }
+    fe_normalize_weak(r);
+    return r;
+}
+
+
+fe_t fe_neg(fe_t const & a)
+{
+    return fe_sub(FE_ZERO, a);
+}
+
+
+// The product's columns c[0..8], c[k] the sum of the a[i] b[j] with i + j = k, reduced:
+// with limbs below 2^57 no column reaches 2^117. Columns 5 to 8 weigh 2^260 = R_FOLD,
+// carried among themselves first so each folds into its low counterpart as a 64-bit word.
+static inline __attribute__((always_inline))
+fe_t reduce_columns(u128 const (&c)[9])
+{
+    std::uint64_t h[5];
+    u128 acc = c[5];
+    h[0] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[6];
+    h[1] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[7];
+    h[2] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[8];
+    h[3] = (std::uint64_t)acc & M52;
+    h[4] = (std::uint64_t)(acc >> 52);
+
+    fe_t r;
+    acc = c[0] + (u128)h[0] * R_FOLD;
+    r.v[0] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[1] + (u128)h[1] * R_FOLD;
+    r.v[1] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[2] + (u128)h[2] * R_FOLD;
+    r.v[2] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[3] + (u128)h[3] * R_FOLD;
+    r.v[3] = (std::uint64_t)acc & M52;
+    acc = (acc >> 52) + c[4] + (u128)h[4] * R_FOLD;
+    r.v[4] = (std::uint64_t)acc & M48;
+
+    // and what is left above 2^256
+    acc = (acc >> 48) * P_FOLD + r.v[0];
+    r.v[0] = (std::uint64_t)acc & M52;
+    r.v[1] += (std::uint64_t)(acc >> 52);
+    r.v[2] += r.v[1] >> 52;
+    r.v[1] &= M52;
+
+    return r;
+}
+
+
+fe_t fe_mul(fe_t const & a, fe_t const & b)
+{
+    auto const * x = a.v;
+    auto const * y = b.v;
+
+    u128 const c[9] =
+    {
+        (u128)x[0] * y[0],
+        (u128)x[0] * y[1] + (u128)x[1] * y[0],
+        (u128)x[0] * y[2] + (u128)x[1] * y[1] + (u128)x[2] * y[0],
+        (u128)x[0] * y[3] + (u128)x[1] * y[2] + (u128)x[2] * y[1] + (u128)x[3] * y[0],
+        (u128)x[0] * y[4] + (u128)x[1] * y[3] + (u128)x[2] * y[2] + (u128)x[3] * y[1] + (u128)x[4] * y[0],
+        (u128)x[1] * y[4] + (u128)x[2] * y[3] + (u128)x[3] * y[2] + (u128)x[4] * y[1],
+        (u128)x[2] * y[4] + (u128)x[3] * y[3] + (u128)x[4] * y[2],
+        (u128)x[3] * y[4] + (u128)x[4] * y[3],
+        (u128)x[4] * y[4],
+    };
+
+    return reduce_columns(c);
+}
+
+
+fe_t fe_sqr(fe_t const & a)
+{
+    auto const * x = a.v;
+    std::uint64_t const d[4] = {2 * x[0], 2 * x[1], 2 * x[2], 2 * x[3]};
+
+    u128 const c[9] =
+    {
+        (u128)x[0] * x[0],
+        (u128)d[0] * x[1],
+        (u128)d[0] * x[2] + (u128)x[1] * x[1],
+        (u128)d[0] * x[3] + (u128)d[1] * x[2],
+        (u128)d[0] * x[4] + (u128)d[1] * x[3] + (u128)x[2] * x[2],
+        (u128)d[1] * x[4] + (u128)d[2] * x[3],
+        (u128)d[2] * x[4] + (u128)x[3] * x[3],
+        (u128)d[3] * x[4],
+        (u128)x[4] * x[4],
+    };
+
+    return reduce_columns(c);
+}
+
+
+static inline
+fe_t fe_sqr_n(fe_t a, unsigned int n)
+{
+    while (n-- != 0)
+    {
+        a = fe_sqr(a);
+    }
+    return a;
+}
+
+
+fe_t fe_inv(fe_t const & a)
+{
+    // a^(p-2) with an addition chain over the runs of ones of p-2:
+    // 255 squarings and 15 multiplications, xN standing for a^(2^N - 1)
+    auto const x2 = fe_mul(fe_sqr(a), a);
+    auto const x3 = fe_mul(fe_sqr(x2), a);
+    auto const x6 = fe_mul(fe_sqr_n(x3, 3), x3);
+    auto const x9 = fe_mul(fe_sqr_n(x6, 3), x3);
+    auto const x11 = fe_mul(fe_sqr_n(x9, 2), x2);
+    auto const x22 = fe_mul(fe_sqr_n(x11, 11), x11);
+    auto const x44 = fe_mul(fe_sqr_n(x22, 22), x22);
+    auto const x88 = fe_mul(fe_sqr_n(x44, 44), x44);
+    auto const x176 = fe_mul(fe_sqr_n(x88, 88), x88);
+    auto const x220 = fe_mul(fe_sqr_n(x176, 44), x44);
+    auto const x223 = fe_mul(fe_sqr_n(x220, 3), x3);
+
+    auto t = fe_mul(fe_sqr_n(x223, 23), x22);
+    t = fe_mul(fe_sqr_n(t, 5), a);
+    t = fe_mul(fe_sqr_n(t, 3), x2);
+    return fe_mul(fe_sqr_n(t, 2), a);
+}
+
+
+bool fe_is_zero(fe_t const & a)
+{
+    auto n = a;
+    fe_normalize(n);
+    return (n.v[0] | n.v[1] | n.v[2] | n.v[3] | n.v[4]) == 0;
+}
+
+
+bool fe_equal(fe_t const & a, fe_t const & b)
+{
+    return fe_is_zero(fe_sub(a, b));
+}
+
+
+bool ge_is_on_curve(ge_t const & a)
+{
+    if (a.infinity)
+    {
+        return true;
+    }
+
+    auto const x3 = fe_mul(fe_sqr(a.x), a.x);
+    return fe_equal(fe_sqr(a.y), fe_add(x3, FE_SEVEN));
+}
+
+
+void ge_to_uncompressed(ge_t const & a, std::uint8_t * out_p)
+{
+    out_p[0] = 0x04;
+    fe_to_bytes(a.x, out_p + 1);
+    fe_to_bytes(a.y, out_p + 33);
+}
+
+
+void gej_set_ge(gej_t & r, ge_t const & a)
+{
+    r.x = a.x;
+    r.y = a.y;
+    r.z = FE_ONE;
+    r.infinity = a.infinity;
+}
+
+
+void gej_set_infinity(gej_t & r)
+{
+    r.x = FE_ZERO;
+    r.y = FE_ZERO;
+    r.z = FE_ZERO;
+    r.infinity = true;
+}
+
+
+void gej_double(gej_t & r, gej_t const & a)
+{
+    // dbl-2009-l, a = 0; y is never 0 on secp256k1, there are no points of order 2
+    if (a.infinity)
+    {
+        r = a;
+        return;
+    }
+
+    auto const A = fe_sqr(a.x);
+    auto const B = fe_sqr(a.y);
+    auto const C = fe_sqr(B);
+    auto const XB = fe_add(a.x, B);
+    auto const D2 = fe_sub(fe_sub(fe_sqr(XB), A), C);
+    auto const D = fe_add(D2, D2);
+    auto const E = fe_add(fe_add(A, A), A);
+    auto const F = fe_sqr(E);
+    auto const C2 = fe_add(C, C);
+    auto const C4 = fe_add(C2, C2);
+    auto const C8 = fe_add(C4, C4);
+
+    auto const x = fe_sub(F, fe_add(D, D));
+    auto const y = fe_sub(fe_mul(E, fe_sub(D, x)), C8);
+    auto const YZ = fe_mul(a.y, a.z);
+
+    r.x = x;
+    r.y = y;
+    r.z = fe_add(YZ, YZ);
+    r.infinity = false;
+}
+
+
+// shared tail of the additions, given U1 = x1, U2 = x2, S1 = y1, S2 = y2 on a common Z and
+// the Z of the result but for the factor H
+static inline
+void gej_add_tail(gej_t & r, gej_t const & a, fe_t const & U1, fe_t const & U2, fe_t const & S1, fe_t const & S2, fe_t const & Z)
+{
+    auto const H = fe_sub(U2, U1);
+    auto const R = fe_sub(S2, S1);
+
+    if (fe_is_zero(H))
+    {
+        if (fe_is_zero(R))
+        {
+            // same point
+            gej_double(r, a);
+        }
+        else
+        {
+            // opposite points
+            gej_set_infinity(r);
+        }
+        return;
+    }
+
+    auto const HH = fe_sqr(H);
+    auto const HHH = fe_mul(H, HH);
+    auto const V = fe_mul(U1, HH);
+
+    auto const x = fe_sub(fe_sub(fe_sqr(R), HHH), fe_add(V, V));
+    auto const y = fe_sub(fe_mul(R, fe_sub(V, x)), fe_mul(S1, HHH));
+    auto const z = fe_mul(Z, H);
+
+    r.x = x;
+    r.y = y;
+    r.z = z;
+    r.infinity = false;
+}
+
+
+void gej_add(gej_t & r, gej_t const & a, gej_t const & b)
+{
+    if (a.infinity)
+    {
+        r = b;
+        return;
+    }
+    if (b.infinity)
+    {
+        r = a;
+        return;
+    }
+
+    auto const Z1Z1 = fe_sqr(a.z);
+    auto const Z2Z2 = fe_sqr(b.z);
+    auto const U1 = fe_mul(a.x, Z2Z2);
+    auto const U2 = fe_mul(b.x, Z1Z1);
+    auto const S1 = fe_mul(fe_mul(a.y, b.z), Z2Z2);
+    auto const S2 = fe_mul(fe_mul(b.y, a.z), Z1Z1);
+
+    gej_add_tail(r, a, U1, U2, S1, S2, fe_mul(a.z, b.z));
+}
+
+
+void gej_add_ge(gej_t & r, gej_t const & a, ge_t const & b)
+{
+    if (a.infinity)
+    {
+        gej_set_ge(r, b);
+        return;
+    }
+    if (b.infinity)
+    {
+        r = a;
+        return;
+    }
+
+    auto const Z1Z1 = fe_sqr(a.z);
+    auto const U2 = fe_mul(b.x, Z1Z1);
+    auto const S2 = fe_mul(fe_mul(b.y, a.z), Z1Z1);
+
+    gej_add_tail(r, a, a.x, U2, a.y, S2, a.z);
+}
+
+
+void ge_set_gej(ge_t & r, gej_t const & a)
+{
+    if (a.infinity)
+    {
+        r.x = FE_ZERO;
+        r.y = FE_ZERO;
+        r.infinity = true;
+        return;
+    }
+
+    auto const zi = fe_inv(a.z);
+    auto const zi2 = fe_sqr(zi);
+    auto const zi3 = fe_mul(zi2, zi);
+
+    r.x = fe_mul(a.x, zi2);
+    r.y = fe_mul(a.y, zi3);
+    r.infinity = false;
+}
+
+
+void ge_set_gej_batch(ge_t * r_p, gej_t const * a_p, std::size_t n)
+{
+    // prefix[ix]: product of the Zs of the finite points before ix
+    thread_local std::vector<fe_t> prefix;
+    prefix.resize(n);
+
+    auto acc = FE_ONE;
+    for (std::size_t ix = 0; ix < n; ++ix)
+    {
+        prefix[ix] = acc;
+        if (not a_p[ix].infinity)
+        {
+            acc = fe_mul(acc, a_p[ix].z);
+        }
+    }
+
+    // acc^-1 peeled back one Z at a time
+    auto inv = fe_inv(acc);
+    for (std::size_t ix = n; ix-- > 0; /* nop */)
+    {
+        auto const & a = a_p[ix];
+        if (a.infinity)
+        {
+            r_p[ix].x = FE_ZERO;
+            r_p[ix].y = FE_ZERO;
+            r_p[ix].infinity = true;
+            continue;
+        }
+
+        auto const zi = fe_mul(inv, prefix[ix]);
+        inv = fe_mul(inv, a.z);
+
+        auto const zi2 = fe_sqr(zi);
+        auto const zi3 = fe_mul(zi2, zi);
+        auto & r = r_p[ix];
+        r.x = fe_mul(a.x, zi2);
+        r.y = fe_mul(a.y, zi3);
+        r.infinity = false;
+    }
+}
+
+
+void ge_to_storage(ge_t const & a, ge_storage_t & r)
+{
+    std::uint8_t be[64];
+    fe_to_bytes(a.x, be);
+    fe_to_bytes(a.y, be + 32);
+
+    for (auto ix = 0u; ix < 4; ++ix)
+    {
+        std::memcpy(&r.x[ix], be + 8 * (3 - ix), sizeof (r.x[ix]));
+        std::memcpy(&r.y[ix], be + 32 + 8 * (3 - ix), sizeof (r.y[ix]));
+        r.x[ix] = __builtin_bswap64(r.x[ix]);
+        r.y[ix] = __builtin_bswap64(r.y[ix]);
+    }
+}
+
+
+void ge_from_storage(ge_t & r, ge_storage_t const & a)
+{
+    r.x = fe_const(a.x[3], a.x[2], a.x[1], a.x[0]);
+    r.y = fe_const(a.y[3], a.y[2], a.y[1], a.y[0]);
+    r.infinity = false;
+}
+
+
+std::size_t gen_table_npoints(unsigned int window_nbits)
+{
+    return (std::size_t{256} / window_nbits) << window_nbits;
+}
+
+
+void gen_table_fill(unsigned int window_nbits, ge_storage_t * points_p)
+{
+    auto const nentries = std::size_t{1} << window_nbits;
+    auto const nwindows = 256 / window_nbits;
+
+    // one window at a time, j B for the window's base B = 2^(window_nbits w) G
+    std::vector<gej_t> jac(nentries);
+    std::vector<ge_t> affine(nentries);
+
+    gej_t base_j;
+    gej_set_ge(base_j, SECP256K1_G);
+
+    for (auto wix = 0u; wix < nwindows; ++wix)
+    {
+        ge_t base;
+        ge_set_gej(base, base_j);
+
+        gej_set_infinity(jac[0]);
+        for (std::size_t jx = 1; jx < nentries; ++jx)
+        {
+            gej_add_ge(jac[jx], jac[jx - 1], base);
+        }
+        ge_set_gej_batch(affine.data(), jac.data(), nentries);
+
+        auto * row_p = points_p + wix * nentries;
+        row_p[0] = ge_storage_t{};
+        for (std::size_t jx = 1; jx < nentries; ++jx)
+        {
+            ge_to_storage(affine[jx], row_p[jx]);
+        }
+
+        for (auto dix = 0u; dix < window_nbits; ++dix)
+        {
+            gej_double(base_j, base_j);
+        }
+    }
+}
+
+
+// installed before any thread multiplies, only read after
+static gen_table_t g_gen_table = {0, nullptr};
+
+
+void gen_table_install(gen_table_t const & table)
+{
+    g_gen_table = table;
+}
+
+
+// the table used when none was installed, 4-bit windows, 64 KiB
+static
+gen_table_t const & builtin_gen_table()
+{
+    // built once, thread-safely, and only read after
+    static gen_table_t const table = []()
+    {
+        auto constexpr WINDOW_NBITS = 4u;
+        auto * points_p = new ge_storage_t[gen_table_npoints(WINDOW_NBITS)];
+
+        gen_table_fill(WINDOW_NBITS, points_p);
+
+        return gen_table_t{WINDOW_NBITS, points_p};
+    }();
+
+    return table;
+}
+
+
+void gej_mul_gen(gej_t & r, std::uint8_t const (&k)[32])
+{
+    auto const & table = (g_gen_table.points_p != nullptr) ? g_gen_table : builtin_gen_table();
+
+    // k as little-endian 64-bit words; windows never straddle two
+    std::uint64_t w[4];
+    for (auto ix = 0u; ix < 4; ++ix)
+    {
+        std::memcpy(&w[ix], k + 8 * (3 - ix), sizeof (w[ix]));
+        w[ix] = __builtin_bswap64(w[ix]);
+    }
+
+    auto const nbits = table.window_nbits;
+    auto const mask = (std::uint64_t{1} << nbits) - 1;
+
+    gej_set_infinity(r);
+
+    for (auto wix = 0u, bit = 0u; bit < 256; ++wix, bit += nbits)
+    {
+        auto const j = (w[bit / 64] >> (bit % 64)) & mask;
+
+        if (j != 0)
+        {
+            ge_t point;
+            ge_from_storage(point, table.points_p[((std::size_t)wix << nbits) + j]);
+            gej_add_ge(r, r, point);
+        }
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#ifndef SECP256K1_HPP
+#define SECP256K1_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+
+// Fixed-width arithmetic on secp256k1, y^2 = x^3 + 7 over p = 2^256 - 2^32 - 977.
+//
+// Field elements are five 52-bit limbs, value sum(v[i] 2^(52 i)), the top
+// limb holding 48 bits. Products are plain 64x64-bit multiplications summed
+// per column in 128 bits, without carry chains, and reduced with the special
+// form of p, 2^256 = 2^32 + 977 (mod p), instead of generic Montgomery
+// arithmetic on variable-length BIGNUMs.
+//
+// Results are only weakly reduced: limbs may run a few bits over and the
+// value over p. fe_to_bytes, fe_is_zero and fe_equal reduce fully.
+// Magnitude m means limbs of at most m times their full width; fe_mul and
+// fe_sqr take up to 32 and return 1, fe_sub takes a subtrahend of up to 31
+// and returns 1, fe_add returns the sum of the magnitudes of its inputs.
+//
+// Points are affine (ge_t) or Jacobian (gej_t, x = X / Z^2, y = Y / Z^3),
+// with coordinates of magnitude at most 2. Nothing here is constant time; it
+// generates candidate keys, it does not handle secrets.
+typedef struct
+{
+    std::uint64_t v[5];
+} fe_t;
+
+// the element with the given 64-bit words, most significant first
+static constexpr inline
+fe_t fe_const(std::uint64_t w3, std::uint64_t w2, std::uint64_t w1, std::uint64_t w0)
+{
+    auto constexpr M52 = (std::uint64_t{1} << 52) - 1;
+
+    return {{
+        w0 & M52,
+        ((w0 >> 52) | (w1 << 12)) & M52,
+        ((w1 >> 40) | (w2 << 24)) & M52,
+        ((w2 >> 28) | (w3 << 36)) & M52,
+        w3 >> 16,
+    }};
+}
+
+typedef struct
+{
+    fe_t x;
+    fe_t y;
+    bool infinity;
+} ge_t;
+
+typedef struct
+{
+    fe_t x;
+    fe_t y;
+    fe_t z;
+    bool infinity;
+} gej_t;
+
+
+// big-endian 32 bytes, which must encode a value below p
+fe_t fe_from_bytes(std::uint8_t const * be_p);
+// fully reduced
+void fe_to_bytes(fe_t const & a, std::uint8_t * be_p);
+
+fe_t fe_add(fe_t const & a, fe_t const & b);
+fe_t fe_sub(fe_t const & a, fe_t const & b);
+// -a, a of magnitude up to 31
+fe_t fe_neg(fe_t const & a);
+fe_t fe_mul(fe_t const & a, fe_t const & b);
+fe_t fe_sqr(fe_t const & a);
+
+// a^(p-2), 1/a for a != 0
+fe_t fe_inv(fe_t const & a);
+
+bool fe_is_zero(fe_t const & a);
+bool fe_equal(fe_t const & a, fe_t const & b);
+
+
+// the generator, and the group order n in hex for BN_hex2bn
+extern ge_t const SECP256K1_G;
+static constexpr char const SECP256K1_ORDER_HEX[] = "FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFEBAAEDCE6AF48A03BBFD25E8CD0364141";
+
+bool ge_is_on_curve(ge_t const & a);
+
+// 04 x y, 65 bytes
+void ge_to_uncompressed(ge_t const & a, std::uint8_t * out_p);
+
+void gej_set_ge(gej_t & r, ge_t const & a);
+void gej_set_infinity(gej_t & r);
+
+// r may alias the inputs in all of these
+void gej_double(gej_t & r, gej_t const & a);
+void gej_add(gej_t & r, gej_t const & a, gej_t const & b);
+// mixed addition, cheaper than gej_add
+void gej_add_ge(gej_t & r, gej_t const & a, ge_t const & b);
+
+void ge_set_gej(ge_t & r, gej_t const & a);
+
+// n points to affine at the price of a single field inversion (Montgomery's
+// trick); points at infinity are allowed and stay so
+void ge_set_gej_batch(ge_t * r_p, gej_t const * a_p, std::size_t n);
+
+// Affine points as stored in generator tables: fully reduced coordinates
+// in little-endian 64-bit words, 64 bytes.
+typedef struct
+{
+    std::uint64_t x[4];
+    std::uint64_t y[4];
+} ge_storage_t;
+
+void ge_to_storage(ge_t const & a, ge_storage_t & r);
+void ge_from_storage(ge_t & r, ge_storage_t const & a);
+
+// Multiples of G for gej_mul_gen in windows of window_nbits bits of the
+// scalar, 4, 8 or 16: points_p[(w << window_nbits) + j] = j 2^(window_nbits w) G,
+// entry j = 0 unused.
+typedef struct
+{
+    unsigned int window_nbits;
+    ge_storage_t const * points_p;
+} gen_table_t;
+
+std::size_t gen_table_npoints(unsigned int window_nbits);
+
+// Compute the gen_table_npoints(window_nbits) points of a table.
+void gen_table_fill(unsigned int window_nbits, ge_storage_t * points_p);
+
+// Make gej_mul_gen use the given table, which must stay valid; to be
+// called before any thread multiplies. Without, gej_mul_gen builds a
+// table of 4-bit windows on first use.
+void gen_table_install(gen_table_t const & table);
+
+// k G, k a big-endian 256-bit scalar taken mod the group order.
+// Sums one precomputed multiple of G per window of k, 256 / window_nbits
+// mixed additions at most and no doublings.
+void gej_mul_gen(gej_t & r, std::uint8_t const (&k)[32]);
+
+
+#endif /* SECP256K1_HPP */
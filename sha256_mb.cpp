@@ -0,0 +1,321 @@
+#include "sha256_mb.hpp"
+#include "simd_u32.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <algorithm>
+
+
+static_assert(sizeof (uncompressed_key_t) == 65u, "keys must be packed back to back");
+
+
+static constexpr std::uint32_t K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static constexpr std::uint32_t H0[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+// second block of a 65-byte message: key byte 64, 0x80, zeros, bit length
+static constexpr std::uint32_t PAD_W0 = 0x00800000;
+static constexpr std::uint32_t PAD_W15 = 65 * 8;
+
+// single block of a 33-byte message: key bytes 29..32 end in word 8, followed by 0x80
+static constexpr std::uint32_t PAD33_W8 = 0x00800000;
+static constexpr std::uint32_t PAD33_W15 = 33 * 8;
+
+
+template <typename V>
+static inline __attribute__((always_inline))
+void round(
+    typename V::vec_t a, typename V::vec_t b, typename V::vec_t c, typename V::vec_t & d,
+    typename V::vec_t e, typename V::vec_t f, typename V::vec_t g, typename V::vec_t & h,
+    typename V::vec_t kw)
+{
+    auto const S1 = V::xor3(V::template ror<6>(e), V::template ror<11>(e), V::template ror<25>(e));
+    auto const T1 = V::add(V::add(h, S1), V::add(V::ch(e, f, g), kw));
+    auto const S0 = V::xor3(V::template ror<2>(a), V::template ror<13>(a), V::template ror<22>(a));
+    auto const T2 = V::add(S0, V::maj(a, b, c));
+
+    d = V::add(d, T1);
+    h = V::add(T1, T2);
+}
+
+
+template <typename V>
+static inline __attribute__((always_inline))
+typename V::vec_t sigma0(typename V::vec_t x)
+{
+    return V::xor3(V::template ror<7>(x), V::template ror<18>(x), V::template shr<3>(x));
+}
+
+
+template <typename V>
+static inline __attribute__((always_inline))
+typename V::vec_t sigma1(typename V::vec_t x)
+{
+    return V::xor3(V::template ror<17>(x), V::template ror<19>(x), V::template shr<10>(x));
+}
+
+
+// 64 rounds over the message schedule w[0..63], w[16..63] is expanded in place
+template <typename V, typename IsZeroF>
+static inline __attribute__((always_inline))
+void compress(typename V::vec_t (&state)[8], typename V::vec_t (&w)[64], IsZeroF is_zero)
+{
+    using vec_t = typename V::vec_t;
+
+#pragma GCC unroll 48
+    for (auto t = 16u; t < 64u; ++t)
+    {
+        // the zero words of the padding block are known at compile time, their terms drop out
+        vec_t x = is_zero(t - 2) ? V::set1(0) : sigma1<V>(w[t - 2]);
+        if (not is_zero(t - 7))
+        {
+            x = V::add(x, w[t - 7]);
+        }
+        if (not is_zero(t - 15))
+        {
+            x = V::add(x, sigma0<V>(w[t - 15]));
+        }
+        if (not is_zero(t - 16))
+        {
+            x = V::add(x, w[t - 16]);
+        }
+        w[t] = x;
+    }
+
+    vec_t a = state[0], b = state[1], c = state[2], d = state[3];
+    vec_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+#pragma GCC unroll 8
+    for (auto t = 0u; t < 64u; t += 8)
+    {
+        auto const kw = [&w, &is_zero](unsigned int ix)
+        {
+            return is_zero(ix) ? V::set1(K[ix]) : V::add(V::set1(K[ix]), w[ix]);
+        };
+
+        round<V>(a, b, c, d, e, f, g, h, kw(t + 0));
+        round<V>(h, a, b, c, d, e, f, g, kw(t + 1));
+        round<V>(g, h, a, b, c, d, e, f, kw(t + 2));
+        round<V>(f, g, h, a, b, c, d, e, kw(t + 3));
+        round<V>(e, f, g, h, a, b, c, d, kw(t + 4));
+        round<V>(d, e, f, g, h, a, b, c, kw(t + 5));
+        round<V>(c, d, e, f, g, h, a, b, kw(t + 6));
+        round<V>(b, c, d, e, f, g, h, a, kw(t + 7));
+    }
+
+    state[0] = V::add(state[0], a);
+    state[1] = V::add(state[1], b);
+    state[2] = V::add(state[2], c);
+    state[3] = V::add(state[3], d);
+    state[4] = V::add(state[4], e);
+    state[5] = V::add(state[5], f);
+    state[6] = V::add(state[6], g);
+    state[7] = V::add(state[7], h);
+}
+
+
+// Digest words of V::LANES keys, lane i holding key i; words are in SHA-256 (big-endian) order
+template <typename V>
+static inline __attribute__((always_inline))
+void sha256_65_state(uncompressed_key_t const * keys_p, typename V::vec_t (&state)[8])
+{
+    using vec_t = typename V::vec_t;
+    auto const * bytes_p = keys_p->data();
+
+    for (auto ix = 0u; ix < 8; ++ix)
+    {
+        state[ix] = V::set1(H0[ix]);
+    }
+
+    {
+        vec_t w[64];
+        for (auto t = 0u; t < 16; ++t)
+        {
+            w[t] = V::bswap(V::template gather<65>(bytes_p + 4 * t));
+        }
+
+        compress<V>(state, w, [](unsigned int){ return false; });
+    }
+
+    {
+        // little-endian load of bytes 61..64 leaves byte 64 in the top byte, right where W0 wants it
+        vec_t w[64];
+        w[0] = V::or_(V::and_(V::template gather<65>(bytes_p + 61), V::set1(0xFF000000)), V::set1(PAD_W0));
+        for (auto t = 1u; t < 15; ++t)
+        {
+            w[t] = V::set1(0);
+        }
+        w[15] = V::set1(PAD_W15);
+
+        compress<V>(state, w, [](unsigned int ix){ return (ix >= 1) and (ix <= 14); });
+    }
+}
+
+
+// Same for the 33-byte compressed encodings of the keys, 02 or 03 after the
+// parity of y followed by x, read straight out of the uncompressed keys
+template <typename V>
+static inline __attribute__((always_inline))
+void sha256_33_state(uncompressed_key_t const * keys_p, typename V::vec_t (&state)[8])
+{
+    using vec_t = typename V::vec_t;
+    auto const * bytes_p = keys_p->data();
+
+    for (auto ix = 0u; ix < 8; ++ix)
+    {
+        state[ix] = V::set1(H0[ix]);
+    }
+
+    vec_t w[64];
+
+    // little-endian load of bytes 61..64 leaves the last byte of y, and its parity, in the top byte
+    auto const prefix = V::or_(V::and_(V::template shr<24>(V::template gather<65>(bytes_p + 61)), V::set1(1)), V::set1(2));
+    w[0] = V::or_(V::and_(V::bswap(V::template gather<65>(bytes_p)), V::set1(0x00FFFFFF)), V::template rol<24>(prefix));
+
+    // compressed byte i is uncompressed byte i past the header byte
+    for (auto t = 1u; t < 8; ++t)
+    {
+        w[t] = V::bswap(V::template gather<65>(bytes_p + 4 * t));
+    }
+    w[8] = V::or_(V::and_(V::template gather<65>(bytes_p + 29), V::set1(0xFF000000)), V::set1(PAD33_W8));
+    for (auto t = 9u; t < 15; ++t)
+    {
+        w[t] = V::set1(0);
+    }
+    w[15] = V::set1(PAD33_W15);
+
+    compress<V>(state, w, [](unsigned int ix){ return (ix >= 9) and (ix <= 14); });
+}
+
+
+template <typename V, bool COMPRESSED>
+static inline __attribute__((always_inline))
+void sha256_keys(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    static_assert(sizeof (hash256_t) == 8 * sizeof (std::uint32_t));
+
+    typename V::vec_t state[8];
+    if constexpr (COMPRESSED)
+    {
+        sha256_33_state<V>(keys_p, state);
+    }
+    else
+    {
+        sha256_65_state<V>(keys_p, state);
+    }
+
+    for (auto & word : state)
+    {
+        word = V::bswap(word);
+    }
+    V::store_transposed(digests_p, state);
+}
+
+
+void sha256_65_x1(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x1, false>(keys_p, digests_p);
+}
+
+
+void sha256_33_x1(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x1, true>(keys_p, digests_p);
+}
+
+
+SIMD_AVX2 __attribute__((flatten))
+void sha256_65_x8(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x8, false>(keys_p, digests_p);
+}
+
+
+SIMD_AVX2 __attribute__((flatten))
+void sha256_33_x8(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x8, true>(keys_p, digests_p);
+}
+
+
+SIMD_AVX512 __attribute__((flatten))
+void sha256_65_x16(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x16, false>(keys_p, digests_p);
+}
+
+
+SIMD_AVX512 __attribute__((flatten))
+void sha256_33_x16(uncompressed_key_t const * keys_p, hash256_t * digests_p)
+{
+    sha256_keys<u32x16, true>(keys_p, digests_p);
+}
+
+
+template <unsigned int LANES, typename HashF>
+static
+void sha256_mb(uncompressed_key_t const * keys_p, hash256_t * digests_p, std::size_t nkeys, HashF hash)
+{
+    auto const nfull = nkeys - nkeys % LANES;
+    for (std::size_t ix = 0; ix < nfull; ix += LANES)
+    {
+        hash(keys_p + ix, digests_p + ix);
+    }
+
+    if (nfull != nkeys)
+    {
+        // partial group of lanes goes through a padded copy
+        std::array<uncompressed_key_t, LANES> keys{};
+        std::array<hash256_t, LANES> digests;
+
+        std::copy(keys_p + nfull, keys_p + nkeys, keys.begin());
+        hash(keys.data(), digests.data());
+        std::copy(digests.cbegin(), digests.cbegin() + (nkeys - nfull), digests_p + nfull);
+    }
+}
+
+
+void sha256_65_mb(uncompressed_key_t const * keys_p, hash256_t * digests_p, std::size_t nkeys)
+{
+    switch (cpu_kernels())
+    {
+        case CPU_KERNELS_AVX512:
+            sha256_mb<16>(keys_p, digests_p, nkeys, sha256_65_x16);
+            break;
+        case CPU_KERNELS_AVX2:
+            sha256_mb<8>(keys_p, digests_p, nkeys, sha256_65_x8);
+            break;
+        default:
+            sha256_mb<1>(keys_p, digests_p, nkeys, sha256_65_x1);
+            break;
+    }
+}
+
+
+void sha256_33_mb(uncompressed_key_t const * keys_p, hash256_t * digests_p, std::size_t nkeys)
+{
+    switch (cpu_kernels())
+    {
+        case CPU_KERNELS_AVX512:
+            sha256_mb<16>(keys_p, digests_p, nkeys, sha256_33_x16);
+            break;
+        case CPU_KERNELS_AVX2:
+            sha256_mb<8>(keys_p, digests_p, nkeys, sha256_33_x8);
+            break;
+        default:
+            sha256_mb<1>(keys_p, digests_p, nkeys, sha256_33_x1);
+            break;
+    }
+}
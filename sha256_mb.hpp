@@ -0,0 +1,46 @@
+#pragma once
+
+#ifndef SHA256_MB_HPP
+#define SHA256_MB_HPP
+
+#include "simd_u32.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+using uncompressed_key_t = std::array<std::uint8_t, 65>;
+using hash256_t = std::array<std::uint8_t, 32>;
+
+
+// Multi-buffer SHA-256 of 65-byte uncompressed public keys, hashing one key
+// per SIMD lane. The message length is fixed, so the padding block and most
+// of its message schedule are compile-time constants. Bit-exact with
+// SHA256(key.data(), key.size(), digest).
+
+// a single key, in general-purpose registers
+void sha256_65_x1(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+
+// 8 keys across AVX2 lanes
+void sha256_65_x8(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+
+// 16 keys across AVX-512 lanes
+void sha256_65_x16(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+
+// any number of keys, as many at a time as the kernels of cpu_kernels() take
+void sha256_65_mb(uncompressed_key_t const * keys_p, hash256_t * digests_p, std::size_t nkeys);
+
+
+// SHA-256 of the 33-byte compressed encodings of the same keys, built in the
+// lanes from x and the parity of y, so a point is serialized only once.
+// Single block, bit-exact with SHA256 of the EC_POINT_point2oct compressed
+// encoding.
+void sha256_33_x1(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+void sha256_33_x8(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+void sha256_33_x16(uncompressed_key_t const * keys_p, hash256_t * digests_p);
+
+void sha256_33_mb(uncompressed_key_t const * keys_p, hash256_t * digests_p, std::size_t nkeys);
+
+
+#endif /* SHA256_MB_HPP */
@@ -0,0 +1,237 @@
+#pragma once
+
+#ifndef SIMD_U32_HPP
+#define SIMD_U32_HPP
+
+#include <cstdint>
+
+#include <immintrin.h>
+
+
+// Lanes of 32-bit words processed together by the multi-buffer hash kernels:
+// one in plain integer registers, 8 in AVX2 or 16 in AVX-512 registers.
+//
+// The tools are built for a baseline x86-64, and the vector lanes for the
+// instruction set they need through target attributes, so that one binary
+// runs everywhere and picks its kernels at startup, see cpu_dispatch.hpp.
+// Kernels generic in the lanes are inlined into entry points carrying the
+// same attribute, SIMD_AVX2 or SIMD_AVX512, and flatten.
+#define SIMD_AVX2 __attribute__((target("avx2,bmi,bmi2")))
+#define SIMD_AVX512 __attribute__((target("avx2,bmi,bmi2,avx512f,avx512bw,avx512vl")))
+
+
+// one lane in a general-purpose register
+struct u32x1
+{
+    using vec_t = std::uint32_t;
+    static constexpr unsigned int LANES = 1;
+
+    static vec_t set1(std::uint32_t x) { return x; }
+    static vec_t add(vec_t a, vec_t b) { return a + b; }
+    static vec_t and_(vec_t a, vec_t b) { return a & b; }
+    static vec_t or_(vec_t a, vec_t b) { return a | b; }
+    static vec_t xor_(vec_t a, vec_t b) { return a ^ b; }
+    static vec_t xor3(vec_t a, vec_t b, vec_t c) { return a ^ b ^ c; }
+    static vec_t not_(vec_t a) { return ~a; }
+    template <int N> static vec_t shr(vec_t x) { return x >> N; }
+    template <int N> static vec_t ror(vec_t x) { return (x >> N) | (x << (32 - N)); }
+    template <int N> static vec_t rol(vec_t x) { return (x << N) | (x >> (32 - N)); }
+
+    static vec_t ch(vec_t e, vec_t f, vec_t g) { return g ^ (e & (f ^ g)); }
+    static vec_t maj(vec_t a, vec_t b, vec_t c) { return (a & b) | (c & (a | b)); }
+
+    static vec_t bswap(vec_t x) { return __builtin_bswap32(x); }
+
+    template <int STRIDE>
+    static vec_t gather(std::uint8_t const * p)
+    {
+        vec_t x;
+        __builtin_memcpy(&x, p, sizeof (x));
+        return x;
+    }
+
+    static void load_transposed(void const * p, vec_t (&rows)[8])
+    {
+        __builtin_memcpy(rows, p, sizeof (rows));
+    }
+
+    static void store_transposed(void * p, vec_t (&rows)[8])
+    {
+        __builtin_memcpy(p, rows, sizeof (rows));
+    }
+};
+
+
+// 8x8 transpose of 32-bit words: row i of the output holds word i of every input row
+static inline SIMD_AVX2
+void transpose_8x8(__m256i (&r)[8])
+{
+    auto const t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    auto const t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    auto const t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    auto const t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    auto const t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    auto const t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    auto const t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    auto const t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    auto const u0 = _mm256_unpacklo_epi64(t0, t2);
+    auto const u1 = _mm256_unpackhi_epi64(t0, t2);
+    auto const u2 = _mm256_unpacklo_epi64(t1, t3);
+    auto const u3 = _mm256_unpackhi_epi64(t1, t3);
+    auto const u4 = _mm256_unpacklo_epi64(t4, t6);
+    auto const u5 = _mm256_unpackhi_epi64(t4, t6);
+    auto const u6 = _mm256_unpacklo_epi64(t5, t7);
+    auto const u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    r[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    r[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    r[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    r[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    r[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    r[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    r[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    r[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+// 8 lanes of 32-bit words in an AVX2 register
+struct u32x8
+{
+    using vec_t = __m256i;
+    static constexpr unsigned int LANES = 8;
+
+    SIMD_AVX2 static vec_t set1(std::uint32_t x) { return _mm256_set1_epi32(x); }
+    SIMD_AVX2 static vec_t add(vec_t a, vec_t b) { return _mm256_add_epi32(a, b); }
+    SIMD_AVX2 static vec_t and_(vec_t a, vec_t b) { return _mm256_and_si256(a, b); }
+    SIMD_AVX2 static vec_t or_(vec_t a, vec_t b) { return _mm256_or_si256(a, b); }
+    SIMD_AVX2 static vec_t xor_(vec_t a, vec_t b) { return _mm256_xor_si256(a, b); }
+    SIMD_AVX2 static vec_t xor3(vec_t a, vec_t b, vec_t c) { return _mm256_xor_si256(_mm256_xor_si256(a, b), c); }
+    SIMD_AVX2 static vec_t not_(vec_t a) { return _mm256_xor_si256(a, _mm256_set1_epi32(-1)); }
+    template <int N> SIMD_AVX2 static vec_t shr(vec_t x) { return _mm256_srli_epi32(x, N); }
+    template <int N> SIMD_AVX2 static vec_t ror(vec_t x) { return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N)); }
+    template <int N> SIMD_AVX2 static vec_t rol(vec_t x) { return _mm256_or_si256(_mm256_slli_epi32(x, N), _mm256_srli_epi32(x, 32 - N)); }
+
+    // e ? f : g
+    SIMD_AVX2 static vec_t ch(vec_t e, vec_t f, vec_t g) { return _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g))); }
+    SIMD_AVX2 static vec_t maj(vec_t a, vec_t b, vec_t c) { return _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b))); }
+
+    // byte swap of every word
+    SIMD_AVX2 static vec_t bswap(vec_t x)
+    {
+        auto const shuf = _mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        return _mm256_shuffle_epi8(x, shuf);
+    }
+
+    // 32-bit word at p + lane * STRIDE of every lane
+    template <int STRIDE>
+    SIMD_AVX2 static vec_t gather(std::uint8_t const * p)
+    {
+        auto const idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(STRIDE));
+        return _mm256_i32gather_epi32((int const *)p, idx, 1);
+    }
+
+    // LANES records of 8 words each, lane i <-> record i, word j <-> rows[j]
+    SIMD_AVX2 static void load_transposed(void const * p, vec_t (&rows)[8])
+    {
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            rows[ix] = _mm256_loadu_si256((__m256i const *)p + ix);
+        }
+        transpose_8x8(rows);
+    }
+
+    SIMD_AVX2 static void store_transposed(void * p, vec_t (&rows)[8])
+    {
+        transpose_8x8(rows);
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            _mm256_storeu_si256((__m256i *)p + ix, rows[ix]);
+        }
+    }
+};
+
+
+// 16 lanes of 32-bit words in an AVX-512 register
+struct u32x16
+{
+    using vec_t = __m512i;
+    static constexpr unsigned int LANES = 16;
+
+    SIMD_AVX512 static vec_t set1(std::uint32_t x) { return _mm512_set1_epi32(x); }
+    SIMD_AVX512 static vec_t add(vec_t a, vec_t b) { return _mm512_add_epi32(a, b); }
+    SIMD_AVX512 static vec_t and_(vec_t a, vec_t b) { return _mm512_and_si512(a, b); }
+    SIMD_AVX512 static vec_t or_(vec_t a, vec_t b) { return _mm512_or_si512(a, b); }
+    SIMD_AVX512 static vec_t xor_(vec_t a, vec_t b) { return _mm512_xor_si512(a, b); }
+    SIMD_AVX512 static vec_t xor3(vec_t a, vec_t b, vec_t c) { return _mm512_ternarylogic_epi32(a, b, c, 0x96); }
+    SIMD_AVX512 static vec_t not_(vec_t a) { return _mm512_ternarylogic_epi32(a, a, a, 0x55); }
+    template <int N> SIMD_AVX512 static vec_t shr(vec_t x) { return _mm512_srli_epi32(x, N); }
+    template <int N> SIMD_AVX512 static vec_t ror(vec_t x) { return _mm512_ror_epi32(x, N); }
+    template <int N> SIMD_AVX512 static vec_t rol(vec_t x) { return _mm512_rol_epi32(x, N); }
+
+    // arbitrary boolean function of three operands, IMM is its truth table
+    template <int IMM> SIMD_AVX512 static vec_t ternlog(vec_t a, vec_t b, vec_t c) { return _mm512_ternarylogic_epi32(a, b, c, IMM); }
+
+    SIMD_AVX512 static vec_t ch(vec_t e, vec_t f, vec_t g) { return _mm512_ternarylogic_epi32(e, f, g, 0xCA); }
+    SIMD_AVX512 static vec_t maj(vec_t a, vec_t b, vec_t c) { return _mm512_ternarylogic_epi32(a, b, c, 0xE8); }
+
+    SIMD_AVX512 static vec_t bswap(vec_t x)
+    {
+        auto const shuf = _mm512_set4_epi32(0x0C0D0E0F, 0x08090A0B, 0x04050607, 0x00010203);
+        return _mm512_shuffle_epi8(x, shuf);
+    }
+
+    template <int STRIDE>
+    SIMD_AVX512 static vec_t gather(std::uint8_t const * p)
+    {
+        auto const idx = _mm512_mullo_epi32(
+            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+            _mm512_set1_epi32(STRIDE));
+        return _mm512_i32gather_epi32(idx, (int const *)p, 1);
+    }
+
+    // two 8x8 transposes, one per half of the lanes
+    SIMD_AVX512 static void load_transposed(void const * p, vec_t (&rows)[8])
+    {
+        __m256i lo[8];
+        __m256i hi[8];
+
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            lo[ix] = _mm256_loadu_si256((__m256i const *)p + ix);
+            hi[ix] = _mm256_loadu_si256((__m256i const *)p + 8 + ix);
+        }
+        transpose_8x8(lo);
+        transpose_8x8(hi);
+
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            rows[ix] = _mm512_inserti64x4(_mm512_castsi256_si512(lo[ix]), hi[ix], 1);
+        }
+    }
+
+    SIMD_AVX512 static void store_transposed(void * p, vec_t (&rows)[8])
+    {
+        __m256i lo[8];
+        __m256i hi[8];
+
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            lo[ix] = _mm512_castsi512_si256(rows[ix]);
+            hi[ix] = _mm512_extracti64x4_epi64(rows[ix], 1);
+        }
+        transpose_8x8(lo);
+        transpose_8x8(hi);
+
+        for (auto ix = 0u; ix < 8; ++ix)
+        {
+            _mm256_storeu_si256((__m256i *)p + ix, lo[ix]);
+            _mm256_storeu_si256((__m256i *)p + 8 + ix, hi[ix]);
+        }
+    }
+};
+
+
+#endif /* SIMD_U32_HPP */
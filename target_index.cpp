@@ -0,0 +1,127 @@
+#include "target_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+// bits [offset, offset + nbits) of the 160-bit hash, read as a little-endian integer
+static inline
+std::uint32_t chunk_of(hash_4_simd_t const & h, unsigned int offset, unsigned int nbits)
+{
+    std::uint64_t x;
+    std::memcpy(&x, h.h256.data() + offset / 8, sizeof (x));
+
+    return (x >> (offset % 8)) & ((1ULL << nbits) - 1);
+}
+
+
+static inline
+std::uint32_t bucket_of(std::uint32_t value, unsigned int chunk_nbits, unsigned int bucket_nbits)
+{
+    if (chunk_nbits <= bucket_nbits)
+    {
+        return value;
+    }
+
+    // multiplicative hashing, top bits of the product
+    return (std::uint32_t)(value * 0x9E3779B1U) >> (32 - bucket_nbits);
+}
+
+
+bool target_index_build(
+    target_index_t & index,
+    hash_4_simd_t const * hashes_p, std::size_t ntargets,
+    unsigned int min_match_nbits)
+{
+    // a run of n >= 2c - 1 bits always covers an aligned chunk of c bits
+    auto const chunk_nbits = std::min(32u, (min_match_nbits + 1) / 2);
+
+    std::vector<unsigned int> chunk_offsets;
+    for (auto offset = 0u; offset + chunk_nbits <= 160; offset += chunk_nbits)
+    {
+        chunk_offsets.push_back(offset);
+    }
+
+    // a candidate agrees with a random target on a given chunk with probability 2^-c;
+    // when that summed over all chunks is not small most targets end up verified anyway
+    if ((chunk_nbits < 32) and (chunk_offsets.size() * 8 > (1ULL << chunk_nbits)))
+    {
+        return false;
+    }
+
+    // about one target per bucket, capped by the number of distinct chunk values
+    auto bucket_nbits = 1u;
+    while (((1ULL << bucket_nbits) < ntargets) and (bucket_nbits < 24))
+    {
+        ++bucket_nbits;
+    }
+    bucket_nbits = std::min(bucket_nbits, chunk_nbits);
+
+    index.chunk_nbits = chunk_nbits;
+    index.bucket_nbits = bucket_nbits;
+    index.chunk_offsets = chunk_offsets;
+    index.bucket_starts.assign(chunk_offsets.size(), {});
+    index.entries.assign(chunk_offsets.size(), {});
+
+    auto const NBUCKETS = 1u << bucket_nbits;
+
+    for (auto cix = 0u; cix < chunk_offsets.size(); ++cix)
+    {
+        auto & starts = index.bucket_starts[cix];
+        auto & entries = index.entries[cix];
+
+        // counting sort of the targets by bucket
+        starts.assign(NBUCKETS + 1, 0);
+        for (auto tix = 0u; tix < ntargets; ++tix)
+        {
+            auto const value = chunk_of(hashes_p[tix], chunk_offsets[cix], chunk_nbits);
+            ++starts[bucket_of(value, chunk_nbits, bucket_nbits) + 1];
+        }
+        for (auto bix = 0u; bix < NBUCKETS; ++bix)
+        {
+            starts[bix + 1] += starts[bix];
+        }
+
+        entries.resize(ntargets);
+        std::vector<std::uint32_t> fill(starts.cbegin(), starts.cend() - 1);
+        for (auto tix = 0u; tix < ntargets; ++tix)
+        {
+            auto const value = chunk_of(hashes_p[tix], chunk_offsets[cix], chunk_nbits);
+            entries[fill[bucket_of(value, chunk_nbits, bucket_nbits)]++] = {value, tix};
+        }
+    }
+
+    return true;
+}
+
+
+void target_index_lookup(
+    target_index_t const & index,
+    hash_4_simd_t const & h160,
+    std::vector<std::uint32_t> & tixs)
+{
+    tixs.clear();
+
+    for (auto cix = 0u; cix < index.chunk_offsets.size(); ++cix)
+    {
+        auto const value = chunk_of(h160, index.chunk_offsets[cix], index.chunk_nbits);
+        auto const bix = bucket_of(value, index.chunk_nbits, index.bucket_nbits);
+
+        auto const & starts = index.bucket_starts[cix];
+        auto const & entries = index.entries[cix];
+
+        for (auto eix = starts[bix]; eix < starts[bix + 1]; ++eix)
+        {
+            if (entries[eix].value == value)
+            {
+                tixs.push_back(entries[eix].tix);
+            }
+        }
+    }
+
+    if (tixs.size() > 1)
+    {
+        std::sort(tixs.begin(), tixs.end());
+        tixs.erase(std::unique(tixs.begin(), tixs.end()), tixs.end());
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef TARGET_INDEX_HPP
+#define TARGET_INDEX_HPP
+
+#include "ripemd160_mb.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+typedef struct
+{
+    std::uint32_t value;
+    std::uint32_t tix;
+} target_index_entry_t;
+
+
+// Pigeonhole index of target hash160s for windowed bit matching.
+//
+// The 160 bits are split into aligned chunks of chunk_nbits = (n + 1) / 2
+// bits, n being the minimum run length to match. Any run of n matching bits
+// covers at least one whole chunk, so a target can only match a candidate if
+// they agree on one of the chunks. Each chunk position has its own hash table
+// mapping chunk values to the targets carrying them.
+typedef struct
+{
+    unsigned int chunk_nbits;
+    unsigned int bucket_nbits;
+    std::vector<unsigned int> chunk_offsets;
+
+    // per chunk position, entries of bucket b are entries[bucket_starts[b] .. bucket_starts[b + 1])
+    std::vector<std::vector<std::uint32_t>> bucket_starts;
+    std::vector<std::vector<target_index_entry_t>> entries;
+} target_index_t;
+
+
+// Build the index, returns false when min_match_nbits is too short for the
+// index to filter out most targets and a linear scan is the better choice.
+bool target_index_build(
+    target_index_t & index,
+    hash_4_simd_t const * hashes_p, std::size_t ntargets,
+    unsigned int min_match_nbits);
+
+// Indices of the targets sharing at least one chunk with h160, in ascending
+// order and without duplicates. These are the only targets that can contain
+// a matching run, they still have to be verified bit by bit.
+void target_index_lookup(
+    target_index_t const & index,
+    hash_4_simd_t const & h160,
+    std::vector<std::uint32_t> & tixs);
+
+
+#endif /* TARGET_INDEX_HPP */
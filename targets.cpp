@@ -0,0 +1,601 @@
+#include "targets.hpp"
+#include "fd_io.hpp"
+#include "unaddr.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cctype>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <thread>
+
+#ifndef NO_LZMA
+#include <lzma.h>
+#endif
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+static constexpr char TARGETS_CACHE_MAGIC[8] = {'A', 'D', 'D', 'R', 'T', 'G', 'T', 'S'};
+static constexpr std::uint32_t TARGETS_CACHE_VERSION = 1;
+
+static constexpr std::uint8_t XZ_MAGIC[6] = {0xFD, '7', 'z', 'X', 'Z', 0x00};
+
+#ifndef NO_LZMA
+// decompressed text grows by at least this much at a time
+static constexpr std::size_t XZ_CHUNK = std::size_t{1} << 24;
+#endif
+
+
+// A parsed line, sortable on its own: the hash160 as big-endian words, so
+// that integer comparisons give memcmp order, and the line's rank in the
+// file, which also indexes the addresses as read.
+typedef struct
+{
+    std::uint64_t key[2];
+    std::uint32_t key_lo;
+    std::uint32_t rank;
+} parsed_target_t;
+
+static_assert(sizeof (parsed_target_t) == 24u);
+
+
+static inline
+bool operator<(parsed_target_t const & a, parsed_target_t const & b)
+{
+    if (a.key[0] != b.key[0])
+    {
+        return a.key[0] < b.key[0];
+    }
+    if (a.key[1] != b.key[1])
+    {
+        return a.key[1] < b.key[1];
+    }
+    if (a.key_lo != b.key_lo)
+    {
+        return a.key_lo < b.key_lo;
+    }
+    return a.rank < b.rank;
+}
+
+
+static inline
+void to_key(hash160_t const & h160, parsed_target_t & target)
+{
+    std::memcpy(target.key, h160.data(), 16);
+    std::memcpy(&target.key_lo, h160.data() + 16, 4);
+    target.key[0] = __builtin_bswap64(target.key[0]);
+    target.key[1] = __builtin_bswap64(target.key[1]);
+    target.key_lo = __builtin_bswap32(target.key_lo);
+}
+
+
+static inline
+void from_key(parsed_target_t const & target, hash160_t & h160)
+{
+    std::uint64_t const key[2] = {__builtin_bswap64(target.key[0]), __builtin_bswap64(target.key[1])};
+    std::uint32_t const key_lo = __builtin_bswap32(target.key_lo);
+    std::memcpy(h160.data(), key, 16);
+    std::memcpy(h160.data() + 16, &key_lo, 4);
+}
+
+
+// One thread's share of the lines, [begin_p, end_p) starting and ending at line boundaries.
+typedef struct
+{
+    char const * begin_p;
+    char const * end_p;
+    std::vector<parsed_target_t> parsed;
+    std::vector<std::uint64_t> offsets;    // into pool, one past the last too
+    std::string pool;
+    std::size_t nmismatches;
+} parse_chunk_t;
+
+
+static inline
+bool is_space(char c)
+{
+    return std::isspace((unsigned char)c);
+}
+
+
+static
+void parse_chunk(parse_chunk_t & chunk)
+{
+    // addresses run about 34 characters a line
+    auto const nlines_guess = (chunk.end_p - chunk.begin_p) / 32 + 1;
+    chunk.parsed.reserve(nlines_guess);
+    chunk.offsets.reserve(nlines_guess + 1);
+    chunk.pool.reserve(chunk.end_p - chunk.begin_p);
+
+    for (auto const * line_p = chunk.begin_p; line_p < chunk.end_p; /* nop */)
+    {
+        auto const * eol_p = static_cast<char const *>(std::memchr(line_p, '\n', chunk.end_p - line_p));
+        eol_p = (eol_p == nullptr) ? chunk.end_p : eol_p;
+
+        auto const * b_p = line_p;
+        auto const * e_p = eol_p;
+        line_p = eol_p + 1;
+
+        while ((b_p < e_p) and is_space(*b_p))
+        {
+            ++b_p;
+        }
+        while ((b_p < e_p) and is_space(e_p[-1]))
+        {
+            --e_p;
+        }
+        if (b_p == e_p)
+        {
+            continue;
+        }
+
+        // whitespace inside the address is dropped too, rarely any
+        auto const pool_size = chunk.pool.size();
+        if (std::none_of(b_p, e_p, is_space))
+        {
+            chunk.pool.append(b_p, e_p - b_p);
+        }
+        else
+        {
+            std::copy_if(b_p, e_p, std::back_inserter(chunk.pool), [](char c){ return not is_space(c); });
+        }
+        auto const address = std::string_view(chunk.pool).substr(pool_size);
+
+        hash160_t h160;
+        parsed_target_t target;
+        if (not unaddr(address, h160))
+        {
+            fprintf(stderr, "[!] Address checksum mismatch: %.*s\n", (int)address.size(), address.data());
+            ++chunk.nmismatches;
+        }
+        to_key(h160, target);
+        target.rank = chunk.parsed.size();
+
+        chunk.parsed.push_back(target);
+        chunk.offsets.push_back(chunk.pool.size());
+    }
+}
+
+
+// Parse the text on all CPUs, then sort: every thread sorts its own lines,
+// and sorted runs are merged pairwise, the pairs of a round in parallel.
+static
+void parse_text(targets_t & targets, char const * text_p, std::size_t size)
+{
+    auto const nthreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<parse_chunk_t> chunks(nthreads);
+    auto const * p = text_p;
+    for (auto cix = 0u; cix < nthreads; ++cix)
+    {
+        auto & chunk = chunks[cix];
+        chunk.begin_p = p;
+        chunk.offsets.push_back(0);
+        chunk.nmismatches = 0;
+
+        p = (cix + 1 == nthreads) ? text_p + size : std::max(p, text_p + size / nthreads * (cix + 1));
+        auto const * eol_p = static_cast<char const *>(std::memchr(p, '\n', text_p + size - p));
+        p = (eol_p == nullptr) ? text_p + size : eol_p + 1;
+        chunk.end_p = p;
+    }
+
+    {
+        std::vector<std::thread> threads;
+        for (auto & chunk : chunks)
+        {
+            threads.emplace_back([&chunk]()
+            {
+                parse_chunk(chunk);
+                std::sort(chunk.parsed.begin(), chunk.parsed.end());
+            });
+        }
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    // one sequence of sorted runs, ranks made global
+    std::vector<parsed_target_t> parsed;
+    std::vector<std::size_t> run_ends;
+    std::vector<std::size_t> chunk_ranks;       // rank of each chunk's first line
+    for (auto const & chunk : chunks)
+    {
+        chunk_ranks.push_back(parsed.size());
+        for (auto target : chunk.parsed)
+        {
+            target.rank += chunk_ranks.back();
+            parsed.push_back(target);
+        }
+        run_ends.push_back(parsed.size());
+    }
+
+    while (run_ends.size() > 1)
+    {
+        std::vector<std::size_t> merged_ends;
+        std::vector<std::thread> threads;
+
+        for (auto rix = 0u; rix < run_ends.size(); rix += 2)
+        {
+            if (rix + 1 == run_ends.size())
+            {
+                merged_ends.push_back(run_ends[rix]);
+                break;
+            }
+
+            auto const begin = (rix == 0) ? 0 : run_ends[rix - 1];
+            auto const mid = run_ends[rix];
+            auto const end = run_ends[rix + 1];
+            threads.emplace_back([&parsed, begin, mid, end]()
+            {
+                std::inplace_merge(parsed.begin() + begin, parsed.begin() + mid, parsed.begin() + end);
+            });
+            merged_ends.push_back(end);
+        }
+        for (auto & thread : threads)
+        {
+            thread.join();
+        }
+
+        run_ends.swap(merged_ends);
+    }
+
+    // then the lists in the sorted order, addresses found through their rank's chunk
+    targets.hashes.resize(parsed.size());
+    targets.offsets.resize(parsed.size() + 1);
+    targets.offsets[0] = 0;
+    targets.pool.clear();
+    targets.pool.reserve(std::accumulate(chunks.cbegin(), chunks.cend(), std::size_t{0},
+        [](std::size_t n, parse_chunk_t const & chunk){ return n + chunk.pool.size(); }));
+
+    std::size_t nmismatches = 0;
+    for (auto const & chunk : chunks)
+    {
+        nmismatches += chunk.nmismatches;
+    }
+
+    for (std::size_t tix = 0; tix < parsed.size(); ++tix)
+    {
+        auto const rank = parsed[tix].rank;
+        auto const cix = std::upper_bound(chunk_ranks.cbegin(), chunk_ranks.cend(), rank) - chunk_ranks.cbegin() - 1;
+        auto const & chunk = chunks[cix];
+        auto const local = rank - chunk_ranks[cix];
+
+        targets.hashes[tix] = hash_4_simd_t{};
+        from_key(parsed[tix], targets.hashes[tix].h160);
+        targets.pool.append(chunk.pool, chunk.offsets[local], chunk.offsets[local + 1] - chunk.offsets[local]);
+        targets.offsets[tix + 1] = targets.pool.size();
+    }
+
+    if (nmismatches != 0)
+    {
+        fprintf(stderr, "[w] %zu of %zu addresses have a checksum mismatch\n", nmismatches, parsed.size());
+    }
+}
+
+
+#ifndef NO_LZMA
+// all of an xz stream, or several concatenated
+static
+bool xz_decode(std::uint8_t const * in_p, std::size_t in_size, std::string & out)
+{
+    lzma_stream strm = LZMA_STREAM_INIT;
+
+    if (lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+    {
+        return false;
+    }
+
+    strm.next_in = in_p;
+    strm.avail_in = in_size;
+
+    lzma_ret rv = LZMA_OK;
+    std::size_t nout = 0;
+    while (rv == LZMA_OK)
+    {
+        if (nout == out.size())
+        {
+            out.resize(std::max(2 * out.size(), out.size() + XZ_CHUNK));
+        }
+
+        strm.next_out = reinterpret_cast<std::uint8_t *>(out.data()) + nout;
+        strm.avail_out = out.size() - nout;
+
+        rv = lzma_code(&strm, LZMA_FINISH);
+        nout = out.size() - strm.avail_out;
+    }
+
+    lzma_end(&strm);
+    out.resize(nout);
+
+    return rv == LZMA_STREAM_END;
+}
+#endif
+
+
+static
+void point_into_storage(targets_t & targets)
+{
+    targets.ntargets = targets.hashes.size();
+    targets.hashes_p = targets.hashes.data();
+    targets.offsets_p = targets.offsets.data();
+    targets.pool_p = targets.pool.data();
+}
+
+
+static
+bool map_cache(targets_t & targets, int fd, std::size_t size)
+{
+    targets_cache_header_t header;
+
+    if ((size < sizeof (header)) or (pread(fd, &header, sizeof (header), 0) != sizeof (header))
+        or (std::memcmp(header.magic, TARGETS_CACHE_MAGIC, sizeof (header.magic)) != 0)
+        or (header.version != TARGETS_CACHE_VERSION)
+        or (size != sizeof (header) + header.ntargets * sizeof (hash_4_simd_t)
+            + (header.ntargets + 1) * sizeof (std::uint64_t) + header.pool_size))
+    {
+        return false;
+    }
+
+    auto * map_p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map_p == MAP_FAILED)
+    {
+        return false;
+    }
+
+    auto const * p = static_cast<std::uint8_t const *>(map_p) + sizeof (header);
+    targets.ntargets = header.ntargets;
+    targets.hashes_p = reinterpret_cast<hash_4_simd_t const *>(p);
+    p += header.ntargets * sizeof (hash_4_simd_t);
+    targets.offsets_p = reinterpret_cast<std::uint64_t const *>(p);
+    p += (header.ntargets + 1) * sizeof (std::uint64_t);
+    targets.pool_p = reinterpret_cast<char const *>(p);
+    targets.map_p = map_p;
+    targets.map_size = size;
+
+    if ((targets.offsets_p[0] != 0) or (targets.offsets_p[header.ntargets] != header.pool_size))
+    {
+        targets_release(targets);
+        return false;
+    }
+
+    return true;
+}
+
+
+// whether the file is a cache, from its magic
+static
+bool is_cache(int fd)
+{
+    char magic[sizeof (TARGETS_CACHE_MAGIC)];
+
+    return (pread(fd, magic, sizeof (magic), 0) == sizeof (magic))
+        and (std::memcmp(magic, TARGETS_CACHE_MAGIC, sizeof (magic)) == 0);
+}
+
+
+// written next to fname and renamed over it, as generator tables are
+static
+bool write_cache(targets_t const & targets, std::string const & fname, struct stat const & source_st)
+{
+    targets_cache_header_t header{};
+    std::memcpy(header.magic, TARGETS_CACHE_MAGIC, sizeof (header.magic));
+    header.version = TARGETS_CACHE_VERSION;
+    header.ntargets = targets.ntargets;
+    header.pool_size = targets.offsets_p[targets.ntargets];
+    header.source_size = source_st.st_size;
+    header.source_mtime_ns = source_st.st_mtim.tv_sec * 1000000000LL + source_st.st_mtim.tv_nsec;
+
+    auto const tmp_fname = fname + ".tmp." + std::to_string(getpid());
+    auto const fd = open(tmp_fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    bool ok = fd_write_all(fd, &header, sizeof (header))
+        and fd_write_all(fd, targets.hashes_p, targets.ntargets * sizeof (hash_4_simd_t))
+        and fd_write_all(fd, targets.offsets_p, (targets.ntargets + 1) * sizeof (std::uint64_t))
+        and fd_write_all(fd, targets.pool_p, header.pool_size);
+    ok = (close(fd) == 0) and ok;
+    ok = ok and (rename(tmp_fname.c_str(), fname.c_str()) == 0);
+
+    if (not ok)
+    {
+        unlink(tmp_fname.c_str());
+    }
+
+    return ok;
+}
+
+
+// the cache, if it was made from the source as it is now
+static
+bool load_cache(targets_t & targets, std::string const & fname, struct stat const & source_st)
+{
+    auto const fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    targets_cache_header_t header;
+    struct stat st;
+    bool const ok = (fstat(fd, &st) == 0)
+        and (pread(fd, &header, sizeof (header), 0) == sizeof (header))
+        and (header.source_size == (std::uint64_t)source_st.st_size)
+        and (header.source_mtime_ns == source_st.st_mtim.tv_sec * 1000000000LL + source_st.st_mtim.tv_nsec)
+        and map_cache(targets, fd, st.st_size);
+    close(fd);
+
+    return ok;
+}
+
+
+bool targets_load(targets_t & targets, std::string const & fname, std::optional<std::string> const & maybe_cache_fname)
+{
+    auto const fd = open(fname.c_str(), O_RDONLY);
+    struct stat st;
+
+    if ((fd < 0) or (fstat(fd, &st) != 0))
+    {
+        fprintf(stderr, "[!] Failed to open targets %s: %s\n", fname.c_str(), strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    auto const size = (std::size_t)st.st_size;
+
+    if (is_cache(fd))
+    {
+        bool const ok = map_cache(targets, fd, size);
+        close(fd);
+        if (not ok)
+        {
+            fprintf(stderr, "[!] %s is not a target cache of this version\n", fname.c_str());
+        }
+        return ok;
+    }
+
+    if (maybe_cache_fname and load_cache(targets, *maybe_cache_fname, st))
+    {
+        close(fd);
+        return true;
+    }
+
+    void * map_p = nullptr;
+    if (size != 0)
+    {
+        map_p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_p == MAP_FAILED)
+        {
+            fprintf(stderr, "[!] Failed to map targets %s: %s\n", fname.c_str(), strerror(errno));
+            close(fd);
+            return false;
+        }
+        madvise(map_p, size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    auto const * bytes_p = static_cast<std::uint8_t const *>(map_p);
+    bool ok = true;
+
+    if ((size >= sizeof (XZ_MAGIC)) and (std::memcmp(bytes_p, XZ_MAGIC, sizeof (XZ_MAGIC)) == 0))
+    {
+#ifdef NO_LZMA
+        fprintf(stderr, "[!] Targets %s are xz-compressed, but this build has no xz support (NO_LZMA)\n", fname.c_str());
+        ok = false;
+#else
+        std::string text;
+        ok = xz_decode(bytes_p, size, text);
+        if (ok)
+        {
+            parse_text(targets, text.data(), text.size());
+        }
+        else
+        {
+            fprintf(stderr, "[!] Failed to decompress targets %s\n", fname.c_str());
+        }
+#endif
+    }
+    else
+    {
+        parse_text(targets, (size != 0) ? reinterpret_cast<char const *>(bytes_p) : "", size);
+    }
+
+    if (map_p != nullptr)
+    {
+        munmap(map_p, size);
+    }
+    if (not ok)
+    {
+        return false;
+    }
+
+    point_into_storage(targets);
+
+    if (maybe_cache_fname and not write_cache(targets, *maybe_cache_fname, st))
+    {
+        fprintf(stderr, "[w] Failed to write target cache %s\n", maybe_cache_fname->c_str());
+    }
+
+    return true;
+}
+
+
+void targets_add(targets_t & targets, std::string const & address)
+{
+    // a mapped list is copied first
+    if (targets.map_p != nullptr)
+    {
+        targets.hashes.assign(targets.hashes_p, targets.hashes_p + targets.ntargets);
+        targets.offsets.assign(targets.offsets_p, targets.offsets_p + targets.ntargets + 1);
+        targets.pool.assign(targets.pool_p, targets.offsets_p[targets.ntargets]);
+        munmap(targets.map_p, targets.map_size);
+        targets.map_p = nullptr;
+    }
+    if (targets.offsets.empty())
+    {
+        targets.offsets.push_back(0);
+    }
+
+    hash_4_simd_t h{};
+    h.h160 = unaddr(address);
+
+    std::size_t const tix = std::lower_bound(targets.hashes.cbegin(), targets.hashes.cend(), h,
+        [](hash_4_simd_t const & a, hash_4_simd_t const & b)
+        {
+            return std::memcmp(a.h160.data(), b.h160.data(), a.h160.size()) < 0;
+        }) - targets.hashes.cbegin();
+
+    targets.hashes.insert(targets.hashes.begin() + tix, h);
+    targets.pool.insert(targets.offsets[tix], address);
+    targets.offsets.insert(targets.offsets.begin() + tix + 1, targets.offsets[tix] + address.size());
+    for (auto ix = tix + 2; ix < targets.offsets.size(); ++ix)
+    {
+        targets.offsets[ix] += address.size();
+    }
+
+    point_into_storage(targets);
+}
+
+
+void targets_release_hashes(targets_t & targets)
+{
+    if (targets.map_p != nullptr)
+    {
+        // the whole pages of a mapped cache, they are only read back from the file if touched again
+        auto const page_size = (std::uintptr_t)sysconf(_SC_PAGESIZE);
+        auto const begin = ((std::uintptr_t)targets.hashes_p + page_size - 1) & ~(page_size - 1);
+        auto const end = (std::uintptr_t)(targets.hashes_p + targets.ntargets) & ~(page_size - 1);
+        if (begin < end)
+        {
+            madvise((void *)begin, end - begin, MADV_DONTNEED);
+        }
+    }
+
+    targets.hashes.clear();
+    targets.hashes.shrink_to_fit();
+    targets.hashes_p = nullptr;
+}
+
+
+void targets_release(targets_t & targets)
+{
+    if (targets.map_p != nullptr)
+    {
+        munmap(targets.map_p, targets.map_size);
+    }
+
+    targets = targets_t{};
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef TARGETS_HPP
+#define TARGETS_HPP
+
+#include "ripemd160_mb.hpp"
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// The addresses main searches for, and their hash160s.
+//
+// Targets are sorted by hash160, ties in file order, so that a target's
+// index, which binary hit records refer to, is the same whether the list
+// was parsed from text, from xz-compressed text or mapped from a cache.
+//
+// A cache file holds the parsed list ready to be mapped: a 64-byte header,
+// the hashes, the ntargets + 1 offsets of the addresses in the pool, then
+// the pool of addresses, without separators.
+typedef struct
+{
+    std::size_t ntargets;
+    hash_4_simd_t const * hashes_p;
+    std::uint64_t const * offsets_p;
+    char const * pool_p;
+
+    // storage of a parsed list; a mapped one points into its mapping
+    std::vector<hash_4_simd_t> hashes;
+    std::vector<std::uint64_t> offsets;
+    std::string pool;
+    void * map_p;
+    std::size_t map_size;
+} targets_t;
+
+typedef struct
+{
+    char magic[8];                  // "ADDRTGTS"
+    std::uint32_t version;
+    std::uint32_t reserved0;
+    std::uint64_t ntargets;
+    std::uint64_t pool_size;
+    std::uint64_t source_size;      // of the file the cache was made from
+    std::int64_t source_mtime_ns;
+    std::uint8_t reserved[16];
+} targets_cache_header_t;
+
+static_assert(sizeof (targets_cache_header_t) == 64);
+
+
+// Load the addresses in fname, one per line, whitespace ignored: plain or
+// xz-compressed text, memory-mapped and decoded on all CPUs, or a cache.
+// With a cache file name, the cache is mapped instead when it was made
+// from fname as it is now, else written after parsing. False, with the
+// reason on stderr, if fname cannot be read.
+bool targets_load(targets_t & targets, std::string const & fname, std::optional<std::string> const & maybe_cache_fname);
+
+// Add a single address, the first among those of the same hash160.
+void targets_add(targets_t & targets, std::string const & address);
+
+// Give back the memory of the hashes, for when they are indexed in a form
+// of their own; hashes_p is null from then on.
+void targets_release_hashes(targets_t & targets);
+
+void targets_release(targets_t & targets);
+
+static inline
+std::string_view targets_address(targets_t const & targets, std::size_t tix)
+{
+    return std::string_view(
+        targets.pool_p + targets.offsets_p[tix],
+        targets.offsets_p[tix + 1] - targets.offsets_p[tix]);
+}
+
+
+#endif /* TARGETS_HPP */
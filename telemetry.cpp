@@ -0,0 +1,143 @@
+#include "telemetry.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <cinttypes>
+#include <numeric>
+
+
+static char const * const STAGE_NAMES[NSTAGES] =
+{
+    "keygen",
+    "serialize",
+    "sha256",
+    "ripemd160",
+    "compare",
+};
+
+
+telemetry_snapshot_t telemetry_snapshot(std::vector<stage_counters_t const *> const & counters)
+{
+    telemetry_snapshot_t snap;
+
+    snap.t = std::chrono::steady_clock::now();
+    snap.cycles.fill(0);
+
+    for (auto const * c_p : counters)
+    {
+        snap.nkeys.push_back(c_p->nkeys.load(std::memory_order_relaxed));
+        for (auto six = 0u; six < NSTAGES; ++six)
+        {
+            snap.cycles[six] += c_p->cycles[six].load(std::memory_order_relaxed);
+        }
+    }
+
+    return snap;
+}
+
+
+std::uint64_t telemetry_nkeys(telemetry_snapshot_t const & snap)
+{
+    return std::accumulate(snap.nkeys.cbegin(), snap.nkeys.cend(), std::uint64_t{0});
+}
+
+
+static
+double seconds_between(telemetry_snapshot_t const & prev, telemetry_snapshot_t const & cur)
+{
+    std::chrono::duration<double> const dt = cur.t - prev.t;
+    return dt.count();
+}
+
+
+void telemetry_print(FILE * f_p, telemetry_snapshot_t const & prev, telemetry_snapshot_t const & cur)
+{
+    auto const dt = seconds_between(prev, cur);
+    auto const nkeys = telemetry_nkeys(cur) - telemetry_nkeys(prev);
+
+    if (cur.nkeys.size() > 1)
+    {
+        fprintf(f_p, "[i] keys/s per thread:");
+        for (auto wix = 0u; wix < cur.nkeys.size(); ++wix)
+        {
+            fprintf(f_p, " %.0lf", (cur.nkeys[wix] - prev.nkeys[wix]) / dt);
+        }
+        fprintf(f_p, "\n");
+    }
+
+    if (nkeys != 0)
+    {
+        fprintf(f_p, "[i] cycles/key:");
+        for (auto six = 0u; six < NSTAGES; ++six)
+        {
+            auto const cycles = cur.cycles[six] - prev.cycles[six];
+            if (cycles != 0)
+            {
+                fprintf(f_p, " %s %.0lf", STAGE_NAMES[six], (double)cycles / nkeys);
+            }
+        }
+        fprintf(f_p, "\n");
+    }
+}
+
+
+static
+void write_rates_json(FILE * f_p, telemetry_snapshot_t const & prev, telemetry_snapshot_t const & cur)
+{
+    auto const dt = seconds_between(prev, cur);
+    auto const nkeys = telemetry_nkeys(cur) - telemetry_nkeys(prev);
+
+    fprintf(f_p, "{\"seconds\": %.3lf, \"keys\": %" PRIu64 ", \"keys_per_s\": %.1lf, \"threads_keys_per_s\": [",
+        dt, nkeys, dt > 0 ? nkeys / dt : 0.);
+    for (auto wix = 0u; wix < cur.nkeys.size(); ++wix)
+    {
+        fprintf(f_p, "%s%.1lf", wix ? ", " : "", dt > 0 ? (cur.nkeys[wix] - prev.nkeys[wix]) / dt : 0.);
+    }
+    fprintf(f_p, "], \"cycles_per_key\": {");
+    for (auto six = 0u; six < NSTAGES; ++six)
+    {
+        fprintf(f_p, "%s\"%s\": %.1lf", six ? ", " : "", STAGE_NAMES[six],
+            nkeys ? (double)(cur.cycles[six] - prev.cycles[six]) / nkeys : 0.);
+    }
+    fprintf(f_p, "}}");
+}
+
+
+bool telemetry_write_json(
+    std::string const & fname,
+    telemetry_snapshot_t const & start,
+    telemetry_snapshot_t const & prev,
+    telemetry_snapshot_t const & cur,
+    std::vector<std::pair<std::string_view, std::uint64_t>> const & target_nhits)
+{
+    auto const tmp_fname = fname + ".tmp";
+    auto * f_p = fopen(tmp_fname.c_str(), "w");
+
+    if (f_p == nullptr)
+    {
+        return false;
+    }
+
+    std::uint64_t nhits = 0;
+    for (auto const & th : target_nhits)
+    {
+        nhits += th.second;
+    }
+
+    fprintf(f_p, "{\n\"kernels\": \"%s\",\n\"total\": ", cpu_kernels_name(cpu_kernels()));
+    write_rates_json(f_p, start, cur);
+    fprintf(f_p, ",\n\"last\": ");
+    write_rates_json(f_p, prev, cur);
+    fprintf(f_p, ",\n\"hits\": %" PRIu64 ",\n\"hits_per_target\": {", nhits);
+    for (auto ix = 0u; ix < target_nhits.size(); ++ix)
+    {
+        // targets are addresses or hex pubkeys, nothing to escape
+        auto const & target = target_nhits[ix].first;
+        fprintf(f_p, "%s\n  \"%.*s\": %" PRIu64, ix ? "," : "", (int)target.size(), target.data(), target_nhits[ix].second);
+    }
+    fprintf(f_p, "%s}\n}\n", target_nhits.empty() ? "" : "\n");
+
+    bool const ok = (fflush(f_p) == 0) and not ferror(f_p);
+    fclose(f_p);
+
+    return ok and (rename(tmp_fname.c_str(), fname.c_str()) == 0);
+}
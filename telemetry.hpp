@@ -0,0 +1,88 @@
+#pragma once
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+
+#include <x86intrin.h>
+
+
+// Stages of the candidate pipeline, timed per block with the TSC.
+enum stage_t : unsigned int
+{
+    STAGE_KEYGEN,       // point arithmetic and normalization to affine
+    STAGE_SERIALIZE,    // points to uncompressed octet strings
+    STAGE_SHA256,
+    STAGE_RIPEMD160,
+    STAGE_COMPARE,      // matching against the targets, hits included
+    NSTAGES
+};
+
+
+// Progress of a worker, written by that worker only, read by the reporting
+// thread. A handful of relaxed stores per block keeps this cheap enough to
+// be always on.
+typedef struct alignas(64)
+{
+    std::atomic<std::uint64_t> nkeys;
+    std::atomic<std::uint64_t> cycles[NSTAGES];
+} stage_counters_t;
+
+
+static inline
+std::uint64_t tsc_now()
+{
+    return __rdtsc();
+}
+
+
+static inline
+void stage_counters_add(stage_counters_t & counters, std::uint64_t nkeys, std::uint64_t const (&cycles)[NSTAGES])
+{
+    // single writer, no need for atomic read-modify-write
+    counters.nkeys.store(counters.nkeys.load(std::memory_order_relaxed) + nkeys, std::memory_order_relaxed);
+    for (auto six = 0u; six < NSTAGES; ++six)
+    {
+        counters.cycles[six].store(counters.cycles[six].load(std::memory_order_relaxed) + cycles[six], std::memory_order_relaxed);
+    }
+}
+
+
+// Totals of a set of workers at one point in time.
+typedef struct
+{
+    std::chrono::steady_clock::time_point t;
+    std::vector<std::uint64_t> nkeys;   // per worker
+    std::array<std::uint64_t, NSTAGES> cycles;
+} telemetry_snapshot_t;
+
+telemetry_snapshot_t telemetry_snapshot(std::vector<stage_counters_t const *> const & counters);
+
+std::uint64_t telemetry_nkeys(telemetry_snapshot_t const & snap);
+
+
+// "[i]" lines with keys/s per worker and cycles per key of every stage
+// that ran, both between the two snapshots.
+void telemetry_print(FILE * f_p, telemetry_snapshot_t const & prev, telemetry_snapshot_t const & cur);
+
+// The same, plus totals since start and the hit count of every target hit
+// at least once and the kernels in use, as a JSON object. Replaces fname
+// through a rename.
+bool telemetry_write_json(
+    std::string const & fname,
+    telemetry_snapshot_t const & start,
+    telemetry_snapshot_t const & prev,
+    telemetry_snapshot_t const & cur,
+    std::vector<std::pair<std::string_view, std::uint64_t>> const & target_nhits);
+
+
+#endif /* TELEMETRY_HPP */
@@ -0,0 +1,1178 @@
+#include "keygen.hpp"
+#include "gen_table.hpp"
+#include "secp256k1.hpp"
+#include "sha256_mb.hpp"
+#include "ripemd160_mb.hpp"
+#include "target_index.hpp"
+#include "exact_index.hpp"
+#include "pubkey_match.hpp"
+#include "near_index.hpp"
+#include "window_scan.hpp"
+#include "longest_run.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+#include <functional>
+#include <map>
+
+#include <unistd.h>
+
+#include <openssl/ec.h>
+#include <openssl/bn.h>
+#include <openssl/objects.h>
+#include <openssl/sha.h>
+#include <openssl/ripemd.h>
+
+
+// Differential checks of the fast paths against OpenSSL and against the
+// plain code they replace. Every check runs on fixed pseudo-random inputs
+// plus the edge cases of its kernel; a mismatch is reported on stderr and
+// fails the run.
+
+
+// checks run and failed in the current group
+static unsigned int g_nchecks;
+static unsigned int g_nfailed;
+static unsigned int g_nfailed_total;
+
+
+static
+void expect(bool ok, char const * fmt, ...)
+{
+    ++g_nchecks;
+    if (ok)
+    {
+        return;
+    }
+
+    // the first few failures of a group are enough to go on
+    if (++g_nfailed <= 8)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        fprintf(stderr, "[!] ");
+        vfprintf(stderr, fmt, ap);
+        fprintf(stderr, "\n");
+        va_end(ap);
+    }
+}
+
+
+static
+void group_begin()
+{
+    g_nchecks = 0;
+    g_nfailed = 0;
+}
+
+
+static
+void group_end(char const * name)
+{
+    fprintf(stderr, "[%c] %s: %u checks, %u failed\n", g_nfailed ? '!' : 'i', name, g_nchecks, g_nfailed);
+    g_nfailed_total += g_nfailed;
+}
+
+
+// Run fn at every kernel level the CPU supports, with the name of the level.
+static
+void for_each_kernels(std::function<void(cpu_kernels_t, char const *)> const & fn)
+{
+    auto const supported = cpu_kernels_supported();
+
+    for (auto level = (unsigned int)CPU_KERNELS_SCALAR; level <= supported; ++level)
+    {
+        auto const kernels = (cpu_kernels_t)level;
+        cpu_kernels_select(kernels);
+        fn(kernels, cpu_kernels_name(kernels));
+    }
+
+    cpu_kernels_select(supported);
+}
+
+
+// 04 x y, all zero for the point at infinity
+using point_bytes_t = std::array<std::uint8_t, 65>;
+using scalar_t = std::array<std::uint8_t, 32>;
+
+
+static
+std::string hex(std::uint8_t const * p, std::size_t n)
+{
+    static char const digits[] = "0123456789abcdef";
+
+    std::string rv;
+    for (auto ix = 0u; ix < n; ++ix)
+    {
+        rv += digits[p[ix] >> 4];
+        rv += digits[p[ix] & 0xF];
+    }
+
+    return rv;
+}
+
+
+// The reference: k G with OpenSSL, k taken mod n.
+typedef struct
+{
+    EC_GROUP * group_p;
+    BN_CTX * ctx_p;
+    BIGNUM * order_p;
+    EC_POINT * point_p;
+} ossl_ec_t;
+
+
+static
+point_bytes_t ossl_mul_gen(ossl_ec_t & ec, BIGNUM const * k_p)
+{
+    point_bytes_t rv{};
+
+    auto * m_p = BN_new();
+    BN_nnmod(m_p, k_p, ec.order_p, ec.ctx_p);
+    EC_POINT_mul(ec.group_p, ec.point_p, m_p, nullptr, nullptr, ec.ctx_p);
+    BN_free(m_p);
+
+    if (not EC_POINT_is_at_infinity(ec.group_p, ec.point_p))
+    {
+        EC_POINT_point2oct(ec.group_p, ec.point_p, POINT_CONVERSION_UNCOMPRESSED, rv.data(), rv.size(), ec.ctx_p);
+    }
+
+    return rv;
+}
+
+
+static
+point_bytes_t ossl_mul_gen(ossl_ec_t & ec, scalar_t const & k)
+{
+    auto * k_p = BN_bin2bn(k.data(), k.size(), nullptr);
+    auto const rv = ossl_mul_gen(ec, k_p);
+    BN_free(k_p);
+
+    return rv;
+}
+
+
+static
+point_bytes_t to_bytes(ge_t const & a)
+{
+    point_bytes_t rv{};
+
+    if (not a.infinity)
+    {
+        ge_to_uncompressed(a, rv.data());
+    }
+
+    return rv;
+}
+
+
+static
+point_bytes_t to_bytes(gej_t const & a)
+{
+    ge_t r;
+    ge_set_gej(r, a);
+
+    return to_bytes(r);
+}
+
+
+static
+scalar_t scalar_from_bn(BIGNUM const * k_p)
+{
+    scalar_t rv{};
+    BN_bn2bin(k_p, rv.data() + rv.size() - BN_num_bytes(k_p));
+
+    return rv;
+}
+
+
+// n + d for small d, negative for n - |d|
+static
+scalar_t order_plus(ossl_ec_t & ec, long d)
+{
+    auto * k_p = BN_dup(ec.order_p);
+    if (d >= 0)
+    {
+        BN_add_word(k_p, d);
+    }
+    else
+    {
+        BN_sub_word(k_p, -d);
+    }
+    auto const rv = scalar_from_bn(k_p);
+    BN_free(k_p);
+
+    return rv;
+}
+
+
+// The scalars every multiplication is checked on: the edges of the group
+// order, single windows at their extremes for every window width, and
+// random ones.
+static
+std::vector<scalar_t> test_scalars(ossl_ec_t & ec, std::mt19937_64 & rng)
+{
+    std::vector<scalar_t> rv;
+
+    scalar_t k{};
+    rv.push_back(k);
+    k[31] = 1;
+    rv.push_back(k);
+    k[31] = 2;
+    rv.push_back(k);
+    for (auto const d : {-1l, -2l, 0l, 1l, 5l})
+    {
+        rv.push_back(order_plus(ec, d));
+    }
+    rv.push_back(scalar_t{});
+    rv.back().fill(0xFF);
+
+    for (auto bix = 0u; bix < 32; ++bix)
+    {
+        for (auto const byte : {0x01, 0x80, 0xFF})
+        {
+            rv.push_back(scalar_t{});
+            rv.back()[bix] = byte;
+        }
+    }
+
+    for (auto ix = 0u; ix < 256; ++ix)
+    {
+        rv.push_back(scalar_t{});
+        for (auto & byte : rv.back())
+        {
+            byte = rng();
+        }
+    }
+
+    return rv;
+}
+
+
+static
+void check_mul_gen(ossl_ec_t & ec, std::vector<scalar_t> const & scalars, char const * table)
+{
+    group_begin();
+
+    for (auto const & k : scalars)
+    {
+        gej_t r;
+        std::uint8_t k_[32];
+        std::memcpy(k_, k.data(), sizeof (k_));
+        gej_mul_gen(r, k_);
+
+        auto const expected = ossl_mul_gen(ec, k);
+        auto const got = to_bytes(r);
+        expect(got == expected, "gej_mul_gen, %s table, k = %s: %s instead of %s",
+            table, hex(k.data(), k.size()).c_str(), hex(got.data(), got.size()).c_str(), hex(expected.data(), expected.size()).c_str());
+    }
+
+    std::string name = "gej_mul_gen, ";
+    group_end((name + table + " table").c_str());
+}
+
+
+// Points (m + ix) G walked with mixed additions of G from m = n - 3 across
+// the point at infinity, and from 0 through the doubling G + G, normalized
+// one by one and together, points at infinity included.
+static
+void check_walks(ossl_ec_t & ec)
+{
+    group_begin();
+
+    auto constexpr NSTEPS = 8u;
+
+    std::vector<gej_t> points;
+    std::vector<point_bytes_t> expected;
+    for (auto const start : {-3l, 0l})
+    {
+        auto const m = order_plus(ec, start);
+        std::uint8_t m_[32];
+        std::memcpy(m_, m.data(), sizeof (m_));
+
+        gej_t p;
+        gej_mul_gen(p, m_);
+
+        auto * k_p = BN_bin2bn(m.data(), m.size(), nullptr);
+        for (auto ix = 0u; ix < NSTEPS; ++ix)
+        {
+            points.push_back(p);
+            expected.push_back(ossl_mul_gen(ec, k_p));
+
+            gej_add_ge(p, p, SECP256K1_G);
+            BN_add_word(k_p, 1);
+        }
+        BN_free(k_p);
+    }
+
+    for (auto ix = 0u; ix < points.size(); ++ix)
+    {
+        auto const got = to_bytes(points[ix]);
+        expect(got == expected[ix], "walk point %u: %s instead of %s",
+            ix, hex(got.data(), got.size()).c_str(), hex(expected[ix].data(), expected[ix].size()).c_str());
+    }
+
+    // every run of the walks, so that infinity comes first, last, alone and in between
+    std::vector<ge_t> affine(points.size());
+    for (auto first = 0u; first < points.size(); ++first)
+    {
+        for (auto n = 1u; first + n <= points.size(); ++n)
+        {
+            ge_set_gej_batch(affine.data(), points.data() + first, n);
+            for (auto ix = 0u; ix < n; ++ix)
+            {
+                expect(to_bytes(affine[ix]) == expected[first + ix], "ge_set_gej_batch of walk points [%u, %u), point %u",
+                    first, first + n, first + ix);
+            }
+        }
+    }
+
+    group_end("walks across infinity, ge_set_gej_batch");
+}
+
+
+// Batch normalization of unrelated points, with points at infinity spread
+// among them.
+static
+void check_batch(ossl_ec_t & ec, std::vector<scalar_t> const & scalars)
+{
+    group_begin();
+
+    std::vector<gej_t> points(scalars.size());
+    for (auto ix = 0u; ix < scalars.size(); ++ix)
+    {
+        std::uint8_t k[32];
+        std::memcpy(k, scalars[ix].data(), sizeof (k));
+        gej_mul_gen(points[ix], k);
+
+        // and a Z other than the one of the table lookups
+        gej_double(points[ix], points[ix]);
+    }
+
+    std::vector<ge_t> affine(points.size());
+    ge_set_gej_batch(affine.data(), points.data(), points.size());
+
+    for (auto ix = 0u; ix < scalars.size(); ++ix)
+    {
+        auto * k_p = BN_bin2bn(scalars[ix].data(), scalars[ix].size(), nullptr);
+        BN_lshift1(k_p, k_p);
+        auto const expected = ossl_mul_gen(ec, k_p);
+        BN_free(k_p);
+
+        expect(to_bytes(affine[ix]) == expected, "ge_set_gej_batch, 2 k G for k = %s",
+            hex(scalars[ix].data(), scalars[ix].size()).c_str());
+    }
+
+    group_end("ge_set_gej_batch");
+}
+
+
+// Keys of the generator in random and walk modes, with and without a seed
+// and a stride, against OpenSSL from their private keys and against the
+// replay of seeded ones; then a stream resumed inside a block.
+static
+void check_keygen(ossl_ec_t & ec)
+{
+    group_begin();
+
+    auto constexpr BLOCK_SIZE = 16u;
+    auto constexpr NBLOCKS = 5u;
+    auto constexpr SEED = 0x5EEDu;
+
+    typedef struct
+    {
+        std::uint64_t walk_nsteps;
+        std::uint64_t walk_stride;
+        bool seeded;
+    } mode_t;
+
+    auto * replay_p = BN_new();
+    std::vector<uncompressed_key_t> keys(BLOCK_SIZE);
+
+    for (auto const & mode : {mode_t{0, 1, false}, mode_t{0, 1, true}, mode_t{40, 1, false}, mode_t{40, 1, true}, mode_t{40, 977, true}})
+    {
+        auto * kg_p = keygen_new(mode.walk_nsteps, BLOCK_SIZE,
+            mode.seeded ? std::optional<std::uint64_t>{SEED} : std::nullopt, 3, mode.walk_stride);
+
+        for (auto bix = 0u; bix < NBLOCKS; ++bix)
+        {
+            expect(keygen_next_block(*kg_p, keys.data()), "keygen_next_block");
+
+            for (auto ix = 0u; ix < BLOCK_SIZE; ++ix)
+            {
+                auto const * priv_p = keygen_private_key(*kg_p, ix);
+                auto const expected = ossl_mul_gen(ec, priv_p);
+                expect(std::equal(keys[ix].cbegin(), keys[ix].cend(), expected.cbegin()),
+                    "keygen, walk %lu, stride %lu, seeded %d: key %u of block %u is not its private key times G",
+                    mode.walk_nsteps, mode.walk_stride, mode.seeded, ix, bix);
+
+                if (mode.seeded)
+                {
+                    keygen_replay(SEED, 3, kg_p->walk_len, kg_p->counter + ix, replay_p, mode.walk_stride);
+                    expect(BN_cmp(replay_p, priv_p) == 0,
+                        "keygen_replay, walk %lu, stride %lu: counter %lu replays to another key",
+                        mode.walk_nsteps, mode.walk_stride, kg_p->counter + ix);
+                }
+            }
+        }
+
+        keygen_free(kg_p);
+    }
+
+    // resumed at every counter of a block, the keys from there on are the same
+    for (auto const walk_nsteps : {0u, 40u})
+    {
+        auto * kg_p = keygen_new(walk_nsteps, BLOCK_SIZE, SEED, 3);
+        std::vector<uncompressed_key_t> stream(BLOCK_SIZE * 3);
+        for (auto bix = 0u; bix < 3; ++bix)
+        {
+            keygen_next_block(*kg_p, stream.data() + BLOCK_SIZE * bix);
+        }
+        keygen_free(kg_p);
+
+        for (auto counter = BLOCK_SIZE; counter < 2 * BLOCK_SIZE; ++counter)
+        {
+            kg_p = keygen_new(walk_nsteps, BLOCK_SIZE, SEED, 3);
+            keygen_seek(*kg_p, counter);
+            keygen_next_block(*kg_p, keys.data());
+
+            expect((kg_p->counter + kg_p->first == counter)
+                and std::equal(keys.cbegin() + kg_p->first, keys.cend(), stream.cbegin() + counter),
+                "keygen_seek, walk %u: resumed at %u", walk_nsteps, counter);
+
+            keygen_next_block(*kg_p, keys.data());
+            expect((kg_p->first == 0) and std::equal(keys.cbegin(), keys.cend(), stream.cbegin() + 2 * BLOCK_SIZE),
+                "keygen_seek, walk %u: the block after the one resumed at %u", walk_nsteps, counter);
+
+            keygen_free(kg_p);
+        }
+    }
+
+    BN_free(replay_p);
+
+    group_end("keygen");
+}
+
+
+// Uncompressed keys: real ones, then random bytes, which hash all the same.
+static
+std::vector<uncompressed_key_t> test_keys(std::mt19937_64 & rng, std::size_t n)
+{
+    std::vector<uncompressed_key_t> rv(n);
+
+    auto * kg_p = keygen_new(0, n / 2);
+    keygen_next_block(*kg_p, rv.data());
+    keygen_free(kg_p);
+
+    for (auto ix = n / 2; ix < n; ++ix)
+    {
+        for (auto & byte : rv[ix])
+        {
+            byte = rng();
+        }
+    }
+
+    return rv;
+}
+
+
+// Both SHA-256 kernels against OpenSSL, through the entry points of every
+// level and the dispatcher, over all batch sizes up to a few vectors so
+// that every tail is taken.
+static
+void check_sha256(std::mt19937_64 & rng)
+{
+    group_begin();
+
+    auto constexpr NKEYS = 64u;
+    auto const keys = test_keys(rng, NKEYS);
+
+    // references, uncompressed then compressed
+    std::vector<hash256_t> expected65(NKEYS);
+    std::vector<hash256_t> expected33(NKEYS);
+    for (auto ix = 0u; ix < NKEYS; ++ix)
+    {
+        SHA256(keys[ix].data(), keys[ix].size(), expected65[ix].data());
+
+        std::uint8_t compressed[33];
+        compressed[0] = 0x02 | (keys[ix][64] & 1);
+        std::memcpy(compressed + 1, keys[ix].data() + 1, 32);
+        SHA256(compressed, sizeof (compressed), expected33[ix].data());
+    }
+
+    using sha256_fn_t = void (*)(uncompressed_key_t const *, hash256_t *);
+    using sha256_mb_fn_t = void (*)(uncompressed_key_t const *, hash256_t *, std::size_t);
+
+    typedef struct
+    {
+        char const * name;
+        std::vector<hash256_t> const & expected;
+        sha256_fn_t kernels[3];     // per level, taking 1, 8 and 16 keys
+        sha256_mb_fn_t mb;
+    } variant_t;
+
+    variant_t const variants[] = {
+        {"sha256_65", expected65, {sha256_65_x1, sha256_65_x8, sha256_65_x16}, sha256_65_mb},
+        {"sha256_33", expected33, {sha256_33_x1, sha256_33_x8, sha256_33_x16}, sha256_33_mb},
+    };
+
+    for_each_kernels([&](cpu_kernels_t kernels, char const * kernels_name)
+    {
+        static unsigned int const WIDTHS[] = {1, 8, 16};
+
+        std::vector<hash256_t> digests(NKEYS);
+
+        for (auto const & variant : variants)
+        {
+            auto const width = WIDTHS[kernels];
+            for (auto first = 0u; first + width <= NKEYS; first += width)
+            {
+                variant.kernels[kernels](keys.data() + first, digests.data() + first);
+            }
+            expect(digests == variant.expected, "%s_x%u differs from SHA256", variant.name, width);
+
+            for (auto n = 0u; n <= NKEYS; ++n)
+            {
+                digests.assign(NKEYS, hash256_t{});
+                variant.mb(keys.data(), digests.data(), n);
+
+                expect(std::equal(digests.cbegin(), digests.cbegin() + n, variant.expected.cbegin())
+                    and std::all_of(digests.cbegin() + n, digests.cend(), [](hash256_t const & d){ return d == hash256_t{}; }),
+                    "%s_mb of %u keys differs from SHA256 with the %s kernels", variant.name, n, kernels_name);
+            }
+        }
+    });
+
+    group_end("sha256_mb");
+}
+
+
+// RIPEMD-160 of 32-byte digests against OpenSSL, as SHA-256 is checked.
+static
+void check_ripemd160(std::mt19937_64 & rng)
+{
+    group_begin();
+
+    auto constexpr NDIGESTS = 64u;
+
+    std::vector<hash256_t> digests(NDIGESTS);
+    for (auto & digest : digests)
+    {
+        for (auto & byte : digest)
+        {
+            byte = rng();
+        }
+    }
+    digests[0].fill(0);
+    digests[1].fill(0xFF);
+
+    std::vector<hash_4_simd_t> expected(NDIGESTS);
+    for (auto ix = 0u; ix < NDIGESTS; ++ix)
+    {
+        expected[ix] = hash_4_simd_t{};
+        RIPEMD160(digests[ix].data(), digests[ix].size(), expected[ix].h160.data());
+    }
+
+    // whole 32 bytes, the zero extension included
+    auto const equal = [](hash_4_simd_t const & a, hash_4_simd_t const & b)
+    {
+        return a.h256 == b.h256;
+    };
+
+    for_each_kernels([&](cpu_kernels_t kernels, char const * kernels_name)
+    {
+        static unsigned int const WIDTHS[] = {1, 8, 16};
+        using ripemd160_fn_t = void (*)(hash256_t const *, hash_4_simd_t *);
+        static ripemd160_fn_t const KERNELS[] = {ripemd160_32_x1, ripemd160_32_x8, ripemd160_32_x16};
+
+        std::vector<hash_4_simd_t> hashes(NDIGESTS);
+
+        auto const width = WIDTHS[kernels];
+        for (auto first = 0u; first + width <= NDIGESTS; first += width)
+        {
+            KERNELS[kernels](digests.data() + first, hashes.data() + first);
+        }
+        expect(std::equal(hashes.cbegin(), hashes.cend(), expected.cbegin(), equal),
+            "ripemd160_32_x%u differs from RIPEMD160", width);
+
+        for (auto n = 0u; n <= NDIGESTS; ++n)
+        {
+            for (auto & h : hashes)
+            {
+                h.h256.fill(0xA5);
+            }
+            ripemd160_32_mb(digests.data(), hashes.data(), n);
+
+            expect(std::equal(hashes.cbegin(), hashes.cbegin() + n, expected.cbegin(), equal)
+                and std::all_of(hashes.cbegin() + n, hashes.cend(), [](hash_4_simd_t const & h)
+                    { return std::all_of(h.h256.cbegin(), h.h256.cend(), [](std::uint8_t byte){ return byte == 0xA5; }); }),
+                "ripemd160_32_mb of %u digests differs from RIPEMD160 with the %s kernels", n, kernels_name);
+        }
+    });
+
+    group_end("ripemd160_mb");
+}
+
+
+// Target hashes and queries for the hash160 indexes: random targets, a few
+// of them twice, and queries that share a run of every length with one of
+// them at a random offset, besides random ones and the targets themselves.
+typedef struct
+{
+    std::vector<hash_4_simd_t> targets;
+    std::vector<hash_4_simd_t> queries;
+
+    // bit i of masks[qix][tix] set when query and target agree on bit i
+    std::vector<std::vector<std::array<std::uint64_t, 3>>> masks;
+} hash_set_t;
+
+
+static
+bool bit_of(hash_4_simd_t const & h, unsigned int bix)
+{
+    return (h.h160[bix / 8] >> (bix % 8)) & 1;
+}
+
+
+static
+hash_4_simd_t random_hash(std::mt19937_64 & rng)
+{
+    hash_4_simd_t rv{};
+    for (auto & byte : rv.h160)
+    {
+        byte = rng();
+    }
+
+    return rv;
+}
+
+
+static
+hash_set_t make_hash_set(std::mt19937_64 & rng, std::size_t ntargets, std::size_t nqueries)
+{
+    hash_set_t set;
+
+    for (auto tix = 0u; tix < ntargets; ++tix)
+    {
+        set.targets.push_back(tix % 100 == 99 ? set.targets[rng() % tix] : random_hash(rng));
+    }
+
+    for (auto qix = 0u; qix < nqueries; ++qix)
+    {
+        auto query = random_hash(rng);
+        auto const & target = set.targets[rng() % ntargets];
+
+        switch (qix % 8)
+        {
+            case 0:
+                break;
+            case 1:
+                query = target;
+                break;
+            default:
+            {
+                auto const len = 1 + (unsigned int)(rng() % 160);
+                auto const offset = (unsigned int)(rng() % (161 - len));
+                for (auto bix = offset; bix < offset + len; ++bix)
+                {
+                    query.h160[bix / 8] &= ~(1u << (bix % 8));
+                    query.h160[bix / 8] |= bit_of(target, bix) << (bix % 8);
+                }
+                break;
+            }
+        }
+        set.queries.push_back(query);
+    }
+
+    set.masks.assign(nqueries, std::vector<std::array<std::uint64_t, 3>>(ntargets));
+    for (auto qix = 0u; qix < nqueries; ++qix)
+    {
+        for (auto tix = 0u; tix < ntargets; ++tix)
+        {
+            auto & mask = set.masks[qix][tix];
+            mask = {};
+            for (auto bix = 0u; bix < 160; ++bix)
+            {
+                if (bit_of(set.queries[qix], bix) == bit_of(set.targets[tix], bix))
+                {
+                    mask[bix / 64] |= 1ULL << (bix % 64);
+                }
+            }
+        }
+    }
+
+    return set;
+}
+
+
+static
+bool mask_bit(std::array<std::uint64_t, 3> const & mask, unsigned int bix)
+{
+    return (mask[bix / 64] >> (bix % 64)) & 1;
+}
+
+
+// longest run of set bits, lowest offset on ties, one bit at a time
+static
+run_t reference_run(std::array<std::uint64_t, 3> const & mask)
+{
+    run_t best = {0, 0};
+
+    for (auto start = 0u; start < 160; /* nop */)
+    {
+        auto end = start;
+        while ((end < 160) and mask_bit(mask, end))
+        {
+            ++end;
+        }
+        if (end - start > best.len)
+        {
+            best = {end - start, start};
+        }
+        start = end + 1;
+    }
+
+    return best;
+}
+
+
+// The chunk index and the window scan against the runs found one bit at a
+// time: longest_run finds the same runs, window_scan returns exactly the
+// targets holding one at every kernel level, and the index returns exactly
+// the targets sharing a whole chunk, which include them.
+static
+void check_target_index(std::mt19937_64 & rng)
+{
+    group_begin();
+
+    auto constexpr NTARGETS = 1000u;
+    auto constexpr NQUERIES = 400u;
+    auto const set = make_hash_set(rng, NTARGETS, NQUERIES);
+
+    std::vector<std::vector<run_t>> runs(NQUERIES, std::vector<run_t>(NTARGETS));
+    for (auto qix = 0u; qix < NQUERIES; ++qix)
+    {
+        for (auto tix = 0u; tix < NTARGETS; ++tix)
+        {
+            runs[qix][tix] = reference_run(set.masks[qix][tix]);
+        }
+    }
+
+    std::vector<std::uint32_t> tixs;
+    std::vector<std::uint32_t> expected;
+
+    for (auto const min_len : {1u, 8u, 12u, 16u, 20u, 24u, 31u, 32u, 40u, 63u, 64u, 65u, 100u, 159u, 160u})
+    {
+        for (auto qix = 0u; qix < NQUERIES; ++qix)
+        {
+            for (auto tix = 0u; tix < NTARGETS; ++tix)
+            {
+                auto const & run = runs[qix][tix];
+                auto const got = longest_run(set.targets[tix], set.queries[qix], min_len);
+                auto const ok = run.len >= min_len
+                    ? (got.len == run.len) and (got.offset == run.offset)
+                    : (got.len == 0) and (got.offset == 0);
+                expect(ok, "longest_run, min_len %u, query %u, target %u: %u bits at %u instead of %u at %u",
+                    min_len, qix, tix, got.len, got.offset, run.len, run.offset);
+            }
+        }
+
+        for_each_kernels([&](cpu_kernels_t, char const * kernels_name)
+        {
+            window_scan_t scan;
+            window_scan_build(scan, set.targets.data(), NTARGETS, min_len);
+
+            for (auto qix = 0u; qix < NQUERIES; ++qix)
+            {
+                expected.clear();
+                for (auto tix = 0u; tix < NTARGETS; ++tix)
+                {
+                    if (runs[qix][tix].len >= min_len)
+                    {
+                        expected.push_back(tix);
+                    }
+                }
+
+                window_scan(scan, set.queries[qix], tixs);
+                expect(tixs == expected, "window_scan, min_len %u, query %u, %s kernels: %lu targets instead of %lu",
+                    min_len, qix, kernels_name, tixs.size(), expected.size());
+            }
+        });
+
+        target_index_t index;
+        if (not target_index_build(index, set.targets.data(), NTARGETS, min_len))
+        {
+            continue;
+        }
+
+        for (auto qix = 0u; qix < NQUERIES; ++qix)
+        {
+            expected.clear();
+            for (auto tix = 0u; tix < NTARGETS; ++tix)
+            {
+                auto const & mask = set.masks[qix][tix];
+                auto const shares_chunk = std::any_of(index.chunk_offsets.cbegin(), index.chunk_offsets.cend(),
+                    [&](unsigned int offset)
+                    {
+                        for (auto bix = offset; bix < offset + index.chunk_nbits; ++bix)
+                        {
+                            if (not mask_bit(mask, bix))
+                            {
+                                return false;
+                            }
+                        }
+                        return true;
+                    });
+
+                expect(shares_chunk or (runs[qix][tix].len < min_len),
+                    "target_index, min_len %u: query %u holds a run with target %u in no chunk", min_len, qix, tix);
+                if (shares_chunk)
+                {
+                    expected.push_back(tix);
+                }
+            }
+
+            target_index_lookup(index, set.queries[qix], tixs);
+            expect(tixs == expected, "target_index, min_len %u, query %u: %lu candidates instead of %lu",
+                min_len, qix, tixs.size(), expected.size());
+        }
+    }
+
+    group_end("target_index, window_scan, longest_run");
+}
+
+
+// The filtered exact index against a plain map of the targets, at every
+// kernel level and for sizes around every shape of the Eytzinger layout:
+// every target is found with all its duplicates, and neither hashes a
+// single bit away from one nor random ones are. The vector filter test
+// also agrees with the scalar one on random blocks.
+static
+void check_exact_index(std::mt19937_64 & rng)
+{
+    group_begin();
+
+    std::vector<std::size_t> sizes;
+    for (auto n = 1u; n <= 40; ++n)
+    {
+        sizes.push_back(n);
+    }
+    sizes.push_back(1000);
+    sizes.push_back(65535);
+    sizes.push_back(65536);
+
+    std::vector<std::uint32_t> tixs;
+    std::vector<std::uint32_t> expected;
+
+    for (auto const ntargets : sizes)
+    {
+        std::vector<hash_4_simd_t> targets;
+        std::multimap<hash160_t, std::uint32_t> reference;
+        for (auto tix = 0u; tix < ntargets; ++tix)
+        {
+            targets.push_back((tix % 7 == 6) ? targets[rng() % tix] : random_hash(rng));
+            reference.emplace(targets.back().h160, tix);
+        }
+
+        std::vector<hash_4_simd_t> queries;
+        for (auto qix = 0u; qix < 400; ++qix)
+        {
+            auto query = targets[rng() % ntargets];
+            switch (qix % 4)
+            {
+                case 0:
+                    break;
+                case 1:
+                case 2:
+                {
+                    auto const bix = rng() % 160;
+                    query.h160[bix / 8] ^= 1u << (bix % 8);
+                    break;
+                }
+                default:
+                    query = random_hash(rng);
+                    break;
+            }
+            queries.push_back(query);
+        }
+
+        for_each_kernels([&](cpu_kernels_t, char const * kernels_name)
+        {
+            exact_index_t index;
+            exact_index_build(index, targets.data(), ntargets);
+
+            for (auto const & query : queries)
+            {
+                expected.clear();
+                auto const range = reference.equal_range(query.h160);
+                for (auto it = range.first; it != range.second; ++it)
+                {
+                    expected.push_back(it->second);
+                }
+
+                exact_index_prefetch(index, query);
+                exact_index_lookup(index, query, tixs);
+                expect(tixs == expected, "exact_index of %lu targets, %s kernels: %lu targets instead of %lu",
+                    ntargets, kernels_name, tixs.size(), expected.size());
+            }
+        });
+    }
+
+    if (cpu_kernels_supported() >= CPU_KERNELS_AVX2)
+    {
+        for (auto ix = 0u; ix < 100000; ++ix)
+        {
+            exact_index_block_t block;
+            for (auto & lane : block.lanes)
+            {
+                // dense enough for some tests to pass
+                lane = rng() | rng();
+            }
+            auto const x = (std::uint32_t)rng();
+
+            expect(exact_index_test_x8(block, x) == exact_index_test_x1(block, x),
+                "exact_index_test_x8 differs from exact_index_test_x1 for x = %08x", x);
+        }
+    }
+
+    group_end("exact_index");
+}
+
+
+// The public key scan and the near-neighbour index against matched_bits()
+// over all targets. pubkey_match and pubkey_match_pair return exactly the
+// targets scoring high enough at every kernel level, with and without
+// VPOPCNTDQ; near_index_lookup returns exactly the targets close enough on
+// a substring, which include them.
+static
+void check_near_index(std::mt19937_64 & rng)
+{
+    group_begin();
+
+    auto constexpr NTARGETS = 2000u;
+    auto constexpr NQUERIES = 400u;
+
+    auto const random_pubkey = [&rng]()
+    {
+        pubkey_t rv;
+        for (auto & word : rv.vi64)
+        {
+            word = rng();
+        }
+        return rv;
+    };
+
+    // a key with nflips random bits of another flipped, some repeatedly
+    auto const flipped = [&rng](pubkey_t key, unsigned int nflips)
+    {
+        for (auto fix = 0u; fix < nflips; ++fix)
+        {
+            auto const bix = rng() % 512;
+            key.vi64[bix / 64] ^= 1ULL << (bix % 64);
+        }
+        return key;
+    };
+
+    std::vector<pubkey_t> targets;
+    for (auto tix = 0u; tix < NTARGETS; ++tix)
+    {
+        targets.push_back(tix % 100 == 99 ? targets[rng() % tix] : random_pubkey());
+    }
+
+    // keys and their negations: the same x, another y
+    std::vector<pubkey_t> queries;
+    std::vector<pubkey_t> negs;
+    for (auto qix = 0u; qix < NQUERIES; ++qix)
+    {
+        auto const & target = targets[rng() % NTARGETS];
+        queries.push_back(qix % 8 == 0 ? random_pubkey() : flipped(target, rng() % 170));
+
+        auto neg = flipped(targets[rng() % NTARGETS], rng() % 170);
+        std::copy(queries.back().vi64.cbegin(), queries.back().vi64.cbegin() + 4, neg.vi64.begin());
+        negs.push_back(neg);
+    }
+
+    auto const matching = [&](pubkey_t const & key, unsigned int min_matched)
+    {
+        std::vector<std::uint32_t> rv;
+        for (auto tix = 0u; tix < NTARGETS; ++tix)
+        {
+            if (matched_bits(key, targets[tix]) >= min_matched)
+            {
+                rv.push_back(tix);
+            }
+        }
+        return rv;
+    };
+
+    std::vector<std::uint32_t> tixs;
+    std::vector<std::uint32_t> neg_tixs;
+
+    for (auto const min_matched : {0u, 256u, 300u, 352u, 400u, 448u, 470u, 480u, 490u, 500u, 511u, 512u})
+    {
+        std::vector<std::vector<std::uint32_t>> expected(NQUERIES);
+        std::vector<std::vector<std::uint32_t>> neg_expected(NQUERIES);
+        for (auto qix = 0u; qix < NQUERIES; ++qix)
+        {
+            expected[qix] = matching(queries[qix], min_matched);
+            neg_expected[qix] = matching(negs[qix], min_matched);
+        }
+
+        for_each_kernels([&](cpu_kernels_t, char const * kernels_name)
+        {
+            pubkey_match_t match;
+            pubkey_match_build(match, targets.data(), NTARGETS, min_matched);
+
+            // the nibble lookup table too where VPOPCNTDQ would take over
+            for (auto const vpopcntdq : {false, true})
+            {
+                if (vpopcntdq and not match.vpopcntdq)
+                {
+                    continue;
+                }
+                auto m = match;
+                m.vpopcntdq = vpopcntdq;
+
+                for (auto qix = 0u; qix < NQUERIES; ++qix)
+                {
+                    pubkey_match(m, queries[qix], tixs);
+                    expect(tixs == expected[qix], "pubkey_match, %u bits, %s kernels%s, query %u: %lu targets instead of %lu",
+                        min_matched, kernels_name, vpopcntdq ? " with vpopcntdq" : "", qix, tixs.size(), expected[qix].size());
+
+                    pubkey_match_pair(m, queries[qix], negs[qix], tixs, neg_tixs);
+                    expect((tixs == expected[qix]) and (neg_tixs == neg_expected[qix]),
+                        "pubkey_match_pair, %u bits, %s kernels%s, query %u", min_matched, kernels_name, vpopcntdq ? " with vpopcntdq" : "", qix);
+                }
+            }
+        });
+
+        // forced whatever its cost, but where it probes too many buckets for a test
+        near_index_t near;
+        if ((min_matched < 352) or not near_index_build(near, targets.data(), NTARGETS, min_matched, 512 - min_matched))
+        {
+            continue;
+        }
+
+        // one built wider and narrowed, as aladdin -m does, probes the same buckets
+        near_index_t narrowed;
+        near_index_build(narrowed, targets.data(), NTARGETS, 352, 512 - 352);
+        near_index_narrow(narrowed, min_matched);
+        expect(narrowed.radius == near.radius, "near_index_narrow to %u bits: radius %u instead of %u",
+            min_matched, narrowed.radius, near.radius);
+
+        auto const max_flips = near.radius / 32;
+        for (auto qix = 0u; qix < NQUERIES; ++qix)
+        {
+            std::vector<std::uint32_t> candidates;
+            for (auto tix = 0u; tix < NTARGETS; ++tix)
+            {
+                for (auto six = 0u; six < 32; ++six)
+                {
+                    auto const a = (queries[qix].vi64[six / 4] >> (16 * (six % 4))) & 0xFFFF;
+                    auto const b = (targets[tix].vi64[six / 4] >> (16 * (six % 4))) & 0xFFFF;
+                    if ((unsigned int)__builtin_popcount(a ^ b) <= max_flips)
+                    {
+                        candidates.push_back(tix);
+                        break;
+                    }
+                }
+            }
+
+            near_index_lookup(near, queries[qix], tixs);
+            expect(tixs == candidates, "near_index, %u bits, query %u: %lu candidates instead of %lu",
+                min_matched, qix, tixs.size(), candidates.size());
+            expect(std::includes(tixs.cbegin(), tixs.cend(), expected[qix].cbegin(), expected[qix].cend()),
+                "near_index, %u bits, query %u: misses a matching target", min_matched, qix);
+
+            near_index_lookup(narrowed, queries[qix], neg_tixs);
+            expect(neg_tixs == tixs, "near_index_narrow to %u bits, query %u: %lu candidates instead of %lu",
+                min_matched, qix, neg_tixs.size(), tixs.size());
+        }
+    }
+
+    group_end("pubkey_match, near_index");
+}
+
+
+int main(int argc, char **argv)
+{
+    if (argc != 1)
+    {
+        fprintf(stderr,
+            "Usage: %s\n\n"
+            "Checks the fast paths against OpenSSL and the plain scans they replace, at every kernel level the CPU supports.\n"
+            "Exits with failure if any check fails.\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // fixed seed, every run checks the same inputs
+    std::mt19937_64 rng(0x7E57);
+
+    ossl_ec_t ec;
+    ec.group_p = EC_GROUP_new_by_curve_name(NID_secp256k1);
+    ec.ctx_p = BN_CTX_new();
+    ec.order_p = BN_new();
+    EC_GROUP_get_order(ec.group_p, ec.order_p, ec.ctx_p);
+    ec.point_p = EC_POINT_new(ec.group_p);
+
+    auto const scalars = test_scalars(ec, rng);
+
+    // the table gej_mul_gen builds itself, before any other is installed
+    check_mul_gen(ec, scalars, "4-bit");
+    check_walks(ec);
+    check_batch(ec, scalars);
+    check_keygen(ec);
+    check_sha256(rng);
+    check_ripemd160(rng);
+    check_target_index(rng);
+    check_exact_index(rng);
+    check_near_index(rng);
+
+    std::vector<ge_storage_t> table8(gen_table_npoints(8));
+    gen_table_fill(8, table8.data());
+    gen_table_install(gen_table_t{8, table8.data()});
+    check_mul_gen(ec, scalars, "8-bit");
+
+    // the 16-bit one as it is used, written to a file and mapped
+    char dname[] = "/tmp/test_gen_table_XXXXXX";
+    if (mkdtemp(dname) == nullptr)
+    {
+        fprintf(stderr, "[!] Failed to create a directory for the generator table\n");
+        return EXIT_FAILURE;
+    }
+    auto const fname = std::string(dname) + "/g16.tab";
+    bool const table16_ok = gen_table_open(fname, false);
+    unlink(fname.c_str());
+    rmdir(dname);
+    if (table16_ok)
+    {
+        check_mul_gen(ec, scalars, "16-bit");
+    }
+    else
+    {
+        ++g_nfailed_total;
+    }
+
+    EC_POINT_free(ec.point_p);
+    BN_free(ec.order_p);
+    BN_CTX_free(ec.ctx_p);
+    EC_GROUP_free(ec.group_p);
+
+    if (g_nfailed_total != 0)
+    {
+        fprintf(stderr, "[!] %u checks failed\n", g_nfailed_total);
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "[i] All checks passed\n");
+    return EXIT_SUCCESS;
+}
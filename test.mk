@@ -0,0 +1,8 @@
+test: $(OSSL_DIR)/libcrypto.a test.cpp keygen.cpp keygen.hpp secp256k1.cpp secp256k1.hpp gen_table.cpp gen_table.hpp chacha20.cpp chacha20.hpp sha256_mb.cpp sha256_mb.hpp ripemd160_mb.cpp ripemd160_mb.hpp unaddr.hpp simd_u32.hpp target_index.cpp target_index.hpp window_scan.cpp window_scan.hpp longest_run.hpp exact_index.cpp exact_index.hpp pubkey_match.cpp pubkey_match.hpp near_index.cpp near_index.hpp cpu_dispatch.cpp cpu_dispatch.hpp fd_io.cpp fd_io.hpp test.mk
+	$(CXX) \
+	test.cpp keygen.cpp secp256k1.cpp gen_table.cpp chacha20.cpp sha256_mb.cpp ripemd160_mb.cpp target_index.cpp window_scan.cpp exact_index.cpp pubkey_match.cpp near_index.cpp cpu_dispatch.cpp fd_io.cpp -o test \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt -Wno-psabi \
+	$(OSSL_DIR)/libcrypto.a \
+	-I$(OSSL_DIR) \
+	-I$(OSSL_DIR)/include \
+	-O3
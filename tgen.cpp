@@ -2,6 +2,7 @@
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <optional>
 #include <iostream>
 #include <cctype>
 #include <algorithm>
@@ -9,17 +10,101 @@
 #include <cstdint>
 #include <array>
 
+#include "secp256k1.hpp"
+#include "keygen.hpp"
+#include "gen_table.hpp"
+#include "sample_writer.hpp"
+
 #include <openssl/bn.h>
-#include <openssl/objects.h>
-#include <openssl/ec.h>
+
+#include <fcntl.h>
+#include <unistd.h>
 
 struct parsed_args
 {
     bool help = false;
-    unsigned int bitsel;
+    bool gen_table_huge_pages = false;
+    bool npy = false;
+    sample_format_t format = SAMPLE_FORMAT_HEX;
+    std::vector<unsigned int> bitsels;
+    unsigned int block_size = 1;
+    std::uint64_t walk_nsteps = 0;
+    std::uint64_t walk_stride = 1;
+    std::optional<std::uint64_t> maybe_ngen;
+    std::optional<std::uint64_t> maybe_seed;
+    std::optional<std::string> maybe_gen_table_fname;
+    std::optional<std::string> maybe_labels_prefix;
+    std::optional<std::string> maybe_labels_fname;
 };
 
 
+// bits of a private key a label can be taken from
+static constexpr unsigned int NBITS = 256;
+
+
+// Parse a bit selector: "all", or a comma-separated list of bit indices and
+// ranges of them, e.g. 0,8-15,255, into indices sorted and without duplicates.
+static
+bool parse_bitsels(char const * s, std::vector<unsigned int> & bitsels)
+{
+    bitsels.clear();
+
+    if (std::strcmp(s, "all") == 0)
+    {
+        for (auto bix = 0u; bix < NBITS; ++bix)
+        {
+            bitsels.push_back(bix);
+        }
+        return true;
+    }
+
+    while (true)
+    {
+        char * end_p = nullptr;
+        auto const first = strtol(s, &end_p, 10);
+        auto last = first;
+
+        if ((end_p == s) or not std::isdigit((unsigned char)*s))
+        {
+            return false;
+        }
+        if (*end_p == '-')
+        {
+            s = end_p + 1;
+            last = strtol(s, &end_p, 10);
+            if ((end_p == s) or not std::isdigit((unsigned char)*s))
+            {
+                return false;
+            }
+        }
+        if ((first > last) or (last >= (long)NBITS))
+        {
+            return false;
+        }
+
+        for (auto bix = first; bix <= last; ++bix)
+        {
+            bitsels.push_back(bix);
+        }
+
+        if (*end_p == '\0')
+        {
+            break;
+        }
+        if (*end_p != ',')
+        {
+            return false;
+        }
+        s = end_p + 1;
+    }
+
+    std::sort(bitsels.begin(), bitsels.end());
+    bitsels.erase(std::unique(bitsels.begin(), bitsels.end()), bitsels.end());
+
+    return true;
+}
+
+
 int parse_args(int argc, char* argv[], parsed_args & parsed)
 {
     auto constexpr N_REQUIRED = 1u;
@@ -32,6 +117,162 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
         {
             switch (c)
             {
+                case 'b':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoi(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.block_size = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid block size passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'T':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_gen_table_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'H':
+                    parsed.gen_table_huge_pages = true;
+                    break;
+                case 'g':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoll(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.maybe_ngen = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of keys to generate passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 's':
+                {
+                    if (--argc > 0)
+                    {
+                        char * end_p = nullptr;
+                        auto val = strtoull(argv[1], &end_p, 0);
+                        if ((*argv[1] != '\0') and (*end_p == '\0'))
+                        {
+                            parsed.maybe_seed = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid seed passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'w':
+                {
+                    if (--argc > 0)
+                    {
+                        auto val = atoll(argv[1]);
+                        if (val >= 1)
+                        {
+                            parsed.walk_nsteps = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid number of walk steps passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'd':
+                {
+                    if (--argc > 0)
+                    {
+                        char * end_p = nullptr;
+                        auto val = strtoull(argv[1], &end_p, 0);
+                        if ((*argv[1] != '\0') and (*end_p == '\0') and (val >= 1))
+                        {
+                            parsed.walk_stride = val;
+                        }
+                        else
+                        {
+                            fprintf(stderr, "Invalid walk stride passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'F':
+                {
+                    if (--argc > 0)
+                    {
+                        if (not sample_format_parse(argv[1], parsed.format))
+                        {
+                            fprintf(stderr, "Invalid output format passed: %s\n", argv[1]);
+                            argc = 0;
+                        }
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'L':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_labels_fname = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
+                case 'N':
+                    parsed.npy = true;
+                    break;
+                case 'o':
+                {
+                    if (--argc > 0)
+                    {
+                        parsed.maybe_labels_prefix = argv[1];
+
+                        argv++;
+                        *argv+= strlen(*argv) - 1;
+                    }
+                    break;
+                }
                 case 'h':
                     show_help = true;
                     parsed.help = show_help;
@@ -47,15 +288,40 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
         }
     }
 
-    if (argc == N_REQUIRED)
+    if ((argc == N_REQUIRED) and not parse_bitsels(argv[0], parsed.bitsels))
     {
-        int val = atoi(argv[0]);
+        fprintf(stderr, "Invalid bit selector passed: %s. Must be \"all\" or a list of bit indices from 0 to %u and ranges of them, e.g. 0,8-15.\n", argv[0], NBITS - 1);
+        argc = 0;
+    }
 
-        if (val < 0)
-        {
-            fprintf(stderr, "Invalid index of selected bit passed: %s. Must be an integer greater than or equal 0.\n", argv[0]);
-            argc = 0;
-        }
+    if (parsed.gen_table_huge_pages and not parsed.maybe_gen_table_fname)
+    {
+        fprintf(stderr, "Huge pages are for the generator table, -H requires -T.\n");
+        argc = 0;
+    }
+
+    if ((parsed.maybe_seed or (parsed.walk_nsteps != 0)) and not parsed.maybe_ngen)
+    {
+        fprintf(stderr, "Seeds and walks are for generated keys, -s and -w require -g.\n");
+        argc = 0;
+    }
+
+    if ((parsed.walk_stride != 1) and (parsed.walk_nsteps == 0))
+    {
+        fprintf(stderr, "The stride is that of walks, -d requires -w.\n");
+        argc = 0;
+    }
+
+    if ((parsed.maybe_labels_fname or parsed.npy) and (parsed.format == SAMPLE_FORMAT_HEX))
+    {
+        fprintf(stderr, "Labels files and .npy headers are for binary outputs, -L and -N require -F.\n");
+        argc = 0;
+    }
+
+    if (parsed.maybe_labels_prefix and (parsed.format != SAMPLE_FORMAT_HEX))
+    {
+        fprintf(stderr, "Per-bit label files are text, -o excludes -F.\n");
+        argc = 0;
     }
 
     if (show_help or (argc != N_REQUIRED))
@@ -67,17 +333,27 @@ int parse_args(int argc, char* argv[], parsed_args & parsed)
 
         fprintf(stderr,
             "\n"
-            "Usage: tgen <bit selector:UINT>\n\n"
-            "bit selector:\tselect nth bit of input private key as target label\n\n"
+            "Usage: tgen <bit selector:UINT|LIST|all>\n\n"
+            "bit selector:\tselect nth bit of input private key as target label, or several bits: \"all\" or a\n"
+            "\t\tcomma-separated list of bit indices and ranges of them, e.g. 0,8-15; their labels are packed\n"
+            "\t\tinto a hex number, the label of the i-th lowest selected bit at bit i\n\n"
             "Options:\n"
+            "         -o STR    write the labels of every selected bit b to file STR.b instead, as tgen b prints them\n"
+            "         -F STR    write the public keys as hex text lines (default), or binary rows of their 512 bits: packed\n"
+            "                   64-byte records, or one u8 or f32 0/1 per bit, without the labels\n"
+            "         -L STR    with -F, write the labels to file STR, rows of the selected bits in the same format\n"
+            "         -N        with -F, start the outputs with a .npy header, stdout must then be a file\n"
+            "         -g UINT64 generate UINT64 private keys instead of reading them from stdin\n"
+            "         -s UINT64 with -g, draw the keys from a ChaCha20 stream keyed by UINT64 instead of the OpenSSL pool\n"
+            "         -w UINT64 with -g, walk k, k+1, k+2, ... by point addition, drawing new random k every UINT64 keys\n"
+            "         -d UINT64 with -w, walk k, k+UINT64, k+2*UINT64, ... instead (default 1)\n"
+            "         -b UINT   derive public keys in blocks of UINT sharing one field inversion, >= 1 (default 1)\n"
+            "         -T STR    multiply by G with the 64 MiB table mapped from file STR, which is built first if missing\n"
+            "         -H        with -T, copy the table onto huge pages instead of mapping the file\n"
             "         -h        show help\n");
 
         return show_help ? EXIT_SUCCESS : EXIT_FAILURE;
     }
-    else
-    {
-        parsed.bitsel = atoi(argv[0]);
-    }
 
     return EXIT_SUCCESS;
 }
@@ -97,38 +373,196 @@ int main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
-    EC_KEY *key_p = EC_KEY_new_by_curve_name(NID_secp256k1);
-
-    if (key_p == nullptr)
+    if (args.maybe_gen_table_fname and not gen_table_open(*args.maybe_gen_table_fname, args.gen_table_huge_pages))
     {
-        fprintf(stderr, "[!] Failed to allocate new EC key\n");
         return EXIT_FAILURE;
     }
 
-    BIGNUM *priv_p = BN_new();
+    BN_CTX *ctx_p = BN_CTX_new();
+    BIGNUM *order_p = nullptr;
+    BIGNUM *reduced_p = BN_new();
 
-    if (priv_p == nullptr)
+    if ((ctx_p == nullptr) or (reduced_p == nullptr) or not BN_hex2bn(&order_p, SECP256K1_ORDER_HEX))
     {
-        fprintf(stderr, "[!] Failed to allocate new BIGNUM private key\n");
+        fprintf(stderr, "[!] Failed to allocate BIGNUM context\n");
         return EXIT_FAILURE;
     }
 
-    BN_CTX *ctx_p = BN_CTX_new();
+    // with -o, one file per selected bit
+    std::vector<FILE *> label_files;
+    if (args.maybe_labels_prefix)
+    {
+        for (auto const bitsel : args.bitsels)
+        {
+            auto const fname = *args.maybe_labels_prefix + "." + std::to_string(bitsel);
+            auto * f_p = fopen(fname.c_str(), "w");
 
-    if (ctx_p == nullptr)
+            if (f_p == nullptr)
+            {
+                fprintf(stderr, "[!] Failed to open %s\n", fname.c_str());
+                return EXIT_FAILURE;
+            }
+            label_files.push_back(f_p);
+        }
+    }
+
+    // text lines or binary rows of the keys, binary rows of the labels
+    bool const binary = args.format != SAMPLE_FORMAT_HEX;
+    sample_writer_t keys_out;
+    sample_writer_t labels_out;
+    int labels_fd = -1;
+
+    if (not sample_writer_open(keys_out, STDOUT_FILENO, args.format, args.npy, 8 * 64))
     {
-        fprintf(stderr, "[!] Failed to allocate new BIGNUM context\n");
         return EXIT_FAILURE;
     }
+    if (args.maybe_labels_fname)
+    {
+        labels_fd = open(args.maybe_labels_fname->c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (labels_fd < 0)
+        {
+            fprintf(stderr, "[!] Failed to open %s\n", args.maybe_labels_fname->c_str());
+            return EXIT_FAILURE;
+        }
+        if (not sample_writer_open(labels_out, labels_fd, args.format, args.npy, args.bitsels.size()))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto const BLOCK_SIZE = args.block_size;
+    std::vector<BIGNUM *> privs(BLOCK_SIZE, nullptr);
+    std::vector<gej_t> pubs(BLOCK_SIZE);
+    std::vector<ge_t> affine(BLOCK_SIZE);
+
+    for (auto ix = 0u; ix < BLOCK_SIZE; ++ix)
+    {
+        privs[ix] = BN_new();
+
+        if (privs[ix] == nullptr)
+        {
+            fprintf(stderr, "[!] Failed to allocate block of private keys\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    // the samples of nkeys affine points, priv_of(ix) the private key of the ix-th
+    auto const write_block = [&](std::size_t nkeys, ge_t const * affine_p, auto const & priv_of)
+    {
+        static char const HEX[] = "0123456789ABCDEF";
+
+        auto const nbitsels = args.bitsels.size();
+
+        std::string pub_hex;
+        std::string line;
+        std::vector<std::uint8_t> labels((nbitsels + 7) / 8);
+        for (auto ix = 0u; ix < nkeys; ++ix)
+        {
+            BIGNUM const * priv_p = priv_of(ix);
+
+            if (binary)
+            {
+                // x and y, skipping the 04 header; zeros for the point at infinity
+                std::uint8_t pub[65] = {};
+                if (not affine_p[ix].infinity)
+                {
+                    ge_to_uncompressed(affine_p[ix], pub);
+                }
+                sample_writer_push(keys_out, pub + 1);
+
+                if (labels_fd >= 0)
+                {
+                    std::fill(labels.begin(), labels.end(), 0);
+                    for (auto six = 0u; six < nbitsels; ++six)
+                    {
+                        labels[six / 8] |= BN_is_bit_set(priv_p, args.bitsels[six]) << (7 - six % 8);
+                    }
+                    sample_writer_push(labels_out, labels.data());
+                }
+                continue;
+            }
+
+            // x and y, skipping the 04 header; nothing for the point at infinity
+            pub_hex.clear();
+            if (not affine_p[ix].infinity)
+            {
+                std::uint8_t pub[65];
+                ge_to_uncompressed(affine_p[ix], pub);
+
+                for (auto bix = 1u; bix < sizeof (pub); ++bix)
+                {
+                    pub_hex += HEX[pub[bix] >> 4];
+                    pub_hex += HEX[pub[bix] & 0xF];
+                }
+            }
+            pub_hex += '\n';
+
+            // every label of the key from the one derivation
+            if (not label_files.empty())
+            {
+                for (auto six = 0u; six < nbitsels; ++six)
+                {
+                    fputs(BN_is_bit_set(priv_p, args.bitsels[six]) ? "1\t" : "0\t", label_files[six]);
+                    fputs(pub_hex.c_str(), label_files[six]);
+                }
+                continue;
+            }
+
+            // the label of the i-th selected bit at bit i, a single bit prints as it always did
+            line.clear();
+            for (auto dix = (nbitsels + 3) / 4; dix-- > 0; /* nop */)
+            {
+                unsigned int nibble = 0;
+                for (auto six = 4 * dix; six < std::min<std::size_t>(4 * dix + 4, nbitsels); ++six)
+                {
+                    nibble |= BN_is_bit_set(priv_p, args.bitsels[six]) << (six % 4);
+                }
+                line += HEX[nibble];
+            }
+            line += '\t';
+            line += pub_hex;
+            sample_writer_append(keys_out, line);
+        }
+    };
+
+    // Jacobian points of a block are converted to affine together with a single shared inversion
+    auto const flush_block = [&](std::size_t nkeys)
+    {
+        ge_set_gej_batch(affine.data(), pubs.data(), nkeys);
+        write_block(nkeys, affine.data(), [&privs](std::size_t ix){ return privs[ix]; });
+    };
+
+    // generated keys, no text on the way
+    if (args.maybe_ngen)
+    {
+        auto * kg_p = keygen_new(args.walk_nsteps, BLOCK_SIZE, args.maybe_seed, 0, args.walk_stride);
+        std::vector<uncompressed_key_t> uncompressed(BLOCK_SIZE);
+
+        if (kg_p == nullptr)
+        {
+            fprintf(stderr, "[!] Failed to allocate key generator\n");
+            return EXIT_FAILURE;
+        }
+
+        for (std::uint64_t it = 0; it < *args.maybe_ngen; it += BLOCK_SIZE)
+        {
+            if (not keygen_next_block(*kg_p, uncompressed.data()))
+            {
+                fprintf(stderr, "[!] Failed to generate keys\n");
+                return EXIT_FAILURE;
+            }
+
+            write_block(std::min<std::uint64_t>(BLOCK_SIZE, *args.maybe_ngen - it), kg_p->affine.data(),
+                [kg_p](std::size_t ix){ return keygen_private_key(*kg_p, ix); });
+        }
+
+        keygen_free(kg_p);
+    }
 
-    // generate dummy key (lazy way to create EC key's group)
-    EC_KEY_generate_key(key_p);
-    EC_GROUP const *group_p = EC_KEY_get0_group(key_p);
-    EC_POINT *pub_p = EC_POINT_new(group_p);
-    point_conversion_form_t const form = EC_GROUP_get_point_conversion_form(group_p);
+    std::size_t nkeys = 0;
 
-    // read from stdin
-    for (std::string line; std::getline(std::cin, line);)
+    // read from stdin, unless the keys are generated
+    for (std::string line; not args.maybe_ngen and std::getline(std::cin, line);)
     {
         line.erase(
             std::remove_if(line.begin(), line.end(),
@@ -142,27 +576,58 @@ int main(int argc, char **argv)
             continue;
         }
 
-        auto const bytes_read = BN_hex2bn(&priv_p, line.c_str());
+        auto const bytes_read = BN_hex2bn(&privs[nkeys], line.c_str());
         if (bytes_read != line.size())
         {
             fprintf(stderr, "[w] parsing of hex private key input failed: %s\n", line.c_str());
             continue;
         }
 
-        // derive pub key from priv key
-        EC_POINT_mul(group_p, pub_p, priv_p, NULL, NULL, ctx_p);
+        // derive pub key from priv key, taken mod n
+        std::uint8_t k[32] = {};
+        if (not BN_nnmod(reduced_p, privs[nkeys], order_p, ctx_p))
+        {
+            fprintf(stderr, "[w] reduction of private key failed: %s\n", line.c_str());
+            continue;
+        }
+        BN_bn2bin(reduced_p, k + sizeof (k) - BN_num_bytes(reduced_p));
+        gej_mul_gen(pubs[nkeys], k);
 
-        char *pub_hex_p = EC_POINT_point2hex(group_p, pub_p, form, ctx_p);
+        if (++nkeys == BLOCK_SIZE)
+        {
+            flush_block(nkeys);
+            nkeys = 0;
+        }
+    }
 
-        printf("%d\t%s\n", BN_is_bit_set(priv_p, args.bitsel), pub_hex_p + 2 /* skip '04' header */);
+    flush_block(nkeys);
 
-        OPENSSL_free(pub_hex_p);
+    if (not sample_writer_close(keys_out))
+    {
+        return EXIT_FAILURE;
+    }
+    if ((labels_fd >= 0) and (not sample_writer_close(labels_out) or (close(labels_fd) != 0)))
+    {
+        fprintf(stderr, "[!] Failed to write %s\n", args.maybe_labels_fname->c_str());
+        return EXIT_FAILURE;
+    }
+
+    for (auto * f_p : label_files)
+    {
+        if (fclose(f_p) != 0)
+        {
+            fprintf(stderr, "[!] Failed to write labels\n");
+            return EXIT_FAILURE;
+        }
     }
 
-    BN_free(priv_p);
-    EC_KEY_free(key_p);
+    for (auto ix = 0u; ix < BLOCK_SIZE; ++ix)
+    {
+        BN_free(privs[ix]);
+    }
+    BN_free(reduced_p);
+    BN_free(order_p);
     BN_CTX_free(ctx_p);
-    EC_POINT_free(pub_p);
 
     return EXIT_SUCCESS;
 }
@@ -1,7 +1,7 @@
-tgen: $(OSSL_DIR)/libcrypto.a tgen.cpp tgen.mk
+tgen: $(OSSL_DIR)/libcrypto.a tgen.cpp keygen.cpp keygen.hpp chacha20.cpp chacha20.hpp secp256k1.cpp secp256k1.hpp gen_table.cpp gen_table.hpp sample_writer.cpp sample_writer.hpp fd_io.cpp fd_io.hpp tgen.mk
 	$(CXX) \
-	tgen.cpp -o tgen \
-	-std=c++17 -march=native \
+	tgen.cpp keygen.cpp chacha20.cpp secp256k1.cpp gen_table.cpp sample_writer.cpp fd_io.cpp -o tgen \
+	-std=c++17 -march=$(MARCH) -msse4.2 -mpopcnt \
 	$(OSSL_DIR)/libcrypto.a \
 	-I$(OSSL_DIR) \
 	-I$(OSSL_DIR)/include \
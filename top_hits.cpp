@@ -0,0 +1,118 @@
+#include "top_hits.hpp"
+
+#include <cstdio>
+#include <algorithm>
+
+
+// a ranks before b: a higher score, or the same found earlier
+static inline
+bool better(top_hit_t const & a, top_hit_t const & b)
+{
+    return (a.record.score > b.record.score)
+        or ((a.record.score == b.record.score) and (a.seq < b.seq));
+}
+
+
+void top_hits_init(top_hits_t & top, std::size_t ntargets, unsigned int k, unsigned int min_score)
+{
+    top.k = k;
+    top.ntargets = ntargets;
+    top.hits.assign(ntargets * k, top_hit_t{});
+    top.sizes.assign(ntargets, 0);
+    top.bars.assign(ntargets, min_score);
+    top.nentered = 0;
+    top.target_nentered.assign(ntargets, 0);
+}
+
+
+void top_hits_push(top_hits_t & top, hit_record_t const & record)
+{
+    auto const tix = record.tix;
+    if (not top_hits_qualifies(top, tix, record.score))
+    {
+        return;
+    }
+
+    // with better() as the order, the front of the heap is the worst hit
+    auto * first_p = top.hits.data() + std::size_t{top.k} * tix;
+    auto & size = top.sizes[tix];
+
+    if (size == top.k)
+    {
+        std::pop_heap(first_p, first_p + size, better);
+        --size;
+    }
+
+    first_p[size++] = top_hit_t{record, top.nentered++};
+    ++top.target_nentered[tix];
+    std::push_heap(first_p, first_p + size, better);
+
+    if (size == top.k)
+    {
+        top.bars[tix] = first_p->record.score + 1;
+    }
+}
+
+
+unsigned int top_hits_min_bar(top_hits_t const & top)
+{
+    return top.bars.empty() ? 0 : *std::min_element(top.bars.cbegin(), top.bars.cend());
+}
+
+
+void top_hits_sorted(top_hits_t const & top, std::uint32_t tix, std::vector<hit_record_t> & records)
+{
+    auto const * first_p = top.hits.data() + std::size_t{top.k} * tix;
+    std::vector<top_hit_t> hits(first_p, first_p + top.sizes[tix]);
+    std::sort(hits.begin(), hits.end(), better);
+
+    records.clear();
+    for (auto const & hit : hits)
+    {
+        records.push_back(hit.record);
+    }
+}
+
+
+bool top_hits_save(
+    top_hits_t const & top,
+    std::string const & fname,
+    std::optional<hit_stream_header_t> const & maybe_binary_header,
+    hit_format_fn_t const & format)
+{
+    auto const tmp_fname = fname + ".tmp";
+    auto * f_p = fopen(tmp_fname.c_str(), "w");
+
+    if (f_p == nullptr)
+    {
+        return false;
+    }
+
+    std::string out;
+    if (maybe_binary_header)
+    {
+        out.append(reinterpret_cast<char const *>(&*maybe_binary_header), sizeof (hit_stream_header_t));
+    }
+
+    std::vector<hit_record_t> records;
+    for (std::uint32_t tix = 0; tix < top.ntargets; ++tix)
+    {
+        top_hits_sorted(top, tix, records);
+        for (auto const & record : records)
+        {
+            if (maybe_binary_header)
+            {
+                out.append(reinterpret_cast<char const *>(&record), maybe_binary_header->record_size);
+            }
+            else
+            {
+                format(record, out);
+            }
+        }
+    }
+
+    bool const ok = (fwrite(out.data(), 1, out.size(), f_p) == out.size()) and (fflush(f_p) == 0) and not ferror(f_p);
+    fclose(f_p);
+
+    return ok and (rename(tmp_fname.c_str(), fname.c_str()) == 0);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef TOP_HITS_HPP
+#define TOP_HITS_HPP
+
+#include "hit_writer.hpp"
+
+#include <string>
+#include <optional>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// A hit kept, with the order it was found in among all hits kept.
+typedef struct
+{
+    hit_record_t record;
+    std::uint64_t seq;
+} top_hit_t;
+
+
+// The k best-scoring hits of every target, as bounded min-heaps, for runs
+// that keep the best keys found rather than stream every hit past a fixed
+// threshold. bars[tix] is the score a hit needs to enter the heap of tix:
+// the threshold until it holds k hits, then one more than its worst, so
+// that the hot path only compares against it.
+typedef struct
+{
+    unsigned int k;
+    std::size_t ntargets;
+
+    // hits of target tix at hits[k * tix ..], sizes[tix] of them, a heap with the worst first
+    std::vector<top_hit_t> hits;
+    std::vector<std::uint32_t> sizes;
+    std::vector<std::uint16_t> bars;
+
+    // hits that entered a heap so far, in all and per target
+    std::uint64_t nentered;
+    std::vector<std::uint64_t> target_nentered;
+} top_hits_t;
+
+
+void top_hits_init(top_hits_t & top, std::size_t ntargets, unsigned int k, unsigned int min_score);
+
+static inline
+bool top_hits_qualifies(top_hits_t const & top, std::uint32_t tix, unsigned int score)
+{
+    return score >= top.bars[tix];
+}
+
+// Keep the record if it qualifies, replacing the worst hit of its target
+// when the heap is full.
+void top_hits_push(top_hits_t & top, hit_record_t const & record);
+
+// The lowest bar over all targets, below which no hit can enter any heap.
+unsigned int top_hits_min_bar(top_hits_t const & top);
+
+// The hits of target tix, best first, ties in the order they were found.
+void top_hits_sorted(top_hits_t const & top, std::uint32_t tix, std::vector<hit_record_t> & records);
+
+// Write the hits of all targets, in target order, to file fname: as raw
+// records after the header when one is given, else formatted as by the hit
+// writer. Written next to fname and renamed over it, as checkpoints are.
+bool top_hits_save(
+    top_hits_t const & top,
+    std::string const & fname,
+    std::optional<hit_stream_header_t> const & maybe_binary_header,
+    hit_format_fn_t const & format);
+
+
+#endif /* TOP_HITS_HPP */
@@ -1,6 +1,6 @@
 #include "unaddr.hpp"
-#include "ntohl.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <cstdint>
@@ -9,13 +9,12 @@
 #include <openssl/sha.h>
 
 
-typedef struct
-{
-    std::uint64_t v[4];
-} uint256_t;
-
 using hash256_t = std::array<std::uint8_t, 32>;
 
+// digits folded into one 64-bit word before each multiply-add of the
+// 256-bit accumulator, 58^10 < 2^64
+static constexpr unsigned int DIGITS_PER_WORD = 10;
+
 
 static
 std::array<std::uint8_t, 256> make_b58_lut()
@@ -33,102 +32,85 @@ std::array<std::uint8_t, 256> make_b58_lut()
 
 
 static
-void mul(uint256_t & b, unsigned int val)
+std::array<std::uint64_t, DIGITS_PER_WORD + 1> make_pow58()
 {
-    using u128 = unsigned __int128;
-
-    std::uint64_t p;
-
-    {
-        u128 x = b.v[3];
-        x *= val;
-        b.v[3] = x;
-        p = (x >> 64);
-    }
-
-    {
-        u128 x = b.v[2];
-        x *= val;
-        x += p;
-        b.v[2] = x;
-        p = (x >> 64);
-    }
+    std::array<std::uint64_t, DIGITS_PER_WORD + 1> rv = {1};
 
+    for (auto ix = 1u; ix < rv.size(); ++ix)
     {
-        u128 x = b.v[1];
-        x *= val;
-        x += p;
-        b.v[1] = x;
-        p = (x >> 64);
+        rv[ix] = rv[ix - 1] * 58;
     }
 
-    {
-        u128 x = b.v[0];
-        x *= val;
-        x += p;
-        b.v[0] = x;
-    }
+    return rv;
 }
 
 
-static
-void add(uint256_t & b, unsigned int val)
+// w = w * m + a mod 2^256, w in little-endian 64-bit words. The carry of
+// the addition runs through all the words: the per-digit add() this replaced
+// dropped it past the lowest word, so addresses whose low word overflowed
+// used to decode to a wrong hash160 (with a checksum warning) and now match.
+static inline
+void mul_add(std::uint64_t (&w)[4], std::uint64_t m, std::uint64_t a)
 {
     using u128 = unsigned __int128;
 
-    u128 x = b.v[3];
-    x += val;
-    b.v[3] = x;
-
-    x = b.v[2];
-    x += (x >> 64);
-    b.v[2] = x;
-
-    x = b.v[1];
-    x += (x >> 64);
-    b.v[1] = x;
-
-    b.v[0] += (x >> 64);
+    std::uint64_t carry = a;
+    for (auto & x : w)
+    {
+        u128 const acc = (u128)x * m + carry;
+        x = (std::uint64_t)acc;
+        carry = (std::uint64_t)(acc >> 64);
+    }
 }
 
 
-hash160_t unaddr(std::string const &addr)
+bool unaddr(std::string_view addr, hash160_t & h160)
 {
     static const std::array<std::uint8_t, 256> lut = make_b58_lut();
-    uint256_t u256 = {0};
+    static const std::array<std::uint64_t, DIGITS_PER_WORD + 1> pow58 = make_pow58();
 
-    for (auto it = addr.begin(); it != addr.end(); ++it)
+    std::uint64_t w[4] = {0, 0, 0, 0};
+
+    for (std::size_t pos = 0; pos < addr.size(); pos += DIGITS_PER_WORD)
     {
-        auto const val = lut[*it];
-        mul(u256, 58);
-        add(u256, val);
+        auto const ndigits = std::min<std::size_t>(DIGITS_PER_WORD, addr.size() - pos);
+
+        std::uint64_t chunk = 0;
+        for (auto ix = 0u; ix < ndigits; ++ix)
+        {
+            chunk = chunk * 58 + lut[(unsigned char)addr[pos + ix]];
+        }
+        mul_add(w, pow58[ndigits], chunk);
     }
 
-    for (auto & x : u256.v)
+    // big-endian: version byte at 7, hash160 at 8, checksum at 28
+    std::uint8_t be[32];
+    for (auto ix = 0u; ix < 4; ++ix)
     {
-        x = htonll(x);
+        auto const x = __builtin_bswap64(w[ix]);
+        std::memcpy(be + 8 * (3 - ix), &x, sizeof (x));
     }
 
-    auto u256_as_u8 = reinterpret_cast<std::uint8_t const *>(u256.v);
+    hash256_t h1;
+    SHA256(be + 7, 21, h1.data());
 
-    {
-        std::array<std::uint8_t, 21> payload;
-        std::memcpy(payload.data(), u256_as_u8 + 7, payload.size());
+    hash256_t h2;
+    SHA256(h1.data(), h1.size(), h2.data());
 
-        hash256_t h1;
-        SHA256(payload.data(), payload.size(), h1.data());
+    std::memcpy(h160.data(), be + 8, h160.size());
 
-        hash256_t h2;
-        SHA256(h1.data(), h1.size(), h2.data());
+    return std::memcmp(h2.data(), be + 28, 4) == 0;
+}
 
-        if (std::memcmp(h2.data(), u256_as_u8 + 7 + 21, 4) != 0)
-        {
-            fprintf(stderr, "[!] Address checksum mismatch: %s\n", addr.c_str());
-        }
-    }
 
+hash160_t unaddr(std::string const &addr)
+{
     hash160_t rv;
-    std::memcpy(rv.data(), u256_as_u8 + 8, rv.size());
+
+    if (not unaddr(std::string_view(addr), rv))
+    {
+        fprintf(stderr, "[!] Address checksum mismatch: %s\n", addr.c_str());
+    }
 
     return rv;
 }
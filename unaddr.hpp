@@ -6,11 +6,16 @@
 #include <array>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 
 using hash160_t = std::array<std::uint8_t, 20>;
 
 
+// Hash160 of a Base58Check P2PKH address, false if its checksum does not match.
+bool unaddr(std::string_view addr, hash160_t & h160);
+
+// Same, warning about a checksum mismatch on stderr.
 hash160_t unaddr(std::string const &addr);
 
 
@@ -0,0 +1,210 @@
+#include "window_scan.hpp"
+#include "longest_run.hpp"
+#include "simd_u32.hpp"
+
+#include <cstring>
+
+#include <immintrin.h>
+
+
+// targets in a column, the lanes of the widest kernel
+static constexpr std::size_t PADDING = 8;
+
+
+void window_scan_build(window_scan_t & scan, hash_4_simd_t const * hashes_p, std::size_t ntargets, unsigned int min_len)
+{
+    scan.kernels = cpu_kernels();
+    scan.ntargets = ntargets;
+
+    // as longest_run(): y keeps the bits that start a run of at least len equal bits
+    scan.shifts.clear();
+    auto len = 1u;
+    for (/* nop */; 2 * len <= min_len; len *= 2)
+    {
+        scan.shifts.push_back(len);
+    }
+    if (min_len > len)
+    {
+        scan.shifts.push_back(min_len - len);
+    }
+
+    auto const npadded = (ntargets + PADDING - 1) / PADDING * PADDING;
+    for (auto wix = 0u; wix < 3; ++wix)
+    {
+        scan.words[wix].assign(npadded, 0);
+        for (std::size_t tix = 0; tix < ntargets; ++tix)
+        {
+            std::memcpy(&scan.words[wix][tix], hashes_p[tix].h256.data() + 8 * wix, sizeof (std::uint64_t));
+        }
+    }
+}
+
+
+// ~(target ^ h160) is target ^ ~h160, the last word kept to its 32 bits
+static inline
+void complement_of(hash_4_simd_t const & h160, std::uint64_t (&c)[3])
+{
+    std::memcpy(c, h160.h256.data(), sizeof (c));
+    c[0] = ~c[0];
+    c[1] = ~c[1];
+    c[2] = ~c[2] & 0xFFFF'FFFFULL;
+}
+
+
+static
+void scan_x1(window_scan_t const & scan, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    std::uint64_t c[3];
+    complement_of(h160, c);
+
+    auto const * w0_p = scan.words[0].data();
+    auto const * w1_p = scan.words[1].data();
+    auto const * w2_p = scan.words[2].data();
+    auto const * shifts_p = scan.shifts.data();
+    auto const nshifts = scan.shifts.size();
+
+    for (std::size_t tix = 0; tix < scan.ntargets; ++tix)
+    {
+        std::uint64_t y[3] = {w0_p[tix] ^ c[0], w1_p[tix] ^ c[1], w2_p[tix] ^ c[2]};
+
+        // runs of 16 equal bits are already rare, most targets are out after 4 steps
+        for (std::size_t six = 0; (six < nshifts) and ((y[0] | y[1] | y[2]) != 0); ++six)
+        {
+            std::uint64_t t[3] = {y[0], y[1], y[2]};
+            shr192(t, shifts_p[six]);
+            y[0] &= t[0];
+            y[1] &= t[1];
+            y[2] &= t[2];
+        }
+
+        if (__builtin_expect((y[0] | y[1] | y[2]) != 0, 0))
+        {
+            tixs.push_back(tix);
+        }
+    }
+}
+
+
+// Shifts by 64 bits give 0 in the vector instructions, so that the word
+// above moves down whole, no special case as in shr192().
+SIMD_AVX2
+static
+void scan_x4(window_scan_t const & scan, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    std::uint64_t c[3];
+    complement_of(h160, c);
+
+    auto const c0 = _mm256_set1_epi64x(c[0]);
+    auto const c1 = _mm256_set1_epi64x(c[1]);
+    auto const c2 = _mm256_set1_epi64x(c[2]);
+    auto const zero = _mm256_setzero_si256();
+
+    auto const * w0_p = scan.words[0].data();
+    auto const * w1_p = scan.words[1].data();
+    auto const * w2_p = scan.words[2].data();
+
+    for (std::size_t tix = 0; tix < scan.ntargets; tix += 4)
+    {
+        auto y0 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(w0_p + tix)), c0);
+        auto y1 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(w1_p + tix)), c1);
+        auto y2 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(w2_p + tix)), c2);
+
+        for (auto const k : scan.shifts)
+        {
+            auto const r = _mm_cvtsi32_si128(k);
+            auto const l = _mm_cvtsi32_si128(64 - k);
+            y0 = _mm256_and_si256(y0, _mm256_or_si256(_mm256_srl_epi64(y0, r), _mm256_sll_epi64(y1, l)));
+            y1 = _mm256_and_si256(y1, _mm256_or_si256(_mm256_srl_epi64(y1, r), _mm256_sll_epi64(y2, l)));
+            y2 = _mm256_and_si256(y2, _mm256_srl_epi64(y2, r));
+
+            auto const any = _mm256_or_si256(y0, _mm256_or_si256(y1, y2));
+            if (_mm256_testz_si256(any, any))
+            {
+                break;
+            }
+        }
+
+        auto const any = _mm256_or_si256(y0, _mm256_or_si256(y1, y2));
+        auto m = (unsigned int)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(any, zero))) ^ 0xFu;
+        for (/* nop */; __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            auto const hit = tix + __builtin_ctz(m);
+            if (hit < scan.ntargets)
+            {
+                tixs.push_back(hit);
+            }
+        }
+    }
+}
+
+
+// a & (b | c), the shift-and step in one instruction
+static constexpr int TERNLOG_AND_OR = 0xE0;
+// a | b | c
+static constexpr int TERNLOG_OR3 = 0xFE;
+
+SIMD_AVX512
+static
+void scan_x8(window_scan_t const & scan, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    std::uint64_t c[3];
+    complement_of(h160, c);
+
+    auto const c0 = _mm512_set1_epi64(c[0]);
+    auto const c1 = _mm512_set1_epi64(c[1]);
+    auto const c2 = _mm512_set1_epi64(c[2]);
+
+    auto const * w0_p = scan.words[0].data();
+    auto const * w1_p = scan.words[1].data();
+    auto const * w2_p = scan.words[2].data();
+
+    for (std::size_t tix = 0; tix < scan.ntargets; tix += 8)
+    {
+        auto y0 = _mm512_xor_si512(_mm512_loadu_si512(w0_p + tix), c0);
+        auto y1 = _mm512_xor_si512(_mm512_loadu_si512(w1_p + tix), c1);
+        auto y2 = _mm512_xor_si512(_mm512_loadu_si512(w2_p + tix), c2);
+
+        for (auto const k : scan.shifts)
+        {
+            auto const r = _mm_cvtsi32_si128(k);
+            auto const l = _mm_cvtsi32_si128(64 - k);
+            y0 = _mm512_ternarylogic_epi64(y0, _mm512_srl_epi64(y0, r), _mm512_sll_epi64(y1, l), TERNLOG_AND_OR);
+            y1 = _mm512_ternarylogic_epi64(y1, _mm512_srl_epi64(y1, r), _mm512_sll_epi64(y2, l), TERNLOG_AND_OR);
+            y2 = _mm512_and_si512(y2, _mm512_srl_epi64(y2, r));
+
+            auto const any = _mm512_ternarylogic_epi64(y0, y1, y2, TERNLOG_OR3);
+            if (_mm512_test_epi64_mask(any, any) == 0)
+            {
+                break;
+            }
+        }
+
+        // the padding past the last target left out
+        __mmask8 const valid = (scan.ntargets - tix >= 8) ? 0xFF : (1u << (scan.ntargets - tix)) - 1;
+
+        auto const any = _mm512_ternarylogic_epi64(y0, y1, y2, TERNLOG_OR3);
+        for (auto m = (unsigned int)_mm512_mask_test_epi64_mask(valid, any, any); __builtin_expect(m != 0, 0); m &= m - 1)
+        {
+            tixs.push_back(tix + __builtin_ctz(m));
+        }
+    }
+}
+
+
+void window_scan(window_scan_t const & scan, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs)
+{
+    tixs.clear();
+
+    switch (scan.kernels)
+    {
+        case CPU_KERNELS_AVX512:
+            scan_x8(scan, h160, tixs);
+            break;
+        case CPU_KERNELS_AVX2:
+            scan_x4(scan, h160, tixs);
+            break;
+        default:
+            scan_x1(scan, h160, tixs);
+            break;
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#ifndef WINDOW_SCAN_HPP
+#define WINDOW_SCAN_HPP
+
+#include "ripemd160_mb.hpp"
+#include "cpu_dispatch.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+// Target hash160s for a scan of all of them, when no index applies: tells
+// which targets share a run of at least min_len equal bits with a hash,
+// the window test of longest_run, for many targets at a time.
+//
+// The hashes are stored as three columns of little-endian 64-bit words, the
+// third holding the last 32 bits, so that a vector register loads the same
+// word of consecutive targets: 4 with AVX2, 8 with AVX-512, which also folds
+// each shift-and step into one vpternlogq and yields the matches as a mask.
+typedef struct
+{
+    cpu_kernels_t kernels;
+    std::size_t ntargets;
+
+    // the shift-and steps of the window test, each 1 to 64 bits
+    std::vector<unsigned int> shifts;
+
+    // word w of target tix at words[w][tix], padded to a multiple of 8 targets
+    std::vector<std::uint64_t> words[3];
+} window_scan_t;
+
+
+void window_scan_build(window_scan_t & scan, hash_4_simd_t const * hashes_p, std::size_t ntargets, unsigned int min_len);
+
+// Indices of the targets that may hold a run of min_len equal bits with
+// h160, in ascending order: exactly those longest_run() then finds a run in.
+void window_scan(window_scan_t const & scan, hash_4_simd_t const & h160, std::vector<std::uint32_t> & tixs);
+
+
+#endif /* WINDOW_SCAN_HPP */